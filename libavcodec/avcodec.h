@@ -2767,6 +2767,19 @@ typedef struct AVCodecContext {
      * used as reference pictures).
      */
     int extra_hw_frames;
+
+    /**
+     * A reference to a buffer pool set, as allocated by
+     * av_buffer_pool_set_alloc(). When set, avcodec_default_get_buffer2()
+     * allocates the frame data from it instead of from pools private to this
+     * codec context, so that several decoders can share memory and be subject
+     * to a common memory limit. The reference is set by the caller and
+     * afterwards owned (and freed) by libavcodec.
+     *
+     * - encoding: unused
+     * - decoding: Set by user before avcodec_open2().
+     */
+    AVBufferRef *buffer_pool_set;
 } AVCodecContext;
 
 /**
@@ -1020,7 +1020,8 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
         for (i = 0; i < 4; i++) {
             av_buffer_pool_uninit(&pool->pools[i]);
             pool->linesize[i] = linesize[i];
-            if (size[i]) {
+            pool->sizes[i]    = size[i] ? size[i] + 16 : 0;
+            if (size[i] && !avctx->buffer_pool_set) {
                 pool->pools[i] = av_buffer_pool_init(size[i] + 16, NULL);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
@@ -1049,10 +1050,13 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
         if (ret < 0)
             goto fail;
 
-        pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
-        if (!pool->pools[0]) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
+        pool->sizes[0] = pool->linesize[0];
+        if (!avctx->buffer_pool_set) {
+            pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
+            if (!pool->pools[0]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
         }
 
         pool->format     = frame->format;
@@ -1065,14 +1069,25 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
     }
     return 0;
 fail:
-    for (i = 0; i < 4; i++)
+    for (i = 0; i < 4; i++) {
         av_buffer_pool_uninit(&pool->pools[i]);
+        pool->sizes[i] = 0;
+    }
     pool->format = -1;
     pool->planes = pool->channels = pool->samples = 0;
     pool->width  = pool->height = 0;
     return ret;
 }
 
+static AVBufferRef *frame_pool_get(AVCodecContext *avctx, int plane)
+{
+    FramePool *pool = avctx->internal->pool;
+
+    if (avctx->buffer_pool_set)
+        return av_buffer_pool_set_get(avctx->buffer_pool_set, pool->sizes[plane]);
+    return av_buffer_pool_get(pool->pools[plane]);
+}
+
 static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
 {
     FramePool *pool = avctx->internal->pool;
@@ -1095,13 +1110,13 @@ static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
         frame->extended_data = frame->data;
 
     for (i = 0; i < FFMIN(planes, AV_NUM_DATA_POINTERS); i++) {
-        frame->buf[i] = av_buffer_pool_get(pool->pools[0]);
+        frame->buf[i] = frame_pool_get(avctx, 0);
         if (!frame->buf[i])
             goto fail;
         frame->extended_data[i] = frame->data[i] = frame->buf[i]->data;
     }
     for (i = 0; i < frame->nb_extended_buf; i++) {
-        frame->extended_buf[i] = av_buffer_pool_get(pool->pools[0]);
+        frame->extended_buf[i] = frame_pool_get(avctx, 0);
         if (!frame->extended_buf[i])
             goto fail;
         frame->extended_data[i + AV_NUM_DATA_POINTERS] = frame->extended_buf[i]->data;
@@ -1129,10 +1144,10 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
     memset(pic->data, 0, sizeof(pic->data));
     pic->extended_data = pic->data;
 
-    for (i = 0; i < 4 && pool->pools[i]; i++) {
+    for (i = 0; i < 4 && pool->sizes[i]; i++) {
         pic->linesize[i] = pool->linesize[i];
 
-        pic->buf[i] = av_buffer_pool_get(pool->pools[i]);
+        pic->buf[i] = frame_pool_get(s, i);
         if (!pic->buf[i])
             goto fail;
 
@@ -67,7 +67,6 @@ typedef struct RiceContext {
     enum CodingMode coding_mode;
     int porder;
     int params[MAX_PARTITIONS];
-    uint32_t udata[FLAC_MAX_BLOCKSIZE];
 } RiceContext;
 
 typedef struct FlacSubframe {
@@ -109,7 +108,8 @@ typedef struct FlacEncodeContext {
     FlacFrame frame;
     CompressionOptions options;
     AVCodecContext *avctx;
-    LPCContext lpc_ctx;
+    LPCContext *lpc_ctx;        ///< one per slice thread
+    int nb_lpc_ctx;
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
@@ -420,8 +420,19 @@ FF_ENABLE_DEPRECATION_WARNINGS
     s->frame_count   = 0;
     s->min_framesize = s->max_framesize;
 
-    ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
-                      s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    /* the channels are searched in parallel with slice threading,
+     * each thread needs its own LPC context */
+    s->nb_lpc_ctx = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    avctx->thread_count : 1;
+    s->lpc_ctx    = av_mallocz_array(s->nb_lpc_ctx, sizeof(*s->lpc_ctx));
+    if (!s->lpc_ctx)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_lpc_ctx; i++) {
+        ret = ff_lpc_init(&s->lpc_ctx[i], avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt,
@@ -605,12 +616,12 @@ static uint64_t calc_optimal_rice_params(RiceContext *rc, int porder,
 }
 
 
-static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
-                      uint64_t sums[][MAX_PARTITIONS])
+static void calc_sums(int pmin, int pmax, const int32_t *data, int n,
+                      int pred_order, uint64_t sums[][MAX_PARTITIONS])
 {
     int i, j;
     int parts;
-    uint32_t *res, *res_end;
+    const int32_t *res, *res_end;
 
     /* sums for highest level */
     parts   = (1 << pmax);
@@ -618,8 +629,8 @@ static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
     res_end = &data[n >> pmax];
     for (i = 0; i < parts; i++) {
         uint64_t sum = 0;
-        while (res < res_end)
-            sum += *(res++);
+        for (; res < res_end; res++)
+            sum += ((uint32_t)*res << 1) ^ (*res >> 31);
         sums[pmax][i] = sum;
         res_end += n >> pmax;
     }
@@ -647,10 +658,7 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
 
     tmp_rc.coding_mode = rc->coding_mode;
 
-    for (i = 0; i < n; i++)
-        rc->udata[i] = (2 * data[i]) ^ (data[i] >> 31);
-
-    calc_sums(pmin, pmax, rc->udata, n, pred_order, sums);
+    calc_sums(pmin, pmax, data, n, pred_order, sums);
 
     opt_porder = pmin;
     bits[pmin] = UINT32_MAX;
@@ -743,7 +751,8 @@ static void encode_residual_fixed(int32_t *res, const int32_t *smp, int n,
 }
 
 
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+static int encode_residual_ch(FlacEncodeContext *s, LPCContext *lpc_ctx,
+                              int ch)
 {
     int i, n;
     int min_order, max_order, opt_order, omethod;
@@ -806,7 +815,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
+    opt_order = ff_lpc_calc_coefs(lpc_ctx, smp, n, min_order, max_order,
                                   s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MAX_LPC_SHIFT, 0);
@@ -918,15 +927,27 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
+static int encode_residual_ch_job(AVCodecContext *avctx, void *arg,
+                                  int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+
+    return encode_residual_ch(s, &s->lpc_ctx[threadnr], ch);
+}
+
+
 static int encode_frame(FlacEncodeContext *s)
 {
     int ch;
+    int ch_count[FLAC_MAX_CHANNELS];
     uint64_t count;
 
     count = count_frame_header(s);
 
+    s->avctx->execute2(s->avctx, encode_residual_ch_job, NULL, ch_count,
+                       s->channels);
     for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+        count += ch_count[ch];
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1321,7 +1342,12 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
         FlacEncodeContext *s = avctx->priv_data;
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
-        ff_lpc_end(&s->lpc_ctx);
+        if (s->lpc_ctx) {
+            int i;
+            for (i = 0; i < s->nb_lpc_ctx; i++)
+                ff_lpc_end(&s->lpc_ctx[i]);
+            av_freep(&s->lpc_ctx);
+        }
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -1374,7 +1400,9 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
@@ -83,6 +83,12 @@ typedef struct HYuvContext {
     VLC vlc[6];                             //Y,U,V,YY,YU,YV
     uint8_t *bitstream_buffer;
     unsigned int bitstream_buffer_size;
+    int nb_slices;                          ///< encoder only, Huffman coding jobs per frame
+    uint16_t *symbols;                      ///< deferred symbols for slice-threaded coding, table << 8 | value
+    int nb_symbols;
+    int count_stats;                        ///< update stats while coding the deferred symbols
+    struct HYuvEncSlice *slices;
+    uint8_t *slice_buffer;
     BswapDSPContext bdsp;
     HuffYUVDSPContext hdsp;
     HuffYUVEncDSPContext hencdsp;
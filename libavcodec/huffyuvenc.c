@@ -35,6 +35,16 @@
 #include "internal.h"
 #include "put_bits.h"
 
+/* Longest Huffman code, in bytes */
+#define MAX_CODE_BYTES 4
+
+typedef struct HYuvEncSlice {
+    uint8_t *buf;
+    int size;
+    int bits;
+    uint64_t stats[3][256];
+} HYuvEncSlice;
+
 static inline int sub_left_prediction(HYuvContext *s, uint8_t *dst,
                                       uint8_t *src, int w, int left)
 {
@@ -147,7 +157,7 @@ static int store_table(HYuvContext *s, const uint8_t *len, uint8_t *buf)
 static av_cold int encode_init(AVCodecContext *avctx)
 {
     HYuvContext *s = avctx->priv_data;
-    int i, j;
+    int i, j, ret;
 
     ff_huffyuv_common_init(avctx);
     ff_huffyuvencdsp_init(&s->hencdsp);
@@ -296,7 +306,31 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 s->stats[i][j]= 0;
     }
 
-    ff_huffyuv_alloc_temp(s);
+    if ((ret = ff_huffyuv_alloc_temp(s)) < 0)
+        return ret;
+
+    /* With slice threading the symbols of a frame are collected first
+     * and then Huffman coded by several threads. */
+    s->nb_slices = avctx->active_thread_type & FF_THREAD_SLICE ?
+                   avctx->thread_count : 1;
+    if (s->nb_slices > 1) {
+        /* at most 4 symbols per pixel; the symbols are split evenly, so a
+         * job never codes more than the symbols of slice_height rows */
+        int slice_height = (s->height + s->nb_slices - 1) / s->nb_slices;
+        int max_symbols  = 4 * s->width * s->height;
+        int slice_size   = MAX_CODE_BYTES * 4 * s->width * slice_height +
+                           AV_INPUT_BUFFER_PADDING_SIZE;
+
+        s->symbols      = av_malloc_array(max_symbols, sizeof(*s->symbols));
+        s->slices       = av_mallocz_array(s->nb_slices, sizeof(*s->slices));
+        s->slice_buffer = av_malloc_array(s->nb_slices, slice_size);
+        if (!s->symbols || !s->slices || !s->slice_buffer)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < s->nb_slices; i++) {
+            s->slices[i].buf  = s->slice_buffer + i * slice_size;
+            s->slices[i].size = slice_size;
+        }
+    }
 
     s->picture_number=0;
 
@@ -333,6 +367,18 @@ static int encode_422_bitstream(HYuvContext *s, int offset, int count)
     }
     if (s->avctx->flags2 & AV_CODEC_FLAG2_NO_OUTPUT)
         return 0;
+    if (s->symbols) {
+        uint16_t *sym = s->symbols + s->nb_symbols;
+        for (i = 0; i < count; i++) {
+            LOAD4;
+            *sym++ =            y0;
+            *sym++ = (1 << 8) | u0;
+            *sym++ =            y1;
+            *sym++ = (2 << 8) | v0;
+        }
+        s->nb_symbols += 4 * count;
+        return 0;
+    }
     if (s->context) {
         for (i = 0; i < count; i++) {
             LOAD4;
@@ -387,6 +433,16 @@ static int encode_gray_bitstream(HYuvContext *s, int count)
     if (s->avctx->flags2 & AV_CODEC_FLAG2_NO_OUTPUT)
         return 0;
 
+    if (s->symbols) {
+        uint16_t *sym = s->symbols + s->nb_symbols;
+        for (i = 0; i < count; i++) {
+            LOAD2;
+            *sym++ = y0;
+            *sym++ = y1;
+        }
+        s->nb_symbols += 2 * count;
+        return 0;
+    }
     if (s->context) {
         for (i = 0; i < count; i++) {
             LOAD2;
@@ -438,6 +494,17 @@ static inline int encode_bgra_bitstream(HYuvContext *s, int count, int planes)
             LOAD_GBRA;
             STAT_BGRA;
         }
+    } else if (s->symbols) {
+        uint16_t *sym = s->symbols + s->nb_symbols;
+        for (i = 0; i < count; i++) {
+            LOAD_GBRA;
+            *sym++ = (1 << 8) | g;
+            *sym++ =            b;
+            *sym++ = (2 << 8) | r;
+            if (planes == 4)
+                *sym++ = (2 << 8) | a;
+        }
+        s->nb_symbols += planes * count;
     } else if (s->context || (s->flags & AV_CODEC_FLAG_PASS1)) {
         for (i = 0; i < count; i++) {
             LOAD_GBRA;
@@ -453,6 +520,69 @@ static inline int encode_bgra_bitstream(HYuvContext *s, int count, int planes)
     return 0;
 }
 
+static int encode_symbols_slice(AVCodecContext *avctx, void *arg,
+                                int jobnr, int threadnr)
+{
+    HYuvContext *s     = avctx->priv_data;
+    HYuvEncSlice *sl   = &s->slices[jobnr];
+    const uint16_t *sym = s->symbols + (int64_t)s->nb_symbols *  jobnr      / s->nb_slices;
+    const uint16_t *end = s->symbols + (int64_t)s->nb_symbols * (jobnr + 1) / s->nb_slices;
+    PutBitContext pb;
+
+    init_put_bits(&pb, sl->buf, sl->size);
+
+    if (s->count_stats) {
+        memset(sl->stats, 0, sizeof(sl->stats));
+        for (; sym < end; sym++) {
+            int t = *sym >> 8, v = *sym & 0xFF;
+            sl->stats[t][v]++;
+            put_bits(&pb, s->len[t][v], s->bits[t][v]);
+        }
+    } else {
+        for (; sym < end; sym++) {
+            int t = *sym >> 8, v = *sym & 0xFF;
+            put_bits(&pb, s->len[t][v], s->bits[t][v]);
+        }
+    }
+
+    sl->bits = put_bits_count(&pb);
+    flush_put_bits(&pb);
+
+    return 0;
+}
+
+/**
+ * Huffman code the deferred symbols in parallel and append the slices
+ * to the main bitstream, which results in the same bitstream as coding
+ * them serially.
+ */
+static int encode_symbols(HYuvContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i, j, k;
+
+    avctx->execute2(avctx, encode_symbols_slice, NULL, NULL, s->nb_slices);
+
+    for (i = 0; i < s->nb_slices; i++) {
+        HYuvEncSlice *sl = &s->slices[i];
+
+        if (s->pb.buf_end - s->pb.buf - (put_bits_count(&s->pb) >> 3) <
+            (sl->bits + 7) >> 3) {
+            av_log(avctx, AV_LOG_ERROR, "encoded frame too large\n");
+            return -1;
+        }
+        avpriv_copy_bits(&s->pb, sl->buf, sl->bits);
+
+        if (s->count_stats)
+            for (j = 0; j < 3; j++)
+                for (k = 0; k < 256; k++)
+                    s->stats[j][k] += sl->stats[j][k];
+    }
+    s->nb_symbols = 0;
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -487,6 +617,10 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     init_put_bits(&s->pb, pkt->data + size, pkt->size - size);
 
+    s->nb_symbols  = 0;
+    s->count_stats = s->context || (s->bitstream_bpp >= 24 &&
+                                    (s->flags & AV_CODEC_FLAG_PASS1));
+
     if (avctx->pix_fmt == AV_PIX_FMT_YUV422P ||
         avctx->pix_fmt == AV_PIX_FMT_YUV420P) {
         int lefty, leftu, leftv, y, cy;
@@ -654,6 +788,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     }
     emms_c();
 
+    if (s->nb_symbols && (ret = encode_symbols(s)) < 0)
+        return ret;
+
     size += (put_bits_count(&s->pb) + 31) / 8;
     put_bits(&s->pb, 16, 0);
     put_bits(&s->pb, 15, 0);
@@ -694,6 +831,10 @@ static av_cold int encode_end(AVCodecContext *avctx)
 
     ff_huffyuv_common_end(s);
 
+    av_freep(&s->symbols);
+    av_freep(&s->slices);
+    av_freep(&s->slice_buffer);
+
     av_freep(&avctx->extradata);
     av_freep(&avctx->stats_out);
 
@@ -734,6 +875,7 @@ AVCodec ff_huffyuv_encoder = {
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_end,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_YUV422P, AV_PIX_FMT_RGB24,
         AV_PIX_FMT_RGB32, AV_PIX_FMT_NONE
@@ -761,6 +903,7 @@ AVCodec ff_ffvhuff_encoder = {
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_end,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_RGB24,
         AV_PIX_FMT_RGB32, AV_PIX_FMT_NONE
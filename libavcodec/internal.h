@@ -86,6 +86,12 @@ typedef struct FramePool {
      */
     AVBufferPool *pools[4];
 
+    /**
+     * Size of the buffers for each data plane, used to allocate from
+     * AVCodecContext.buffer_pool_set when it is set instead of the pools.
+     */
+    int sizes[4];
+
     /*
      * Pool parameters
      */
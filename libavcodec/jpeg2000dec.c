@@ -62,6 +62,14 @@ typedef struct Jpeg2000Tile {
     uint16_t tp_idx;                    // Tile-part index
 } Jpeg2000Tile;
 
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                  bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -89,6 +97,9 @@ typedef struct Jpeg2000DecoderContext {
     Jpeg2000Tile    *tile;
     Jpeg2000DSPContext dsp;
 
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned int    cblk_jobs_size;
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1079,11 +1090,59 @@ static inline void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     s->dsp.mct_decode[tile->codsty[0].transform](src[0], src[1], src[2], csize);
 }
 
-static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
+static void tile_codeblock(Jpeg2000DecoderContext *s, Jpeg2000T1Context *t1,
+                           const Jpeg2000CblkJob *job)
+{
+    Jpeg2000Cblk *cblk = job->cblk;
+    int x = cblk->coord[0][0];
+    int y = cblk->coord[1][0];
+
+    decode_cblk(s, job->codsty, t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos);
+
+    if (job->codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, job->comp, t1, job->band);
+    else
+        dequantization_int(x, y, cblk, job->comp, t1, job->band);
+}
+
+static int tile_codeblock_job(AVCodecContext *avctx, void *arg,
+                              int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000T1Context t1;
+
+    tile_codeblock(s, &t1, s->cblk_jobs + jobnr);
+
+    return 0;
+}
+
+static void tile_dwt(Jpeg2000Tile *tile, int compno)
+{
+    Jpeg2000Component *comp     = tile->comp + compno;
+    Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+
+    ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+}
+
+static int tile_dwt_job(AVCodecContext *avctx, void *arg,
+                        int jobnr, int threadnr)
+{
+    tile_dwt(arg, jobnr);
+
+    return 0;
+}
+
+/* If threaded, the codeblocks of all the components are collected first
+ * and decoded in parallel, followed by one inverse DWT job per component. */
+static int tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                           int threaded)
 {
     Jpeg2000T1Context t1;
 
-    int compno, reslevelno, bandno;
+    int compno, reslevelno, bandno, nb_jobs = 0;
 
     /* Loop on tile components */
 
@@ -1113,28 +1172,40 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
                     for (cblkno = 0;
                          cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
                          cblkno++) {
-                        int x, y;
-                        Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-
-                        x = cblk->coord[0][0];
-                        y = cblk->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
+                        Jpeg2000CblkJob job = {
+                            .comp    = comp,
+                            .codsty  = codsty,
+                            .band    = band,
+                            .cblk    = prec->cblk + cblkno,
+                            .bandpos = bandpos,
+                        };
+
+                        if (threaded) {
+                            Jpeg2000CblkJob *jobs = av_fast_realloc(s->cblk_jobs, &s->cblk_jobs_size,
+                                                                    (nb_jobs + 1) * sizeof(*jobs));
+                            if (!jobs)
+                                return AVERROR(ENOMEM);
+                            s->cblk_jobs    = jobs;
+                            jobs[nb_jobs++] = job;
+                        } else {
+                            tile_codeblock(s, &t1, &job);
+                        }
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
         } /* end reslevel */
 
         /* inverse DWT */
-        ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+        if (!threaded)
+            tile_dwt(tile, compno);
     } /*end comp */
+
+    if (threaded) {
+        s->avctx->execute2(s->avctx, tile_codeblock_job, NULL, NULL, nb_jobs);
+        s->avctx->execute2(s->avctx, tile_dwt_job, tile, NULL, s->ncomponents);
+    }
+
+    return 0;
 }
 
 #define WRITE_FRAME(D, PIXEL)                                                                     \
@@ -1193,9 +1264,12 @@ WRITE_FRAME(16, uint16_t)
 #undef WRITE_FRAME
 
 static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
-                                AVFrame *picture)
+                                AVFrame *picture, int threaded)
 {
-    tile_codeblocks(s, tile);
+    int ret;
+
+    if ((ret = tile_codeblocks(s, tile, threaded)) < 0)
+        return ret;
 
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
@@ -1210,6 +1284,14 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
     return 0;
 }
 
+static int jpeg2000_decode_tile_job(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    return jpeg2000_decode_tile(s, s->tile + jobnr, arg, 0);
+}
+
 static void jpeg2000_dec_cleanup(Jpeg2000DecoderContext *s)
 {
     int tileno, compno;
@@ -1378,13 +1460,24 @@ static av_cold int jpeg2000_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int jpeg2000_decode_close(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+
+    return 0;
+}
+
 static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
                                  int *got_frame, AVPacket *avpkt)
 {
     Jpeg2000DecoderContext *s = avctx->priv_data;
     ThreadFrame frame = { .f = data };
     AVFrame *picture = data;
-    int tileno, ret;
+    int *tile_ret = NULL;
+    int tileno, nb_tiles, threaded, ret;
 
     s->avctx     = avctx;
     bytestream2_init(&s->g, avpkt->data, avpkt->size);
@@ -1428,9 +1521,26 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
 
     if (ret = jpeg2000_read_bitstream_packets(s))
         goto end;
-    for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++)
-        if (ret = jpeg2000_decode_tile(s, s->tile + tileno, picture))
+
+    nb_tiles = s->numXtiles * s->numYtiles;
+    threaded = avctx->active_thread_type & FF_THREAD_SLICE;
+    if (threaded && nb_tiles >= avctx->thread_count) {
+        /* enough tiles to keep every thread busy, decode them in parallel */
+        if (!(tile_ret = av_malloc_array(nb_tiles, sizeof(*tile_ret)))) {
+            ret = AVERROR(ENOMEM);
             goto end;
+        }
+        avctx->execute2(avctx, jpeg2000_decode_tile_job, picture, tile_ret, nb_tiles);
+        for (tileno = 0; tileno < nb_tiles; tileno++)
+            if ((ret = tile_ret[tileno]) < 0)
+                goto end;
+    } else {
+        for (tileno = 0; tileno < nb_tiles; tileno++)
+            if (ret = jpeg2000_decode_tile(s, s->tile + tileno, picture, threaded))
+                goto end;
+    }
+
+    av_free(tile_ret);
 
     jpeg2000_dec_cleanup(s);
 
@@ -1439,6 +1549,7 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
     return bytestream2_tell(&s->g);
 
 end:
+    av_free(tile_ret);
     jpeg2000_dec_cleanup(s);
     return ret;
 }
@@ -1470,11 +1581,13 @@ AVCodec ff_jpeg2000_decoder = {
     .long_name        = NULL_IF_CONFIG_SMALL("JPEG 2000"),
     .type             = AVMEDIA_TYPE_VIDEO,
     .id               = AV_CODEC_ID_JPEG2000,
-    .capabilities     = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_DR1,
+    .capabilities     = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                        AV_CODEC_CAP_DR1,
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init_static_data = jpeg2000_init_static_data,
     .init             = jpeg2000_decode_init,
     .decode           = jpeg2000_decode_frame,
+    .close            = jpeg2000_decode_close,
     .priv_class       = &class,
     .profiles         = NULL_IF_CONFIG_SMALL(ff_jpeg2000_profiles)
 };
@@ -51,6 +51,12 @@
 #define I_LFTG_K       80621
 #define I_LFTG_X      106544
 
+/* Number of columns transformed together in the vertical passes.
+ * Interleaving them in the line buffer turns the strided column accesses
+ * into contiguous rows, which keeps the working set in cache and lets the
+ * lifting steps be vectorized across columns. */
+#define DWT_COLS 16
+
 
 static inline void extend53(int *p, int i0, int i1)
 {
@@ -95,11 +101,36 @@ static void sr_1d53(int *p, int i0, int i1)
         p[2 * i + 1] += (p[2 * i] + p[2 * i + 2]) >> 1;
 }
 
+static void sr_1d53_cols(int32_t *p, int i0, int i1, int n)
+{
+    int i, k;
+
+    if (i1 == i0 + 1)
+        return;
+
+    memcpy(p + (i0 - 1) * DWT_COLS, p + (i0 + 1) * DWT_COLS, n * sizeof(*p));
+    memcpy(p +  i1      * DWT_COLS, p + (i1 - 2) * DWT_COLS, n * sizeof(*p));
+    memcpy(p + (i0 - 2) * DWT_COLS, p + (i0 + 2) * DWT_COLS, n * sizeof(*p));
+    memcpy(p + (i1 + 1) * DWT_COLS, p + (i1 - 3) * DWT_COLS, n * sizeof(*p));
+
+    for (i = i0 / 2; i < i1 / 2 + 1; i++) {
+        int32_t *r = p + 2 * i * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] -= (r[k - DWT_COLS] + r[k + DWT_COLS] + 2) >> 2;
+    }
+    for (i = i0 / 2; i < i1 / 2; i++) {
+        int32_t *r = p + (2 * i + 1) * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] += (r[k - DWT_COLS] + r[k + DWT_COLS]) >> 1;
+    }
+}
+
 static void dwt_decode53(DWTContext *s, int *t)
 {
     int lev;
     int w     = s->linelen[s->ndeclevels - 1][0];
     int32_t *line = s->i_linebuf;
+    int32_t *cols = s->i_linebuf + 3 * DWT_COLS;
     line += 3;
 
     for (lev = 0; lev < s->ndeclevels; lev++) {
@@ -127,19 +158,19 @@ static void dwt_decode53(DWTContext *s, int *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = cols + mv * DWT_COLS;
+        for (lp = 0; lp < lh; lp += DWT_COLS) {
+            int i, j = 0, n = FFMIN(DWT_COLS, lh - lp);
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
+                memcpy(l + i * DWT_COLS, t + w * j + lp, n * sizeof(*t));
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
+                memcpy(l + i * DWT_COLS, t + w * j + lp, n * sizeof(*t));
 
-            sr_1d53(line, mv, mv + lv);
+            sr_1d53_cols(cols, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                t[w * i + lp] = l[i];
+                memcpy(t + w * i + lp, l + i * DWT_COLS, n * sizeof(*t));
         }
     }
 }
@@ -166,11 +197,49 @@ static void sr_1d97_float(float *p, int i0, int i1)
         p[2 * i + 1] += F_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]);
 }
 
+static void sr_1d97_float_cols(float *p, int i0, int i1, int n)
+{
+    int i, k;
+
+    if (i1 == i0 + 1)
+        return;
+
+    for (i = 1; i <= 4; i++) {
+        memcpy(p + (i0 - i)     * DWT_COLS, p + (i0 + i)     * DWT_COLS, n * sizeof(*p));
+        memcpy(p + (i1 + i - 1) * DWT_COLS, p + (i1 - i - 1) * DWT_COLS, n * sizeof(*p));
+    }
+
+    for (i = i0 / 2 - 1; i < i1 / 2 + 2; i++) {
+        float *r = p + 2 * i * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] -= F_LFTG_DELTA * (r[k - DWT_COLS] + r[k + DWT_COLS]);
+    }
+    /* step 4 */
+    for (i = i0 / 2 - 1; i < i1 / 2 + 1; i++) {
+        float *r = p + (2 * i + 1) * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] -= F_LFTG_GAMMA * (r[k - DWT_COLS] + r[k + DWT_COLS]);
+    }
+    /*step 5*/
+    for (i = i0 / 2; i < i1 / 2 + 1; i++) {
+        float *r = p + 2 * i * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] += F_LFTG_BETA  * (r[k - DWT_COLS] + r[k + DWT_COLS]);
+    }
+    /* step 6 */
+    for (i = i0 / 2; i < i1 / 2; i++) {
+        float *r = p + (2 * i + 1) * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] += F_LFTG_ALPHA * (r[k - DWT_COLS] + r[k + DWT_COLS]);
+    }
+}
+
 static void dwt_decode97_float(DWTContext *s, float *t)
 {
     int lev;
     int w       = s->linelen[s->ndeclevels - 1][0];
     float *line = s->f_linebuf;
+    float *cols = s->f_linebuf + 5 * DWT_COLS;
     float *data = t;
     /* position at index O of line range [0-5,w+5] cf. extend function */
     line += 5;
@@ -199,19 +268,21 @@ static void dwt_decode97_float(DWTContext *s, float *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = cols + mv * DWT_COLS;
+        for (lp = 0; lp < lh; lp += DWT_COLS) {
+            int i, j = 0, k, n = FFMIN(DWT_COLS, lh - lp);
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp] * F_LFTG_K;
+                for (k = 0; k < n; k++)
+                    l[i * DWT_COLS + k] = data[w * j + lp + k] * F_LFTG_K;
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp] * F_LFTG_X;
+                for (k = 0; k < n; k++)
+                    l[i * DWT_COLS + k] = data[w * j + lp + k] * F_LFTG_X;
 
-            sr_1d97_float(line, mv, mv + lv);
+            sr_1d97_float_cols(cols, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+                memcpy(data + w * i + lp, l + i * DWT_COLS, n * sizeof(*data));
         }
     }
 }
@@ -238,11 +309,49 @@ static void sr_1d97_int(int32_t *p, int i0, int i1)
         p[2 * i + 1] += (I_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]) + (1 << 15)) >> 16;
 }
 
+static void sr_1d97_int_cols(int32_t *p, int i0, int i1, int n)
+{
+    int i, k;
+
+    if (i1 == i0 + 1)
+        return;
+
+    for (i = 1; i <= 4; i++) {
+        memcpy(p + (i0 - i)     * DWT_COLS, p + (i0 + i)     * DWT_COLS, n * sizeof(*p));
+        memcpy(p + (i1 + i - 1) * DWT_COLS, p + (i1 - i - 1) * DWT_COLS, n * sizeof(*p));
+    }
+
+    for (i = i0 / 2 - 1; i < i1 / 2 + 2; i++) {
+        int32_t *r = p + 2 * i * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] -= (I_LFTG_DELTA * (r[k - DWT_COLS] + r[k + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /* step 4 */
+    for (i = i0 / 2 - 1; i < i1 / 2 + 1; i++) {
+        int32_t *r = p + (2 * i + 1) * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] -= (I_LFTG_GAMMA * (r[k - DWT_COLS] + r[k + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /*step 5*/
+    for (i = i0 / 2; i < i1 / 2 + 1; i++) {
+        int32_t *r = p + 2 * i * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] += (I_LFTG_BETA  * (r[k - DWT_COLS] + r[k + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /* step 6 */
+    for (i = i0 / 2; i < i1 / 2; i++) {
+        int32_t *r = p + (2 * i + 1) * DWT_COLS;
+        for (k = 0; k < n; k++)
+            r[k] += (I_LFTG_ALPHA * (r[k - DWT_COLS] + r[k + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+}
+
 static void dwt_decode97_int(DWTContext *s, int32_t *t)
 {
     int lev;
     int w       = s->linelen[s->ndeclevels - 1][0];
     int32_t *line = s->i_linebuf;
+    int32_t *cols = s->i_linebuf + 5 * DWT_COLS;
     int32_t *data = t;
     /* position at index O of line range [0-5,w+5] cf. extend function */
     line += 5;
@@ -271,19 +380,21 @@ static void dwt_decode97_int(DWTContext *s, int32_t *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = cols + mv * DWT_COLS;
+        for (lp = 0; lp < lh; lp += DWT_COLS) {
+            int i, j = 0, k, n = FFMIN(DWT_COLS, lh - lp);
             // rescale with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_K) + (1 << 15)) >> 16;
+                for (k = 0; k < n; k++)
+                    l[i * DWT_COLS + k] = ((data[w * j + lp + k] * I_LFTG_K) + (1 << 15)) >> 16;
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_X) + (1 << 15)) >> 16;
+                for (k = 0; k < n; k++)
+                    l[i * DWT_COLS + k] = ((data[w * j + lp + k] * I_LFTG_X) + (1 << 15)) >> 16;
 
-            sr_1d97_int(line, mv, mv + lv);
+            sr_1d97_int_cols(cols, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+                memcpy(data + w * i + lp, l + i * DWT_COLS, n * sizeof(*data));
         }
     }
 }
@@ -312,17 +423,17 @@ int ff_jpeg2000_dwt_init(DWTContext *s, uint16_t border[2][2],
         }
     switch (type) {
     case FF_DWT97:
-        s->f_linebuf = av_malloc((maxlen + 12) * sizeof(*s->f_linebuf));
+        s->f_linebuf = av_malloc_array((maxlen + 12) * DWT_COLS, sizeof(*s->f_linebuf));
         if (!s->f_linebuf)
             return AVERROR(ENOMEM);
         break;
      case FF_DWT97_INT:
-        s->i_linebuf = av_malloc((maxlen + 12) * sizeof(*s->i_linebuf));
+        s->i_linebuf = av_malloc_array((maxlen + 12) * DWT_COLS, sizeof(*s->i_linebuf));
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
     case FF_DWT53:
-        s->i_linebuf = av_malloc((maxlen +  6) * sizeof(*s->i_linebuf));
+        s->i_linebuf = av_malloc_array((maxlen +  6) * DWT_COLS, sizeof(*s->i_linebuf));
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
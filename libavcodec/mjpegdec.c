@@ -43,6 +43,7 @@
 #include "mjpegdec.h"
 #include "jpeglsdec.h"
 #include "put_bits.h"
+#include "thread.h"
 
 
 static int build_vlc(VLC *vlc, const uint8_t *bits_table,
@@ -68,34 +69,56 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
-static int build_basic_mjpeg_vlc(MJpegDecodeContext *s)
+/* build the VLCs of a DC (class 0) or AC (class 1) Huffman table */
+static int init_huffman_table(MJpegDecodeContext *s, int class, int index,
+                              const uint8_t *bits_table,
+                              const uint8_t *val_table, int nb_codes)
 {
-    int ret;
+    int i, n = 0, ret;
 
-    if ((ret = build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
-                         avpriv_mjpeg_val_dc, 12, 0, 0)) < 0)
+    ff_free_vlc(&s->vlcs[class][index]);
+    if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
+                         nb_codes, 0, class > 0)) < 0)
         return ret;
 
-    if ((ret = build_vlc(&s->vlcs[0][1], avpriv_mjpeg_bits_dc_chrominance,
-                         avpriv_mjpeg_val_dc, 12, 0, 0)) < 0)
-        return ret;
+    if (class > 0) {
+        ff_free_vlc(&s->vlcs[2][index]);
+        if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
+                             nb_codes, 0, 0)) < 0)
+            return ret;
+    }
 
-    if ((ret = build_vlc(&s->vlcs[1][0], avpriv_mjpeg_bits_ac_luminance,
-                         avpriv_mjpeg_val_ac_luminance, 251, 0, 1)) < 0)
-        return ret;
+    s->huff_bits[class][index][0] = 0;
+    for (i = 1; i <= 16; i++) {
+        s->huff_bits[class][index][i] = bits_table[i];
+        n += bits_table[i];
+    }
+    memset(s->huff_vals[class][index], 0, sizeof(s->huff_vals[class][index]));
+    memcpy(s->huff_vals[class][index], val_table, n);
+    s->huff_nb_codes[class][index] = nb_codes;
 
-    if ((ret = build_vlc(&s->vlcs[1][1], avpriv_mjpeg_bits_ac_chrominance,
-                         avpriv_mjpeg_val_ac_chrominance, 251, 0, 1)) < 0)
+    return 0;
+}
+
+static int build_basic_mjpeg_vlc(MJpegDecodeContext *s)
+{
+    int ret;
+
+    if ((ret = init_huffman_table(s, 0, 0, avpriv_mjpeg_bits_dc_luminance,
+                                  avpriv_mjpeg_val_dc, 12)) < 0)
         return ret;
 
-    if ((ret = build_vlc(&s->vlcs[2][0], avpriv_mjpeg_bits_ac_luminance,
-                         avpriv_mjpeg_val_ac_luminance, 251, 0, 0)) < 0)
+    if ((ret = init_huffman_table(s, 0, 1, avpriv_mjpeg_bits_dc_chrominance,
+                                  avpriv_mjpeg_val_dc, 12)) < 0)
         return ret;
 
-    if ((ret = build_vlc(&s->vlcs[2][1], avpriv_mjpeg_bits_ac_chrominance,
-                         avpriv_mjpeg_val_ac_chrominance, 251, 0, 0)) < 0)
+    if ((ret = init_huffman_table(s, 1, 0, avpriv_mjpeg_bits_ac_luminance,
+                                  avpriv_mjpeg_val_ac_luminance, 251)) < 0)
         return ret;
 
+    if ((ret = init_huffman_table(s, 1, 1, avpriv_mjpeg_bits_ac_chrominance,
+                                  avpriv_mjpeg_val_ac_chrominance, 251)) < 0)
+        return ret;
 
     return 0;
 }
@@ -221,19 +244,11 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         len -= n;
 
         /* build VLC and flush previous vlc if present */
-        ff_free_vlc(&s->vlcs[class][index]);
         av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
                class, index, code_max + 1);
-        if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+        if ((ret = init_huffman_table(s, class, index, bits_table, val_table,
+                                      code_max + 1)) < 0)
             return ret;
-
-        if (class > 0) {
-            ff_free_vlc(&s->vlcs[2][index]);
-            if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
-                return ret;
-        }
     }
     return 0;
 }
@@ -243,6 +258,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     int h_count[MAX_COMPONENTS] = { 0 };
     int v_count[MAX_COMPONENTS] = { 0 };
     int len, nb_components, i, width, height, bits, pix_fmt_id, ret;
+    ThreadFrame tframe = { .f = s->picture_ptr };
 
     /* XXX: verify len field validity */
     len     = get_bits(&s->gb, 16);
@@ -409,8 +425,8 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
         return AVERROR_BUG;
     }
 
-    av_frame_unref(s->picture_ptr);
-    if (ff_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0) {
+    ff_thread_release_buffer(s->avctx, &tframe);
+    if (ff_thread_get_buffer(s->avctx, &tframe, AV_GET_BUFFER_FLAG_REF) < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return -1;
     }
@@ -446,10 +462,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -458,46 +475,47 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int16_t *block, int *last_dc,
                         int dc_index, int ac_index, int16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * quant_matrix[0] + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = val * quant_matrix[0] + *last_dc;
+    *last_dc = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
         i += ((unsigned)code) >> 4;
             code &= 0xf;
         if (code) {
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
 
             if (i > 63) {
                 av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -507,24 +525,24 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
             block[j] = level * quant_matrix[j];
         }
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
 
-static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
-                                 int component, int dc_index,
+static int decode_dc_progressive(MJpegDecodeContext *s, GetBitContext *gb,
+                                 int16_t *block, int *last_dc, int dc_index,
                                  int16_t *quant_matrix, int Al)
 {
     int val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = (val * quant_matrix[0] << Al) + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = (val * quant_matrix[0] << Al) + *last_dc;
+    *last_dc = val;
     block[0] = val;
     return 0;
 }
@@ -735,7 +753,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int predictor,
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
                 left[i] = buffer[mb_x][i] =
-                    mask & (pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform));
+                    mask & (pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform));
             }
 
             if (s->restart_interval && !--s->restart_count) {
@@ -810,7 +828,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
 
                         if (s->interlaced && s->bottom_field)
                             ptr += linesize >> 1;
-                        *ptr = pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform);
+                        *ptr = pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform);
 
                         if (++x == h) {
                             x = 0;
@@ -839,7 +857,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                               (h * mb_x + x);
                         PREDICT(pred, ptr[-linesize - 1],
                                 ptr[-linesize], ptr[-1], predictor);
-                        *ptr = pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform);
+                        *ptr = pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform);
                         if (++x == h) {
                             x = 0;
                             y++;
@@ -856,14 +874,152 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
     return 0;
 }
 
+typedef struct MJpegScanContext {
+    int nb_components;
+    int Ah, Al;
+    uint8_t *data[MAX_COMPONENTS];
+    const uint8_t *reference_data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    /* byte offset of the entropy-coded data in the scan buffer */
+    int start;
+} MJpegScanContext;
+
+static int decode_mcu(MJpegDecodeContext *s, const MJpegScanContext *scan,
+                      GetBitContext *gb, int16_t *block, int *last_dc,
+                      int mb_x, int mb_y, int copy_mb)
+{
+    int i;
+
+    for (i = 0; i < scan->nb_components; i++) {
+        uint8_t *ptr;
+        int n, h, v, x, y, c, j;
+        int block_offset;
+        n = s->nb_blocks[i];
+        c = s->comp_index[i];
+        h = s->h_scount[i];
+        v = s->v_scount[i];
+        x = 0;
+        y = 0;
+        for (j = 0; j < n; j++) {
+            block_offset = ((scan->linesize[c] * (v * mb_y + y) * 8) +
+                            (h * mb_x + x) * 8);
+
+            if (s->interlaced && s->bottom_field)
+                block_offset += scan->linesize[c] >> 1;
+            ptr = scan->data[c] + block_offset;
+            if (!s->progressive) {
+                if (copy_mb)
+                    s->hdsp.put_pixels_tab[1][0](ptr,
+                        scan->reference_data[c] + block_offset,
+                        scan->linesize[c], 8);
+                else {
+                    s->bdsp.clear_block(block);
+                    if (decode_block(s, gb, block, &last_dc[i],
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_index[c]]) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                    s->idsp.idct_put(ptr, scan->linesize[c], block);
+                }
+            } else {
+                int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                 (h * mb_x + x);
+                int16_t *block = s->blocks[c][block_idx];
+                if (scan->Ah)
+                    block[0] += get_bits1(gb) *
+                                s->quant_matrixes[s->quant_index[c]][0] << scan->Al;
+                else if (decode_dc_progressive(s, gb, block, &last_dc[i],
+                                               s->dc_index[i],
+                                               s->quant_matrixes[s->quant_index[c]],
+                                               scan->Al) < 0) {
+                    av_log(s->avctx, AV_LOG_ERROR,
+                           "error y=%d x=%d\n", mb_y, mb_x);
+                    return AVERROR_INVALIDDATA;
+                }
+            }
+            ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+            ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                    mb_x, mb_y, x, y, c, s->bottom_field,
+                    (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+    return 0;
+}
+
+static int decode_restart_segment(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    const MJpegScanContext *scan = arg;
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    GetBitContext gb;
+    int last_dc[MAX_COMPONENTS];
+    int start = jobnr ? s->restart_offsets[jobnr - 1] : scan->start;
+    int end   = jobnr < s->nb_restart_offsets ? s->restart_offsets[jobnr] - 2
+                                              : s->gb.size_in_bits >> 3;
+    int mb    = jobnr * s->restart_interval;
+    int mb_end = FFMIN(mb + s->restart_interval, s->mb_width * s->mb_height);
+    int i, ret;
+
+    if ((ret = init_get_bits8(&gb, s->gb.buffer + start, end - start)) < 0)
+        return ret;
+
+    for (i = 0; i < scan->nb_components; i++)
+        last_dc[i] = 1024;
+
+    for (; mb < mb_end; mb++) {
+        if (get_bits_left(&gb) < 0) {
+            av_log(avctx, AV_LOG_ERROR, "overread %d\n", -get_bits_left(&gb));
+            return AVERROR_INVALIDDATA;
+        }
+        if ((ret = decode_mcu(s, scan, &gb, block, last_dc,
+                              mb % s->mb_width, mb / s->mb_width, 0)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/*
+ * Decode a scan whose restart segments have all been located while
+ * unescaping it, each segment in its own job.
+ */
+static int decode_restart_segments(MJpegDecodeContext *s,
+                                   MJpegScanContext *scan, int nb_segments)
+{
+    int i, ret;
+
+    av_fast_malloc(&s->segment_ret, &s->segment_ret_size,
+                   nb_segments * sizeof(*s->segment_ret));
+    if (!s->segment_ret)
+        return AVERROR(ENOMEM);
+
+    s->avctx->execute2(s->avctx, decode_restart_segment, scan,
+                       s->segment_ret, nb_segments);
+
+    /* the whole scan has been consumed */
+    skip_bits_long(&s->gb, get_bits_left(&s->gb));
+
+    for (i = 0; i < nb_segments; i++) {
+        ret = s->segment_ret[i];
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              const AVFrame *reference)
 {
     int i, mb_x, mb_y;
-    uint8_t *data[MAX_COMPONENTS];
-    const uint8_t *reference_data[MAX_COMPONENTS];
-    int linesize[MAX_COMPONENTS];
+    MJpegScanContext scan = { .nb_components = nb_components, .Ah = Ah, .Al = Al };
     GetBitContext mb_bitmask_gb;
 
     if (mb_bitmask)
@@ -871,15 +1027,28 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
     for (i = 0; i < nb_components; i++) {
         int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
-        reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
+        scan.data[c] = s->picture_ptr->data[c];
+        scan.reference_data[c] = reference ? reference->data[c] : NULL;
+        scan.linesize[c] = s->linesize[c];
         s->coefs_finished[c] |= 1;
     }
 
+    if (s->restart_interval && !mb_bitmask &&
+        s->avctx->active_thread_type & FF_THREAD_SLICE &&
+        s->gb.buffer == s->buffer && !(get_bits_count(&s->gb) & 7)) {
+        int nb_segments = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                          s->restart_interval;
+
+        scan.start = get_bits_count(&s->gb) >> 3;
+        if (nb_segments > 1 && s->nb_restart_offsets == nb_segments - 1 &&
+            s->restart_offsets[0] >= scan.start + 2)
+            return decode_restart_segments(s, &scan, nb_segments);
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
+            int ret;
 
             if (s->restart_interval && !s->restart_count)
                 s->restart_count = s->restart_interval;
@@ -889,64 +1058,9 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                        -get_bits_left(&s->gb));
                 return AVERROR_INVALIDDATA;
             }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = ((linesize[c] * (v * mb_y + y) * 8) +
-                                    (h * mb_x + x) * 8);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    ptr = data[c] + block_offset;
-                    if (!s->progressive) {
-                        if (copy_mb)
-                            s->hdsp.put_pixels_tab[1][0](ptr,
-                                reference_data[c] + block_offset,
-                                linesize[c], 8);
-                        else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_index[c]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            s->idsp.idct_put(ptr, linesize[c], s->block);
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_index[c]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_index[c]],
-                                                       Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR,
-                                   "error y=%d x=%d\n", mb_y, mb_x);
-                            return AVERROR_INVALIDDATA;
-                        }
-                    }
-                    ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
+            if ((ret = decode_mcu(s, &scan, &s->gb, s->block, s->last_dc,
+                                  mb_x, mb_y, copy_mb)) < 0)
+                return ret;
 
             if (s->restart_interval) {
                 s->restart_count--;
@@ -1135,6 +1249,12 @@ int ff_mjpeg_decode_sos(MJpegDecodeContext *s, const uint8_t *mb_bitmask,
         return AVERROR_PATCHWELCOME;
     }
 
+    /* Nothing the next frame depends on can change after the single
+     * interleaved scan of a baseline picture, so let it start decoding. */
+    if (!s->progressive && !s->lossless && !s->interlaced &&
+        nb_components == s->nb_components)
+        ff_thread_finish_setup(s->avctx);
+
 next_field:
     for (i = 0; i < nb_components; i++)
         s->last_dc[i] = 1024;
@@ -1397,6 +1517,23 @@ found:
     return val;
 }
 
+static void add_restart_offset(MJpegDecodeContext *s, int offset)
+{
+    int *offsets;
+
+    if (s->nb_restart_offsets < 0)
+        return;
+
+    offsets = av_fast_realloc(s->restart_offsets, &s->restart_offsets_size,
+                              (s->nb_restart_offsets + 1) * sizeof(*offsets));
+    if (!offsets) {
+        s->nb_restart_offsets = -1;
+        return;
+    }
+    s->restart_offsets = offsets;
+    s->restart_offsets[s->nb_restart_offsets++] = offset;
+}
+
 int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                          const uint8_t **buf_ptr, const uint8_t *buf_end,
                          const uint8_t **unescaped_buf_ptr,
@@ -1404,6 +1541,7 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
 {
     int start_code;
     start_code = find_marker(buf_ptr, buf_end);
+    s->nb_restart_offsets = 0;
 
     av_fast_padded_malloc(&s->buffer, &s->buffer_size, buf_end - *buf_ptr);
     if (!s->buffer)
@@ -1423,9 +1561,10 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        add_restart_offset(s, dst - s->buffer);
+                    } else if (x)
                         break;
                 }
             }
@@ -1704,6 +1843,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_free(s->buffer);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_offsets);
+    av_freep(&s->segment_ret);
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -1716,6 +1857,79 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     return 0;
 }
 
+#if HAVE_THREADS
+static av_cold int mjpeg_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    int i;
+
+    s->picture     = NULL;
+    s->picture_ptr = NULL;
+    s->ljpeg_buffer         = NULL;
+    s->ljpeg_buffer_size    = 0;
+    s->restart_offsets      = NULL;
+    s->restart_offsets_size = 0;
+    s->segment_ret          = NULL;
+    s->segment_ret_size     = 0;
+    memset(s->vlcs, 0, sizeof(s->vlcs));
+    for (i = 0; i < MAX_COMPONENTS; i++) {
+        s->blocks[i]   = NULL;
+        s->last_nnz[i] = NULL;
+    }
+
+    return ff_mjpeg_decode_init(avctx);
+}
+
+static int mjpeg_update_thread_context(AVCodecContext *dst,
+                                       const AVCodecContext *src)
+{
+    MJpegDecodeContext *s = dst->priv_data, *s1 = src->priv_data;
+    int class, index, ret;
+
+    if (dst == src)
+        return 0;
+
+    for (class = 0; class < 2; class++) {
+        for (index = 0; index < 4; index++) {
+            if (!s1->huff_nb_codes[class][index] ||
+                (s->huff_nb_codes[class][index] == s1->huff_nb_codes[class][index] &&
+                 !memcmp(s->huff_bits[class][index], s1->huff_bits[class][index],
+                         sizeof(s->huff_bits[class][index])) &&
+                 !memcmp(s->huff_vals[class][index], s1->huff_vals[class][index],
+                         sizeof(s->huff_vals[class][index]))))
+                continue;
+            ret = init_huffman_table(s, class, index,
+                                     s1->huff_bits[class][index],
+                                     s1->huff_vals[class][index],
+                                     s1->huff_nb_codes[class][index]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    memcpy(s->quant_matrixes, s1->quant_matrixes, sizeof(s->quant_matrixes));
+    memcpy(s->qscale,         s1->qscale,         sizeof(s->qscale));
+    memcpy(s->h_count,        s1->h_count,        sizeof(s->h_count));
+    memcpy(s->v_count,        s1->v_count,        sizeof(s->v_count));
+
+    s->width              = s1->width;
+    s->height             = s1->height;
+    s->bits               = s1->bits;
+    s->first_picture      = s1->first_picture;
+    s->interlaced         = s1->interlaced;
+    s->bottom_field       = s1->bottom_field;
+    s->restart_interval   = s1->restart_interval;
+    s->buggy_avid         = s1->buggy_avid;
+    s->cs_itu601          = s1->cs_itu601;
+    s->flipped            = s1->flipped;
+    s->rgb                = s1->rgb;
+    s->pegasus_rct        = s1->pegasus_rct;
+    s->interlace_polarity = s1->interlace_polarity;
+
+    return 0;
+}
+#endif
+
 #define OFFSET(x) offsetof(MJpegDecodeContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
 static const AVOption options[] = {
@@ -1740,7 +1954,10 @@ AVCodec ff_mjpeg_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_FRAME_THREADS,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(mjpeg_decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mjpeg_update_thread_context),
     .priv_class     = &mjpegdec_class,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
 };
@@ -51,6 +51,10 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    /* Huffman tables the VLCs were built from, kept to set up frame threads */
+    uint8_t huff_bits[2][4][17];
+    uint8_t huff_vals[2][4][256];
+    int huff_nb_codes[2][4];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -102,6 +106,14 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    /* offsets in the unescaped scan buffer of the data following each RSTn
+     * marker, used to decode the restart segments in parallel;
+     * nb_restart_offsets is -1 if they could not be recorded */
+    int *restart_offsets;
+    unsigned int restart_offsets_size;
+    int nb_restart_offsets;
+    int *segment_ret;
+    unsigned int segment_ret_size;
 
     int buggy_avid;
     int cs_itu601;
@@ -192,6 +192,7 @@ int avcodec_copy_context(AVCodecContext *dest, const AVCodecContext *src)
     dest->rc_override     = NULL;
     dest->subtitle_header = NULL;
     dest->hw_frames_ctx   = NULL;
+    dest->buffer_pool_set = NULL;
 
 #define alloc_and_copy_or_fail(obj, size, pad) \
     if (src->obj && size > 0) { \
@@ -217,6 +218,12 @@ int avcodec_copy_context(AVCodecContext *dest, const AVCodecContext *src)
             goto fail;
     }
 
+    if (src->buffer_pool_set) {
+        dest->buffer_pool_set = av_buffer_ref(src->buffer_pool_set);
+        if (!dest->buffer_pool_set)
+            goto fail;
+    }
+
     return 0;
 
 fail:
@@ -226,6 +233,7 @@ fail:
     av_freep(&dest->inter_matrix);
     av_freep(&dest->extradata);
     av_buffer_unref(&dest->hw_frames_ctx);
+    av_buffer_unref(&dest->buffer_pool_set);
     return AVERROR(ENOMEM);
 }
 #endif
@@ -28,6 +28,7 @@
 #include "internal.h"
 #include "png.h"
 #include "pngdsp.h"
+#include "thread.h"
 
 /* TODO:
  * - add 2, 4 and 16 bit depth support
@@ -39,7 +40,8 @@ typedef struct PNGDecContext {
     PNGDSPContext dsp;
 
     GetByteContext gb;
-    AVFrame *prev;
+    ThreadFrame picture;
+    ThreadFrame last_picture;
 
     int state;
     int width, height;
@@ -412,9 +414,10 @@ static int decode_frame(AVCodecContext *avctx,
     PNGDecContext *const s = avctx->priv_data;
     const uint8_t *buf     = avpkt->data;
     int buf_size           = avpkt->size;
-    AVFrame *p             = data;
+    AVFrame *p             = NULL;
     uint8_t *crow_buf_base = NULL;
     uint32_t tag, length;
+    int stereo_mode        = -1;
     int ret;
 
     /* check signature */
@@ -530,10 +533,17 @@ static int decode_frame(AVCodecContext *avctx,
                     goto fail;
                 }
 
-                if (ff_get_buffer(avctx, p, AV_GET_BUFFER_FLAG_REF) < 0) {
+                /* the header is valid, the previous picture becomes the
+                 * reference for this one */
+                FFSWAP(ThreadFrame, s->picture, s->last_picture);
+                ff_thread_release_buffer(avctx, &s->picture);
+                if (ff_thread_get_buffer(avctx, &s->picture,
+                                         AV_GET_BUFFER_FLAG_REF) < 0) {
                     av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
+                    FFSWAP(ThreadFrame, s->picture, s->last_picture);
                     goto fail;
                 }
+                p = s->picture.f;
                 p->pict_type        = AV_PICTURE_TYPE_I;
                 p->key_frame        = 1;
                 p->interlaced_frame = !!s->interlace_type;
@@ -555,6 +565,10 @@ static int decode_frame(AVCodecContext *avctx,
                 /* copy the palette if needed */
                 if (s->color_type == PNG_COLOR_TYPE_PALETTE)
                     memcpy(p->data[1], s->palette, 256 * sizeof(uint32_t));
+                /* nothing past this point affects the following frames,
+                 * except for the inter prediction handled through the
+                 * frame progress */
+                ff_thread_finish_setup(avctx);
                 /* empty row is used if differencing to the first row */
                 s->last_row = av_mallocz(s->row_size);
                 if (!s->last_row)
@@ -584,7 +598,8 @@ static int decode_frame(AVCodecContext *avctx,
         {
             int n, i, r, g, b;
 
-            if ((length % 3) != 0 || length > 256 * 3)
+            if ((length % 3) != 0 || length > 256 * 3 ||
+                (s->state & PNG_IDAT))
                 goto skip_tag;
             /* read the palette */
             n = length / 3;
@@ -607,7 +622,7 @@ static int decode_frame(AVCodecContext *avctx,
             /* read the transparency. XXX: Only palette mode supported */
             if (s->color_type != PNG_COLOR_TYPE_PALETTE ||
                 length > 256 ||
-                !(s->state & PNG_PLTE))
+                !(s->state & PNG_PLTE) || (s->state & PNG_IDAT))
                 goto skip_tag;
             for (i = 0; i < length; i++) {
                 v = bytestream2_get_byte(&s->gb);
@@ -618,13 +633,11 @@ static int decode_frame(AVCodecContext *avctx,
         break;
         case MKTAG('s', 'T', 'E', 'R'): {
             int mode = bytestream2_get_byte(&s->gb);
-            AVStereo3D *stereo3d = av_stereo3d_create_side_data(p);
-            if (!stereo3d)
-                goto the_end;
 
+            /* the chunk precedes the image data, the side data is attached
+             * once the picture is allocated */
             if (mode == 0 || mode == 1) {
-                stereo3d->type  = AV_STEREO3D_SIDEBYSIDE;
-                stereo3d->flags = mode ? 0 : AV_STEREO3D_FLAG_INVERT;
+                stereo_mode = mode;
             } else {
                  av_log(avctx, AV_LOG_WARNING,
                         "Unknown value in sTER chunk (%d)\n", mode);
@@ -646,23 +659,38 @@ skip_tag:
     }
 exit_loop:
     /* handle P-frames only if a predecessor frame is available */
-    if (s->prev->data[0]) {
+    if (s->last_picture.f->data[0] &&
+        s->last_picture.f->width  == p->width  &&
+        s->last_picture.f->height == p->height &&
+        s->last_picture.f->format == p->format) {
         if (!(avpkt->flags & AV_PKT_FLAG_KEY)) {
             int i, j;
             uint8_t *pd      = p->data[0];
-            uint8_t *pd_last = s->prev->data[0];
+            uint8_t *pd_last = s->last_picture.f->data[0];
+            int linesize_last = s->last_picture.f->linesize[0];
 
+            ff_thread_await_progress(&s->last_picture, INT_MAX, 0);
             for (j = 0; j < s->height; j++) {
                 for (i = 0; i < s->width * s->bpp; i++)
                     pd[i] += pd_last[i];
                 pd      += s->image_linesize;
-                pd_last += s->image_linesize;
+                pd_last += linesize_last;
             }
         }
     }
+    ff_thread_report_progress(&s->picture, INT_MAX, 0);
 
-    av_frame_unref(s->prev);
-    if ((ret = av_frame_ref(s->prev, p)) < 0)
+    if (stereo_mode >= 0) {
+        AVStereo3D *stereo3d = av_stereo3d_create_side_data(p);
+        if (!stereo3d) {
+            ret = AVERROR(ENOMEM);
+            goto the_end;
+        }
+        stereo3d->type  = AV_STEREO3D_SIDEBYSIDE;
+        stereo3d->flags = stereo_mode ? 0 : AV_STEREO3D_FLAG_INVERT;
+    }
+
+    if ((ret = av_frame_ref(data, p)) < 0)
         goto fail;
 
     *got_frame = 1;
@@ -676,30 +704,81 @@ the_end:
     av_freep(&s->tmp_row);
     return ret;
 fail:
+    /* before p is set, s->picture still is a picture decoded earlier,
+     * whose progress was already reported */
+    if (p)
+        ff_thread_report_progress(&s->picture, INT_MAX, 0);
     ret = -1;
     goto the_end;
 }
 
+#if HAVE_THREADS
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    PNGDecContext *psrc = src->priv_data;
+    PNGDecContext *pdst = dst->priv_data;
+    int ret;
+
+    if (dst == src)
+        return 0;
+
+    ff_thread_release_buffer(dst, &pdst->picture);
+    if (psrc->picture.f->data[0] &&
+        (ret = ff_thread_ref_frame(&pdst->picture, &psrc->picture)) < 0)
+        return ret;
+
+    memcpy(pdst->palette, psrc->palette, sizeof(pdst->palette));
+
+    return 0;
+}
+#endif
+
 static av_cold int png_dec_init(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
 
     avctx->color_range = AVCOL_RANGE_JPEG;
 
-    s->prev = av_frame_alloc();
-    if (!s->prev)
+    s->picture.f      = av_frame_alloc();
+    s->last_picture.f = av_frame_alloc();
+    if (!s->picture.f || !s->last_picture.f) {
+        av_frame_free(&s->picture.f);
+        av_frame_free(&s->last_picture.f);
         return AVERROR(ENOMEM);
+    }
+
+    avctx->internal->allocate_progress = 1;
 
     ff_pngdsp_init(&s->dsp);
 
     return 0;
 }
 
+#if HAVE_THREADS
+static av_cold int png_dec_init_thread_copy(AVCodecContext *avctx)
+{
+    PNGDecContext *s = avctx->priv_data;
+
+    s->picture.f      = av_frame_alloc();
+    s->last_picture.f = av_frame_alloc();
+    if (!s->picture.f || !s->last_picture.f) {
+        av_frame_free(&s->picture.f);
+        av_frame_free(&s->last_picture.f);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+#endif
+
 static av_cold int png_dec_end(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
 
-    av_frame_free(&s->prev);
+    ff_thread_release_buffer(avctx, &s->last_picture);
+    av_frame_free(&s->last_picture.f);
+    ff_thread_release_buffer(avctx, &s->picture);
+    av_frame_free(&s->picture.f);
 
     return 0;
 }
@@ -713,6 +792,8 @@ AVCodec ff_png_decoder = {
     .init           = png_dec_init,
     .close          = png_dec_end,
     .decode         = decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1 /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(png_dec_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
 };
@@ -25,6 +25,7 @@
 #include "avcodec.h"
 #include "bytestream.h"
 #include "huffyuvencdsp.h"
+#include "internal.h"
 #include "png.h"
 
 /* TODO:
@@ -35,6 +36,32 @@
 
 #define IOBUF_SIZE 4096
 
+/* deflate window, and so the largest useful preset dictionary */
+#define WINDOW_SIZE 32768
+
+/* minimum number of rows in a band encoded in parallel */
+#define BAND_MIN_ROWS 16
+
+/**
+ * Horizontal band of the image, filtered and deflated independently.
+ * All the bands but the last end with a sync flush and each uses the
+ * tail of the previous band as preset dictionary, so that their
+ * concatenation is a single valid zlib stream.
+ */
+typedef struct PNGEncBand {
+    int y_start, y_end;
+
+    uint8_t *crow_base;
+    unsigned int crow_base_size;
+    uint8_t *rgba_buf[2];
+    unsigned int rgba_buf_size[2];
+
+    uint8_t *out;
+    unsigned int out_size;
+    int out_len;
+    uLong adler;
+} PNGEncBand;
+
 typedef struct PNGEncContext {
     AVClass *class;
     HuffYUVEncDSPContext hdsp;
@@ -47,6 +74,19 @@ typedef struct PNGEncContext {
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
+
+    PNGEncBand *bands;
+    int *band_ret;
+    int nb_bands;
+
+    /* state of the frame being encoded in bands */
+    const AVFrame *frame;
+    int color_type;
+    int bits_per_pixel;
+    int row_size;
+    int compression_level;
+    uint8_t *filtered;
+    unsigned int filtered_size;
 } PNGEncContext;
 
 static void png_get_interlaced_row(uint8_t *dst, int row_size,
@@ -233,6 +273,167 @@ static int png_write_row(PNGEncContext *s, const uint8_t *data, int size)
     return 0;
 }
 
+static int png_filter_band(AVCodecContext *avctx, void *arg,
+                           int jobnr, int threadnr)
+{
+    PNGEncContext *s   = avctx->priv_data;
+    PNGEncBand *band   = &s->bands[jobnr];
+    const AVFrame *p   = s->frame;
+    int bpp            = s->bits_per_pixel >> 3;
+    int stride         = s->row_size + 1;
+    uint8_t *top       = NULL;
+    uint8_t *ptr, *crow_buf, *crow;
+    int y;
+
+    av_fast_malloc(&band->crow_base, &band->crow_base_size,
+                   (s->row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+    if (!band->crow_base)
+        return AVERROR(ENOMEM);
+    // pixel data should be aligned, but there's a control byte before it
+    crow_buf = band->crow_base + 15;
+
+    if (s->color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+        av_fast_malloc(&band->rgba_buf[0], &band->rgba_buf_size[0], s->row_size + 1);
+        av_fast_malloc(&band->rgba_buf[1], &band->rgba_buf_size[1], s->row_size + 1);
+        if (!band->rgba_buf[0] || !band->rgba_buf[1])
+            return AVERROR(ENOMEM);
+    }
+
+    /* the first row is predicted from the last row of the previous band */
+    if (band->y_start > 0) {
+        top = p->data[0] + (band->y_start - 1) * p->linesize[0];
+        if (s->color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+            convert_from_rgb32(band->rgba_buf[0], top, avctx->width);
+            top = band->rgba_buf[0];
+        }
+    }
+
+    for (y = band->y_start; y < band->y_end; y++) {
+        ptr = p->data[0] + y * p->linesize[0];
+        if (s->color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+            FFSWAP(uint8_t *, band->rgba_buf[0], band->rgba_buf[1]);
+            convert_from_rgb32(band->rgba_buf[0], ptr, avctx->width);
+            ptr = band->rgba_buf[0];
+        }
+        crow = png_choose_filter(s, crow_buf, ptr, top, s->row_size, bpp);
+        memcpy(s->filtered + y * stride, crow, stride);
+        top = ptr;
+    }
+
+    return 0;
+}
+
+static int png_deflate_band(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    PNGEncContext *s   = avctx->priv_data;
+    PNGEncBand *band   = &s->bands[jobnr];
+    int last           = jobnr == s->nb_bands - 1;
+    int stride         = s->row_size + 1;
+    uint8_t *src       = s->filtered + band->y_start * stride;
+    int size           = (band->y_end - band->y_start) * stride;
+    /* room for the zlib header in the first band, trailer in the last */
+    int header         = jobnr ? 0 : 2;
+    int trailer        = last  ? 4 : 0;
+    z_stream zstream   = { 0 };
+    int ret;
+
+    zstream.zalloc = ff_png_zalloc;
+    zstream.zfree  = ff_png_zfree;
+    zstream.opaque = NULL;
+    ret = deflateInit2(&zstream, s->compression_level,
+                       Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK)
+        return AVERROR_UNKNOWN;
+
+    if (jobnr) {
+        int dict_size = FFMIN(src - s->filtered, WINDOW_SIZE);
+        deflateSetDictionary(&zstream, src - dict_size, dict_size);
+    }
+
+    /* the sync flush marker is not accounted for in deflateBound() */
+    av_fast_malloc(&band->out, &band->out_size,
+                   header + deflateBound(&zstream, size) + 16 + trailer);
+    if (!band->out) {
+        deflateEnd(&zstream);
+        return AVERROR(ENOMEM);
+    }
+
+    zstream.next_in   = src;
+    zstream.avail_in  = size;
+    zstream.next_out  = band->out + header;
+    zstream.avail_out = band->out_size - header - trailer;
+    ret = deflate(&zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    band->out_len = band->out_size - trailer - zstream.avail_out;
+    deflateEnd(&zstream);
+    if (ret != (last ? Z_STREAM_END : Z_OK) ||
+        zstream.avail_in || !zstream.avail_out)
+        return AVERROR_UNKNOWN;
+
+    band->adler = adler32(adler32(0, Z_NULL, 0), src, size);
+
+    return 0;
+}
+
+/**
+ * Filter and deflate the rows of a non-interlaced image in parallel
+ * bands, and write the resulting zlib stream as IDAT chunks.
+ */
+static int png_encode_bands(AVCodecContext *avctx, const AVFrame *p)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int stride       = s->row_size + 1;
+    unsigned header;
+    uLong adler;
+    int i;
+
+    av_fast_malloc(&s->filtered, &s->filtered_size,
+                   avctx->height * stride);
+    if (!s->filtered)
+        return AVERROR(ENOMEM);
+    s->frame = p;
+
+    avctx->execute2(avctx, png_filter_band, NULL, s->band_ret, s->nb_bands);
+    for (i = 0; i < s->nb_bands; i++)
+        if (s->band_ret[i] < 0)
+            return s->band_ret[i];
+
+    avctx->execute2(avctx, png_deflate_band, NULL, s->band_ret, s->nb_bands);
+    for (i = 0; i < s->nb_bands; i++)
+        if (s->band_ret[i] < 0)
+            return s->band_ret[i];
+
+    /* zlib header, with the level hint deflate would have written */
+    header = (Z_DEFLATED + ((15 - 8) << 4)) << 8;
+    if (s->compression_level == Z_DEFAULT_COMPRESSION ||
+        s->compression_level == 6)
+        header |= 2 << 6;
+    else if (s->compression_level >= 7)
+        header |= 3 << 6;
+    else if (s->compression_level >= 2)
+        header |= 1 << 6;
+    header += 31 - header % 31;
+    AV_WB16(s->bands[0].out, header);
+
+    adler = s->bands[0].adler;
+    for (i = 1; i < s->nb_bands; i++)
+        adler = adler32_combine(adler, s->bands[i].adler,
+                                (s->bands[i].y_end - s->bands[i].y_start) * stride);
+    AV_WB32(s->bands[s->nb_bands - 1].out +
+            s->bands[s->nb_bands - 1].out_len, adler);
+    s->bands[s->nb_bands - 1].out_len += 4;
+
+    for (i = 0; i < s->nb_bands; i++) {
+        PNGEncBand *band = &s->bands[i];
+        if (s->bytestream_end - s->bytestream <= band->out_len + 100)
+            return AVERROR_BUG;
+        png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'),
+                        band->out, band->out_len);
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -241,7 +442,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     const AVFrame *const p = pict;
     int bit_depth, color_type, y, len, row_size, ret, is_progressive;
     int bits_per_pixel, pass_row_size, enc_row_size, max_packet_size;
-    int compression_level;
+    int compression_level, banded;
     uint8_t *ptr, *top, *crow_buf, *crow;
     uint8_t *crow_base       = NULL;
     uint8_t *progressive_buf = NULL;
@@ -249,6 +450,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     uint8_t *top_buf         = NULL;
 
     is_progressive = !!(avctx->flags & AV_CODEC_FLAG_INTERLACED_DCT);
+    banded         = !is_progressive && s->nb_bands > 1;
     switch (avctx->pix_fmt) {
     case AV_PIX_FMT_RGBA64BE:
         bit_depth = 16;
@@ -303,6 +505,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     max_packet_size = avctx->height * (enc_row_size +
                                        ((enc_row_size + IOBUF_SIZE - 1) / IOBUF_SIZE) * 12)
                       + AV_INPUT_BUFFER_MIN_SIZE;
+    /* flush marker and chunk overhead of each band */
+    if (banded)
+        max_packet_size += s->nb_bands * 32;
     if (!pkt->data &&
         (ret = av_new_packet(pkt, max_packet_size)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "Could not allocate output packet of size %d.\n",
@@ -425,6 +630,14 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                     }
             }
         }
+    } else if (banded) {
+        s->color_type        = color_type;
+        s->bits_per_pixel    = bits_per_pixel;
+        s->row_size          = row_size;
+        s->compression_level = compression_level;
+        ret = png_encode_bands(avctx, p);
+        if (ret < 0)
+            goto the_end;
     } else {
         top = NULL;
         for (y = 0; y < avctx->height; y++) {
@@ -440,8 +653,8 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             top = ptr;
         }
     }
-    /* compress last bytes */
-    for (;;) {
+    /* compress last bytes, the bands are terminated on their own */
+    while (!banded) {
         ret = deflate(&s->zstream, Z_FINISH);
         if (ret == Z_OK || ret == Z_STREAM_END) {
             len = IOBUF_SIZE - s->zstream.avail_out;
@@ -500,6 +713,43 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (avctx->pix_fmt == AV_PIX_FMT_MONOBLACK)
         s->filter_type = PNG_FILTER_VALUE_NONE;
 
+    /* split the image in the requested number of bands, encoded in
+     * parallel with slice threading; the output does not depend on the
+     * number of threads */
+    s->nb_bands = av_clip(avctx->slices, 1, FFMAX(avctx->height / BAND_MIN_ROWS, 1));
+
+    if (s->nb_bands > 1) {
+        int i;
+
+        s->bands    = av_mallocz_array(s->nb_bands, sizeof(*s->bands));
+        s->band_ret = av_malloc_array(s->nb_bands, sizeof(*s->band_ret));
+        if (!s->bands || !s->band_ret)
+            return AVERROR(ENOMEM);
+
+        for (i = 0; i < s->nb_bands; i++) {
+            s->bands[i].y_start = avctx->height *  i      / s->nb_bands;
+            s->bands[i].y_end   = avctx->height * (i + 1) / s->nb_bands;
+        }
+    }
+
+    return 0;
+}
+
+static av_cold int png_enc_close(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_bands && s->bands; i++) {
+        av_freep(&s->bands[i].crow_base);
+        av_freep(&s->bands[i].rgba_buf[0]);
+        av_freep(&s->bands[i].rgba_buf[1]);
+        av_freep(&s->bands[i].out);
+    }
+    av_freep(&s->bands);
+    av_freep(&s->band_ret);
+    av_freep(&s->filtered);
+
     return 0;
 }
 
@@ -531,7 +781,10 @@ AVCodec ff_png_encoder = {
     .priv_data_size = sizeof(PNGEncContext),
     .priv_class     = &png_class,
     .init           = png_enc_init,
+    .close          = png_enc_close,
     .encode2        = encode_frame,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGB32, AV_PIX_FMT_PAL8, AV_PIX_FMT_GRAY8,
         AV_PIX_FMT_RGBA64BE, AV_PIX_FMT_RGB48BE, AV_PIX_FMT_GRAY16BE,
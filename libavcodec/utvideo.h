@@ -83,6 +83,10 @@ typedef struct UtvideoContext {
     ptrdiff_t slice_stride;
     uint8_t *slice_bits, *slice_buffer[4];
     int      slice_bits_size;
+
+    uint8_t  *pred_buffer[4];
+    uint64_t (*slice_counts)[256];
+    uint32_t *slice_sizes;
 } UtvideoContext;
 
 typedef struct HuffEntry {
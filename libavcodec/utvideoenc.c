@@ -38,6 +38,16 @@
 #include "utvideo.h"
 #include "huffman.h"
 
+typedef struct UtvideoEncPlane {
+    uint8_t  *src;
+    uint8_t  *dst;
+    ptrdiff_t stride;
+    int       width, height;
+    int       fill;       ///< symbol used for the whole plane, or -1
+    uint8_t   lengths[256];
+    HuffEntry he[256];
+} UtvideoEncPlane;
+
 /* Compare huffentry symbols */
 static int huff_cmp_sym(const void *a, const void *b)
 {
@@ -51,8 +61,12 @@ static av_cold int utvideo_encode_close(AVCodecContext *avctx)
     int i;
 
     av_freep(&c->slice_bits);
-    for (i = 0; i < 4; i++)
+    av_freep(&c->slice_counts);
+    av_freep(&c->slice_sizes);
+    for (i = 0; i < 4; i++) {
         av_freep(&c->slice_buffer[i]);
+        av_freep(&c->pred_buffer[i]);
+    }
 
     return 0;
 }
@@ -173,10 +187,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
     for (i = 0; i < c->planes; i++) {
-        c->slice_buffer[i] = av_malloc(c->slice_stride * (avctx->height + 2) +
-                                       AV_INPUT_BUFFER_PADDING_SIZE);
-        if (!c->slice_buffer[i]) {
-            av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+        if (original_format == UTVIDEO_RGB || original_format == UTVIDEO_RGBA) {
+            c->slice_buffer[i] = av_malloc(c->slice_stride * (avctx->height + 2) +
+                                           AV_INPUT_BUFFER_PADDING_SIZE);
+            if (!c->slice_buffer[i]) {
+                av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 1.\n");
+                utvideo_encode_close(avctx);
+                return AVERROR(ENOMEM);
+            }
+        }
+
+        c->pred_buffer[i] = av_malloc(c->slice_stride * avctx->height +
+                                      AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!c->pred_buffer[i]) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot allocate prediction buffer.\n");
             utvideo_encode_close(avctx);
             return AVERROR(ENOMEM);
         }
@@ -215,6 +239,16 @@ FF_ENABLE_DEPRECATION_WARNINGS
         c->slices = avctx->slices;
     }
 
+    /* Per-slice symbol counts and coded sizes, for every plane */
+    c->slice_counts = av_malloc_array(c->planes * c->slices,
+                                      sizeof(*c->slice_counts));
+    c->slice_sizes  = av_malloc_array(c->planes * c->slices,
+                                      sizeof(*c->slice_sizes));
+    if (!c->slice_counts || !c->slice_sizes) {
+        utvideo_encode_close(avctx);
+        return AVERROR(ENOMEM);
+    }
+
     /* Set compression mode */
     c->compression = COMP_HUFF;
 
@@ -387,149 +421,183 @@ static int write_huff_codes(uint8_t *src, uint8_t *dst, int dst_size,
     return count;
 }
 
-static int encode_plane(AVCodecContext *avctx, uint8_t *src,
-                        uint8_t *dst, ptrdiff_t stride,
-                        int width, int height, PutByteContext *pb)
+/*
+ * Each plane is coded as c->slices independent slices. The coded data
+ * of the slices of a plane is kept in one region of c->slice_bits,
+ * each slice starting on a 16-byte boundary.
+ */
+static uint8_t *slice_bits_ptr(UtvideoContext *c, int plane, int slice,
+                               int sstart)
 {
-    UtvideoContext *c        = avctx->priv_data;
-    uint8_t  lengths[256];
-    uint64_t counts[256]     = { 0 };
+    size_t plane_size = c->slice_stride * c->avctx->height + 16 * c->slices;
 
-    HuffEntry he[256];
+    return c->slice_bits + plane * plane_size +
+           sstart * c->slice_stride + 16 * slice;
+}
 
-    uint32_t offset = 0, slice_len = 0;
-    int      i, sstart, send = 0;
-    int      symbol;
+static int mangle_rgb_slice(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    const AVFrame *pic = arg;
+    int sstart = avctx->height * jobnr / c->slices;
+    int send   = avctx->height * (jobnr + 1) / c->slices;
+    uint8_t *dst[4];
+    int i;
+
+    for (i = 0; i < c->planes; i++)
+        dst[i] = c->slice_buffer[i] + sstart * c->slice_stride;
+
+    mangle_rgb_planes(dst, c->slice_stride,
+                      pic->data[0] + sstart * pic->linesize[0], c->planes,
+                      pic->linesize[0], avctx->width, send - sstart);
+
+    return 0;
+}
+
+/* Do prediction for one slice of a plane and count its symbols */
+static int predict_slice(AVCodecContext *avctx, void *arg,
+                         int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    UtvideoEncPlane *p = (UtvideoEncPlane *)arg + jobnr / c->slices;
+    int slice  = jobnr % c->slices;
+    int sstart = p->height * slice / c->slices;
+    int send   = p->height * (slice + 1) / c->slices;
+    uint8_t *src = p->src + sstart * p->stride;
+    uint8_t *dst = p->dst + sstart * p->width;
 
-    /* Do prediction / make planes */
     switch (c->frame_pred) {
     case PRED_NONE:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            av_image_copy_plane(dst + sstart * width, width,
-                                src + sstart * stride, stride,
-                                width, send - sstart);
-        }
+        av_image_copy_plane(dst, p->width, src, p->stride,
+                            p->width, send - sstart);
         break;
     case PRED_LEFT:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            left_predict(src + sstart * stride, dst + sstart * width,
-                         stride, width, send - sstart);
-        }
+        left_predict(src, dst, p->stride, p->width, send - sstart);
         break;
     case PRED_MEDIAN:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            median_predict(c, src + sstart * stride, dst + sstart * width,
-                           stride, width, send - sstart);
-        }
+        median_predict(c, src, dst, p->stride, p->width, send - sstart);
         break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown prediction mode: %d\n",
-               c->frame_pred);
-        return AVERROR_OPTION_NOT_FOUND;
     }
 
-    /* Count the usage of values */
-    count_usage(dst, width, height, counts);
+    memset(c->slice_counts[jobnr], 0, sizeof(*c->slice_counts));
+    count_usage(dst, p->width, send - sstart, c->slice_counts[jobnr]);
+
+    return 0;
+}
+
+/* Write the huffman codes of one slice of a plane */
+static int write_huff_slice(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    UtvideoContext *c  = avctx->priv_data;
+    int plane          = jobnr / c->slices;
+    UtvideoEncPlane *p = (UtvideoEncPlane *)arg + plane;
+    int slice  = jobnr % c->slices;
+    int sstart = p->height * slice / c->slices;
+    int send   = p->height * (slice + 1) / c->slices;
+    uint8_t *bits = slice_bits_ptr(c, plane, slice, sstart);
+    uint32_t size;
+
+    if (p->fill >= 0)
+        return 0;
+
+    /* Get the offset in bits and convert to bytes */
+    size = write_huff_codes(p->dst + sstart * p->width, bits,
+                            p->width * (send - sstart) + 4, p->width,
+                            send - sstart, p->he) >> 3;
+
+    /* Byteswap the written huffman codes */
+    c->bdsp.bswap_buf((uint32_t *) bits, (uint32_t *) bits, size >> 2);
+
+    c->slice_sizes[jobnr] = size;
+
+    return 0;
+}
+
+/* Build the huffman table of a plane from its slices' symbol counts */
+static void build_plane_table(UtvideoContext *c, UtvideoEncPlane *p,
+                              int plane)
+{
+    uint64_t counts[256] = { 0 };
+    int i, j, symbol;
+
+    for (i = 0; i < c->slices; i++)
+        for (j = 0; j < 256; j++)
+            counts[j] += c->slice_counts[plane * c->slices + i][j];
 
     /* Check for a special case where only one symbol was used */
+    p->fill = -1;
     for (symbol = 0; symbol < 256; symbol++) {
         /* If non-zero count is found, see if it matches width * height */
         if (counts[symbol]) {
-            /* Special case if only one symbol was used */
-            if (counts[symbol] == width * height) {
-                /*
-                 * Write a zero for the single symbol
-                 * used in the plane, else 0xFF.
-                 */
-                for (i = 0; i < 256; i++) {
-                    if (i == symbol)
-                        bytestream2_put_byte(pb, 0);
-                    else
-                        bytestream2_put_byte(pb, 0xFF);
-                }
-
-                /* Write zeroes for lengths */
-                for (i = 0; i < c->slices; i++)
-                    bytestream2_put_le32(pb, 0);
-
-                /* And that's all for that plane folks */
-                return 0;
+            if (counts[symbol] == p->width * p->height) {
+                p->fill = symbol;
+                return;
             }
             break;
         }
     }
 
     /* Calculate huffman lengths */
-    ff_huff_gen_len_table(lengths, counts);
+    ff_huff_gen_len_table(p->lengths, counts);
 
-    /*
-     * Write the plane's header into the output packet:
-     * - huffman code lengths (256 bytes)
-     * - slice end offsets (gotten from the slice lengths)
-     */
     for (i = 0; i < 256; i++) {
-        bytestream2_put_byte(pb, lengths[i]);
-
-        he[i].len = lengths[i];
-        he[i].sym = i;
+        p->he[i].len = p->lengths[i];
+        p->he[i].sym = i;
     }
 
     /* Calculate the huffman codes themselves */
-    calculate_codes(he);
+    calculate_codes(p->he);
+}
 
-    send = 0;
-    for (i = 0; i < c->slices; i++) {
-        sstart  = send;
-        send    = height * (i + 1) / c->slices;
+static void write_plane(UtvideoContext *c, UtvideoEncPlane *p, int plane,
+                        PutByteContext *pb)
+{
+    uint32_t offset = 0;
+    int i, sstart;
 
+    if (p->fill >= 0) {
         /*
-         * Write the huffman codes to a buffer,
-         * get the offset in bits and convert to bytes.
+         * Write a zero for the single symbol
+         * used in the plane, else 0xFF.
          */
-        offset += write_huff_codes(dst + sstart * width, c->slice_bits,
-                                   width * (send - sstart), width,
-                                   send - sstart, he) >> 3;
-
-        slice_len = offset - slice_len;
+        for (i = 0; i < 256; i++)
+            bytestream2_put_byte(pb, i == p->fill ? 0 : 0xFF);
 
-        /* Byteswap the written huffman codes */
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          slice_len >> 2);
-
-        /* Write the offset to the stream */
-        bytestream2_put_le32(pb, offset);
+        /* Write zeroes for lengths */
+        for (i = 0; i < c->slices; i++)
+            bytestream2_put_le32(pb, 0);
 
-        /* Seek to the data part of the packet */
-        bytestream2_seek_p(pb, 4 * (c->slices - i - 1) +
-                           offset - slice_len, SEEK_CUR);
-
-        /* Write the slices' data into the output packet */
-        bytestream2_put_buffer(pb, c->slice_bits, slice_len);
+        return;
+    }
 
-        /* Seek back to the slice offsets */
-        bytestream2_seek_p(pb, -4 * (c->slices - i - 1) - offset,
-                           SEEK_CUR);
+    /*
+     * Write the plane's header into the output packet:
+     * - huffman code lengths (256 bytes)
+     * - slice end offsets (gotten from the slice lengths)
+     */
+    for (i = 0; i < 256; i++)
+        bytestream2_put_byte(pb, p->lengths[i]);
 
-        slice_len = offset;
+    for (i = 0; i < c->slices; i++) {
+        offset += c->slice_sizes[plane * c->slices + i];
+        bytestream2_put_le32(pb, offset);
     }
 
-    /* And at the end seek to the end of written slice(s) */
-    bytestream2_seek_p(pb, offset, SEEK_CUR);
-
-    return 0;
+    /* Write the slices' data into the output packet */
+    for (i = 0; i < c->slices; i++) {
+        sstart = p->height * i / c->slices;
+        bytestream2_put_buffer(pb, slice_bits_ptr(c, plane, i, sstart),
+                               c->slice_sizes[plane * c->slices + i]);
+    }
 }
 
 static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                 const AVFrame *pic, int *got_packet)
 {
     UtvideoContext *c = avctx->priv_data;
+    UtvideoEncPlane planes[4];
     PutByteContext pb;
 
     uint32_t frame_info;
@@ -539,6 +607,13 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     int width = avctx->width, height = avctx->height;
     int i, ret = 0;
 
+    if (c->frame_pred != PRED_NONE && c->frame_pred != PRED_LEFT &&
+        c->frame_pred != PRED_MEDIAN) {
+        av_log(avctx, AV_LOG_ERROR, "Unknown prediction mode: %d\n",
+               c->frame_pred);
+        return AVERROR_OPTION_NOT_FOUND;
+    }
+
     /* Allocate a new packet if needed, and set it to the pointer dst */
     ret = ff_alloc_packet(pkt, (256 + 4 * c->slices + width * height) *
                           c->planes + 4);
@@ -555,62 +630,60 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     bytestream2_init_writer(&pb, dst, pkt->size);
 
     av_fast_malloc(&c->slice_bits, &c->slice_bits_size,
-                   width * height + AV_INPUT_BUFFER_PADDING_SIZE);
+                   (c->slice_stride * height + 16 * c->slices) * c->planes +
+                   AV_INPUT_BUFFER_PADDING_SIZE);
 
     if (!c->slice_bits) {
         av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
         return AVERROR(ENOMEM);
     }
 
-    /* In case of RGB, mangle the planes to Ut Video's format */
-    if (avctx->pix_fmt == AV_PIX_FMT_RGBA || avctx->pix_fmt == AV_PIX_FMT_RGB24)
-        mangle_rgb_planes(c->slice_buffer, c->slice_stride, pic->data[0],
-                          c->planes, pic->linesize[0], width, height);
+    for (i = 0; i < c->planes; i++) {
+        UtvideoEncPlane *p = &planes[i];
 
-    /* Deal with the planes */
-    switch (avctx->pix_fmt) {
-    case AV_PIX_FMT_RGB24:
-    case AV_PIX_FMT_RGBA:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, c->slice_buffer[i] + 2 * c->slice_stride,
-                               c->slice_buffer[i], c->slice_stride,
-                               width, height, &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], width >> !!i, height, &pb);
+        p->dst    = c->pred_buffer[i];
+        p->width  = width;
+        p->height = height;
 
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < c->planes; i++) {
-            ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], width >> !!i, height >> !!i,
-                               &pb);
-
-            if (ret) {
-                av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
-                return ret;
-            }
+        switch (avctx->pix_fmt) {
+        case AV_PIX_FMT_RGB24:
+        case AV_PIX_FMT_RGBA:
+            p->src    = c->slice_buffer[i] + 2 * c->slice_stride;
+            p->stride = c->slice_stride;
+            break;
+        case AV_PIX_FMT_YUV420P:
+            p->height = height >> !!i;
+            /* fall through */
+        case AV_PIX_FMT_YUV422P:
+            p->src    = pic->data[i];
+            p->stride = pic->linesize[i];
+            p->width  = width >> !!i;
+            break;
+        default:
+            av_log(avctx, AV_LOG_ERROR, "Unknown pixel format: %d\n",
+                   avctx->pix_fmt);
+            return AVERROR_INVALIDDATA;
         }
-        break;
-    default:
-        av_log(avctx, AV_LOG_ERROR, "Unknown pixel format: %d\n",
-               avctx->pix_fmt);
-        return AVERROR_INVALIDDATA;
     }
 
+    /* In case of RGB, mangle the planes to Ut Video's format */
+    if (avctx->pix_fmt == AV_PIX_FMT_RGBA || avctx->pix_fmt == AV_PIX_FMT_RGB24)
+        avctx->execute2(avctx, mangle_rgb_slice, (void *)pic, NULL, c->slices);
+
+    /* Do prediction and count the symbols of every slice of every plane */
+    avctx->execute2(avctx, predict_slice, planes, NULL,
+                    c->planes * c->slices);
+
+    for (i = 0; i < c->planes; i++)
+        build_plane_table(c, &planes[i], i);
+
+    /* Write the huffman codes of every slice of every plane */
+    avctx->execute2(avctx, write_huff_slice, planes, NULL,
+                    c->planes * c->slices);
+
+    for (i = 0; i < c->planes; i++)
+        write_plane(c, &planes[i], i, &pb);
+
     /*
      * Write frame information (LE 32-bit unsigned)
      * into the output packet.
@@ -668,6 +741,7 @@ AVCodec ff_utvideo_encoder = {
     .init           = utvideo_encode_init,
     .encode2        = utvideo_encode_frame,
     .close          = utvideo_encode_close,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA, AV_PIX_FMT_YUV422P,
                           AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE
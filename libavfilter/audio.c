@@ -41,7 +41,8 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     frame->format         = link->format;
     frame->channel_layout = link->channel_layout;
     frame->sample_rate    = link->sample_rate;
-    ret = av_frame_get_buffer(frame, 0);
+    ret = av_frame_get_pooled_buffer(frame, 0,
+                                     link->dst->graph->buffer_pool_set);
     if (ret < 0) {
         av_frame_free(&frame);
         return NULL;
@@ -620,6 +620,16 @@ typedef struct AVFilterGraph {
      * platform and build options.
      */
     avfilter_execute_func *execute;
+
+    /**
+     * A reference to a buffer pool set, as allocated by
+     * av_buffer_pool_set_alloc(). When set, the default frame allocation of
+     * the filters in this graph uses it instead of allocating from the heap,
+     * so that memory is reused and may be shared with other graphs and
+     * decoders. The reference is set by the caller and afterwards owned (and
+     * freed) by the graph.
+     */
+    AVBufferRef *buffer_pool_set;
 } AVFilterGraph;
 
 /**
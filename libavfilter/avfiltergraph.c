@@ -113,6 +113,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(&(*graph)->resample_lavr_opts);
     av_freep(&(*graph)->filters);
     av_freep(&(*graph)->internal);
+    av_buffer_unref(&(*graph)->buffer_pool_set);
     av_freep(graph);
 }
 
@@ -0,0 +1,383 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale video to several sizes at once
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+    struct SwsCascade *cascade;
+
+    /**
+     * Requested dimensions of each output. Special values are:
+     *   0 = input width/height
+     *  -1 = keep input aspect
+     */
+    int *w, *h;
+    int nb_sizes;
+
+    unsigned int flags;         ///< sws flags
+    double param[2];            ///< sws params
+
+    char *sizes_str;
+    char *flags_str;
+} MultiScaleContext;
+
+static int parse_size(AVFilterContext *ctx, const char *str, int *w, int *h)
+{
+    char tail;
+
+    if (av_parse_video_size(w, h, str) >= 0)
+        return 0;
+    if (sscanf(str, "%dx%d%c", w, h, &tail) != 2 ||
+        *w < -1 || *h < -1 || (*w == -1 && *h == -1)) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid output size '%s'.\n", str);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    int64_t w, h;
+    int i;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        if (ctx->outputs[i] == outlink)
+            break;
+
+    if (!(w = s->w[i]))
+        w = inlink->w;
+    if (!(h = s->h[i]))
+        h = inlink->h;
+    if (w == -1)
+        w = av_rescale(h, inlink->w, inlink->h);
+    if (h == -1)
+        h = av_rescale(w, inlink->h, inlink->w);
+
+    if (w > INT_MAX || h > INT_MAX ||
+        (h * inlink->w) > INT_MAX  ||
+        (w * inlink->h) > INT_MAX) {
+        av_log(ctx, AV_LOG_ERROR, "Rescaled value for width or height is too big.\n");
+        return AVERROR(EINVAL);
+    }
+
+    outlink->w = w;
+    outlink->h = h;
+
+    av_log(ctx, AV_LOG_VERBOSE, "w:%d h:%d fmt:%s -> %s w:%d h:%d fmt:%s flags:0x%0x\n",
+           inlink ->w, inlink ->h, av_get_pix_fmt_name(inlink->format),
+           ctx->output_pads[i].name,
+           outlink->w, outlink->h, av_get_pix_fmt_name(outlink->format),
+           s->flags);
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w,
+                                                             outlink->w * inlink->h},
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    /* created for all outputs with the first frame */
+    sws_cascade_free(&s->cascade);
+
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    const char *p;
+    int i, ret;
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        return AVERROR(EINVAL);
+    }
+
+    p = s->sizes_str;
+    while (*p) {
+        char *size = av_get_token(&p, "|");
+        int w, h;
+
+        if (!size)
+            return AVERROR(ENOMEM);
+        ret = parse_size(ctx, size, &w, &h);
+        av_freep(&size);
+        if (ret < 0)
+            return ret;
+
+        if ((ret = av_reallocp_array(&s->w, s->nb_sizes + 1, sizeof(*s->w))) < 0 ||
+            (ret = av_reallocp_array(&s->h, s->nb_sizes + 1, sizeof(*s->h))) < 0) {
+            s->nb_sizes = 0;
+            return ret;
+        }
+        s->w[s->nb_sizes]   = w;
+        s->h[s->nb_sizes++] = h;
+
+        if (*p)
+            p++;
+    }
+
+    if (!s->nb_sizes) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes given.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < s->nb_sizes; i++) {
+        char name[32];
+        AVFilterPad pad = { 0 };
+
+        snprintf(name, sizeof(name), "output%d", i);
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.name         = av_strdup(name);
+        pad.config_props = config_output;
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+
+        ff_insert_outpad(ctx, i, &pad);
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    sws_cascade_free(&s->cascade);
+    av_freep(&s->w);
+    av_freep(&s->h);
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats;
+    const AVPixFmtDescriptor *desc;
+    enum AVPixelFormat pix_fmt;
+    int i, ret;
+
+    formats = NULL;
+    desc    = NULL;
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0) {
+            ff_formats_unref(&formats);
+            return ret;
+        }
+    }
+    ff_formats_ref(formats, &ctx->inputs[0]->out_formats);
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        formats = NULL;
+        desc    = NULL;
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            pix_fmt = av_pix_fmt_desc_get_id(desc);
+            if (sws_isSupportedOutput(pix_fmt) &&
+                (ret = ff_add_format(&formats, pix_fmt)) < 0) {
+                ff_formats_unref(&formats);
+                return ret;
+            }
+        }
+        ff_formats_ref(formats, &ctx->outputs[i]->in_formats);
+    }
+
+    return 0;
+}
+
+static int init_cascade(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    enum AVPixelFormat *formats;
+    int *w, *h;
+    int i, ret = 0;
+
+    w       = av_malloc_array(ctx->nb_outputs, sizeof(*w));
+    h       = av_malloc_array(ctx->nb_outputs, sizeof(*h));
+    formats = av_malloc_array(ctx->nb_outputs, sizeof(*formats));
+    if (!w || !h || !formats) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        w[i]       = ctx->outputs[i]->w;
+        h[i]       = ctx->outputs[i]->h;
+        formats[i] = ctx->outputs[i]->format;
+    }
+
+    s->cascade = sws_cascade_alloc(inlink->w, inlink->h, inlink->format,
+                                   ctx->nb_outputs, w, h, formats,
+                                   s->flags, s->param);
+    if (!s->cascade)
+        ret = AVERROR(EINVAL);
+
+end:
+    av_free(w);
+    av_free(h);
+    av_free(formats);
+    return ret;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    AVFrame **out;
+    uint8_t ***data;
+    int **linesize;
+    int i, ret = 0;
+
+    if (!s->cascade && (ret = init_cascade(ctx)) < 0)
+        goto fail;
+
+    out      = av_mallocz_array(ctx->nb_outputs, sizeof(*out));
+    data     = av_malloc_array(ctx->nb_outputs, sizeof(*data));
+    linesize = av_malloc_array(ctx->nb_outputs, sizeof(*linesize));
+    if (!out || !data || !linesize) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+
+        av_frame_copy_props(out[i], in);
+        out[i]->width  = outlink->w;
+        out[i]->height = outlink->h;
+
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+
+        data[i]     = out[i]->data;
+        linesize[i] = out[i]->linesize;
+    }
+
+    ret = sws_cascade_scale(s->cascade, (const uint8_t * const *)in->data,
+                            in->linesize, (uint8_t * const * const *)data,
+                            (const int * const *)linesize);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        ret = ff_filter_frame(ctx->outputs[i], out[i]);
+        out[i] = NULL;
+        if (ret < 0)
+            break;
+    }
+
+end:
+    if (out)
+        for (i = 0; i < ctx->nb_outputs; i++)
+            av_frame_free(&out[i]);
+    av_free(out);
+    av_free(data);
+    av_free(linesize);
+fail:
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM
+static const AVOption options[] = {
+    { "sizes",  "'|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, .flags = FLAGS },
+    { "flags",  "Flags to pass to libswscale", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" }, .flags = FLAGS },
+    { "param0", "Scaler param 0",              OFFSET(param[0]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX, FLAGS },
+    { "param1", "Scaler param 1",              OFFSET(param[1]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX, FLAGS },
+    { NULL },
+};
+
+static const AVClass multiscale_class = {
+    .class_name = "multiscale",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+static const AVFilterPad avfilter_vf_multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_multiscale = {
+    .name        = "multiscale",
+    .description = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes at once."),
+
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+
+    .priv_size  = sizeof(MultiScaleContext),
+    .priv_class = &multiscale_class,
+
+    .inputs  = avfilter_vf_multiscale_inputs,
+    .outputs = NULL,
+
+    .flags   = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
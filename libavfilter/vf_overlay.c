@@ -73,21 +73,97 @@ static const char * const eof_action_str[] = {
 #define MAIN    0
 #define OVERLAY 1
 
+enum OverlayFormat {
+    OVERLAY_FORMAT_YUV420,      ///< yuv420p main, yuva420p overlay
+    OVERLAY_FORMAT_NV12,        ///< nv12 main, yuva420p overlay
+    OVERLAY_FORMAT_YUV422P10,   ///< yuv422p10 main, yuva422p10 overlay
+    OVERLAY_FORMAT_NB
+};
+
 typedef struct OverlayContext {
     const AVClass *class;
     int x, y;                   ///< position of overlaid picture
 
     int max_plane_step[4];      ///< steps per pixel for each plane
     int hsub, vsub;             ///< chroma subsampling values
+    int depth;                  ///< bits per component of the main input
 
     char *x_expr, *y_expr;
 
     enum EOFAction eof_action;  ///< action to take on EOF from source
+    enum OverlayFormat format;  ///< main and overlay pixel format pair
+    int premultiplied;          ///< overlay color is premultiplied by alpha
 
     AVFrame *main;
     AVFrame *over_prev, *over_next;
+
+    uint8_t *tmp;               ///< per-job chroma alpha and source rows
+    unsigned int tmp_size;
+    int tmp_stride;             ///< size of the scratch area of one job
 } OverlayContext;
 
+/* x / 255 rounded to nearest, exact for 0 <= x <= 255 * 255 */
+#define DIV255(x) ((((x) + 128) * 257) >> 16)
+
+static void blend_row(uint8_t *dst, const uint8_t *src,
+                      const uint8_t *alpha, int w)
+{
+    int i;
+
+    for (i = 0; i < w; i++)
+        dst[i] = DIV255(dst[i] * (255 - alpha[i]) + src[i] * alpha[i]);
+}
+
+/* offset is the value of a zero component, the midpoint for chroma */
+static void blend_row_premultiplied(uint8_t *dst, const uint8_t *src,
+                                    const uint8_t *alpha, int w, int offset)
+{
+    int i;
+
+    for (i = 0; i < w; i++)
+        dst[i] = av_clip_uint8(DIV255((dst[i] - offset) * (255 - alpha[i])) +
+                               src[i]);
+}
+
+static void blend_row16(uint16_t *dst, const uint16_t *src,
+                        const uint16_t *alpha, int w, int offset,
+                        int premultiplied, int depth)
+{
+    int max = (1 << depth) - 1;
+    int i;
+
+    if (premultiplied) {
+        for (i = 0; i < w; i++)
+            dst[i] = av_clip_uintp2(ROUNDED_DIV((dst[i] - offset) * (max - alpha[i]), max) +
+                                    src[i], depth);
+    } else {
+        for (i = 0; i < w; i++)
+            dst[i] = (dst[i] * (max - alpha[i]) + src[i] * alpha[i] + (max >> 1)) / max;
+    }
+}
+
+/* Average the alpha samples covered by each chroma sample of one row;
+ * last is set for the bottom chroma row of the overlay. */
+#define CHROMA_ALPHA_ROW(name, type)                                            \
+static void name(type *dst, const type *a, ptrdiff_t linesize, int wp,         \
+                 int hsub, int vsub, int last)                                  \
+{                                                                               \
+    int k;                                                                      \
+                                                                                \
+    for (k = 0; k < wp; k++, a += 1 << hsub) {                                  \
+        if (hsub && vsub && !last && k + 1 < wp) {                              \
+            dst[k] = (a[0] + a[linesize] + a[1] + a[linesize + 1]) >> 2;        \
+        } else {                                                                \
+            int alpha_h = hsub && k + 1 < wp ? (a[0] + a[1])        >> 1 : a[0]; \
+            int alpha_v = vsub && !last      ? (a[0] + a[linesize]) >> 1 : a[0]; \
+            dst[k] = (alpha_h + alpha_v) >> 1;                                  \
+        }                                                                       \
+    }                                                                           \
+}
+
+CHROMA_ALPHA_ROW(chroma_alpha_row,   uint8_t)
+CHROMA_ALPHA_ROW(chroma_alpha_row16, uint16_t)
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
@@ -95,14 +171,24 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&s->main);
     av_frame_free(&s->over_prev);
     av_frame_free(&s->over_next);
+    av_freep(&s->tmp);
 }
 
 static int query_formats(AVFilterContext *ctx)
 {
-    static const enum AVPixelFormat inout_pix_fmts[] = { AV_PIX_FMT_YUV420P,  AV_PIX_FMT_NONE };
-    static const enum AVPixelFormat blend_pix_fmts[] = { AV_PIX_FMT_YUVA420P, AV_PIX_FMT_NONE };
-    AVFilterFormats *inout_formats = ff_make_format_list(inout_pix_fmts);
-    AVFilterFormats *blend_formats = ff_make_format_list(blend_pix_fmts);
+    static const enum AVPixelFormat inout_pix_fmts[OVERLAY_FORMAT_NB][2] = {
+        [OVERLAY_FORMAT_YUV420]    = { AV_PIX_FMT_YUV420P,   AV_PIX_FMT_NONE },
+        [OVERLAY_FORMAT_NV12]      = { AV_PIX_FMT_NV12,      AV_PIX_FMT_NONE },
+        [OVERLAY_FORMAT_YUV422P10] = { AV_PIX_FMT_YUV422P10, AV_PIX_FMT_NONE },
+    };
+    static const enum AVPixelFormat blend_pix_fmts[OVERLAY_FORMAT_NB][2] = {
+        [OVERLAY_FORMAT_YUV420]    = { AV_PIX_FMT_YUVA420P,   AV_PIX_FMT_NONE },
+        [OVERLAY_FORMAT_NV12]      = { AV_PIX_FMT_YUVA420P,   AV_PIX_FMT_NONE },
+        [OVERLAY_FORMAT_YUV422P10] = { AV_PIX_FMT_YUVA422P10, AV_PIX_FMT_NONE },
+    };
+    OverlayContext *s = ctx->priv;
+    AVFilterFormats *inout_formats = ff_make_format_list(inout_pix_fmts[s->format]);
+    AVFilterFormats *blend_formats = ff_make_format_list(blend_pix_fmts[s->format]);
 
     ff_formats_ref(inout_formats, &ctx->inputs [MAIN   ]->out_formats);
     ff_formats_ref(blend_formats, &ctx->inputs [OVERLAY]->out_formats);
@@ -119,6 +205,7 @@ static int config_input_main(AVFilterLink *inlink)
     av_image_fill_max_pixsteps(s->max_plane_step, NULL, pix_desc);
     s->hsub = pix_desc->log2_chroma_w;
     s->vsub = pix_desc->log2_chroma_h;
+    s->depth = pix_desc->comp[0].depth;
 
     return 0;
 }
@@ -176,6 +263,10 @@ static int config_input_overlay(AVFilterLink *inlink)
                (int)var_values[VAR_MAIN_W], (int)var_values[VAR_MAIN_H]);
         return AVERROR(EINVAL);
     }
+
+    /* one row of chroma alpha and one of interleaved chroma per job */
+    s->tmp_stride = 2 * FFALIGN(2 * (inlink->w + 1), 32);
+
     return 0;
 
 fail:
@@ -195,80 +286,121 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
-static void blend_frame(AVFilterContext *ctx,
-                        AVFrame *dst, AVFrame *src,
-                        int x, int y)
+static int is_transparent(const uint8_t *alpha, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        if (alpha[i])
+            return 0;
+    return 1;
+}
+
+static void blend_samples(OverlayContext *s, uint8_t *dst, const uint8_t *src,
+                          const uint8_t *alpha, int w, int chroma)
+{
+    int offset = chroma ? 1 << (s->depth - 1) : 0;
+
+    if (s->depth > 8) {
+        blend_row16((uint16_t *)dst, (const uint16_t *)src,
+                    (const uint16_t *)alpha, w, offset,
+                    s->premultiplied, s->depth);
+    } else if (s->premultiplied) {
+        blend_row_premultiplied(dst, src, alpha, w, offset);
+    } else {
+        blend_row(dst, src, alpha, w);
+    }
+}
+
+typedef struct ThreadData {
+    AVFrame *dst, *src;
+} ThreadData;
+
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *s = ctx->priv;
+    ThreadData *td    = arg;
+    AVFrame *dst      = td->dst;
+    AVFrame *src      = td->src;
+    int bps           = (s->depth + 7) >> 3;
+    int width         = FFMIN(dst->width  - s->x, src->width);
+    int height        = FFMIN(dst->height - s->y, src->height);
+    int wp            = FFALIGN(width,  1 << s->hsub) >> s->hsub;
+    int hp            = FFALIGN(height, 1 << s->vsub) >> s->vsub;
+    /* jobs are split on chroma rows so that they do not share any output */
+    int slice_start   = hp *  jobnr      / nb_jobs;
+    int slice_end     = hp * (jobnr + 1) / nb_jobs;
+    int nv12          = dst->format == AV_PIX_FMT_NV12;
+    ptrdiff_t als     = src->linesize[3];
+    uint8_t *tmp_a    = s->tmp + jobnr * s->tmp_stride;
+    uint8_t *tmp_s    = tmp_a + s->tmp_stride / 2;
     int i, j, k;
-    int width, height;
-    int overlay_end_y = y + src->height;
-    int end_y, start_y;
-
-    width = FFMIN(dst->width - x, src->width);
-    end_y = FFMIN(dst->height, overlay_end_y);
-    start_y = FFMAX(y, 0);
-    height = end_y - start_y;
-
-    if (dst->format == AV_PIX_FMT_BGR24 || dst->format == AV_PIX_FMT_RGB24) {
-        uint8_t *dp = dst->data[0] + x * 3 + start_y * dst->linesize[0];
-        uint8_t *sp = src->data[0];
-        int b = dst->format == AV_PIX_FMT_BGR24 ? 2 : 0;
-        int r = dst->format == AV_PIX_FMT_BGR24 ? 0 : 2;
-        if (y < 0)
-            sp += -y * src->linesize[0];
-        for (i = 0; i < height; i++) {
-            uint8_t *d = dp, *s = sp;
-            for (j = 0; j < width; j++) {
-                d[r] = (d[r] * (0xff - s[3]) + s[0] * s[3] + 128) >> 8;
-                d[1] = (d[1] * (0xff - s[3]) + s[1] * s[3] + 128) >> 8;
-                d[b] = (d[b] * (0xff - s[3]) + s[2] * s[3] + 128) >> 8;
-                d += 3;
-                s += 4;
-            }
-            dp += dst->linesize[0];
-            sp += src->linesize[0];
-        }
-    } else {
-        for (i = 0; i < 3; i++) {
-            int hsub = i ? s->hsub : 0;
-            int vsub = i ? s->vsub : 0;
-            uint8_t *dp = dst->data[i] + (x >> hsub) +
-                (start_y >> vsub) * dst->linesize[i];
-            uint8_t *sp = src->data[i];
-            uint8_t *ap = src->data[3];
-            int wp = FFALIGN(width, 1<<hsub) >> hsub;
-            int hp = FFALIGN(height, 1<<vsub) >> vsub;
-            if (y < 0) {
-                sp += ((-y) >> vsub) * src->linesize[i];
-                ap += -y * src->linesize[3];
-            }
-            for (j = 0; j < hp; j++) {
-                uint8_t *d = dp, *s = sp, *a = ap;
-                for (k = 0; k < wp; k++) {
-                    // average alpha for color components, improve quality
-                    int alpha_v, alpha_h, alpha;
-                    if (hsub && vsub && j+1 < hp && k+1 < wp) {
-                        alpha = (a[0] + a[src->linesize[3]] +
-                                 a[1] + a[src->linesize[3]+1]) >> 2;
-                    } else if (hsub || vsub) {
-                        alpha_h = hsub && k+1 < wp ?
-                            (a[0] + a[1]) >> 1 : a[0];
-                        alpha_v = vsub && j+1 < hp ?
-                            (a[0] + a[src->linesize[3]]) >> 1 : a[0];
-                        alpha = (alpha_v + alpha_h) >> 1;
-                    } else
-                        alpha = a[0];
-                    *d = (*d * (0xff - alpha) + *s++ * alpha + 128) >> 8;
-                    d++;
-                    a += 1 << hsub;
-                }
-                dp += dst->linesize[i];
-                sp += src->linesize[i];
-                ap += (1 << vsub) * src->linesize[3];
+
+    for (j = slice_start << s->vsub; j < FFMIN(slice_end << s->vsub, height); j++) {
+        const uint8_t *a = src->data[3] + j * als;
+
+        if (is_transparent(a, width * bps))
+            continue;
+        blend_samples(s, dst->data[0] + (s->y + j) * dst->linesize[0] + s->x * bps,
+                      src->data[0] + j * src->linesize[0], a, width, 0);
+    }
+
+    for (j = slice_start; j < slice_end; j++) {
+        const uint8_t *a = src->data[3] + (j << s->vsub) * als;
+        int last = j + 1 >= hp;
+        int dy   = (s->y >> s->vsub) + j;
+
+        if (is_transparent(a, width * bps) &&
+            (!s->vsub || last || is_transparent(a + als, width * bps)))
+            continue;
+
+        if (bps > 1)
+            chroma_alpha_row16((uint16_t *)tmp_a, (const uint16_t *)a, als / 2,
+                               wp, s->hsub, s->vsub, last);
+        else
+            chroma_alpha_row(tmp_a, a, als, wp, s->hsub, s->vsub, last);
+
+        if (nv12) {
+            const uint8_t *u = src->data[1] + j * src->linesize[1];
+            const uint8_t *v = src->data[2] + j * src->linesize[2];
+
+            for (k = wp - 1; k >= 0; k--) {
+                tmp_a[2 * k] = tmp_a[2 * k + 1] = tmp_a[k];
+                tmp_s[2 * k]     = u[k];
+                tmp_s[2 * k + 1] = v[k];
             }
+            blend_samples(s, dst->data[1] + dy * dst->linesize[1] +
+                          (s->x >> s->hsub) * 2, tmp_s, tmp_a, 2 * wp, 1);
+            continue;
         }
+
+        for (i = 1; i < 3; i++)
+            blend_samples(s, dst->data[i] + dy * dst->linesize[i] +
+                          (s->x >> s->hsub) * bps,
+                          src->data[i] + j * src->linesize[i], tmp_a, wp, 1);
     }
+
+    return 0;
+}
+
+static int blend_frame(AVFilterContext *ctx, AVFrame *dst, AVFrame *src)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData td     = { .dst = dst, .src = src };
+    int height        = FFMIN(dst->height - s->y, src->height);
+    int nb_jobs       = FFMIN(FFALIGN(height, 1 << s->vsub) >> s->vsub,
+                              ctx->graph->nb_threads);
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    av_fast_malloc(&s->tmp, &s->tmp_size, nb_jobs * s->tmp_stride);
+    if (!s->tmp)
+        return AVERROR(ENOMEM);
+
+    ctx->internal->execute(ctx, blend_slice, &td, NULL, nb_jobs);
+
+    return 0;
 }
 
 static int filter_frame_main(AVFilterLink *inlink, AVFrame *frame)
@@ -304,11 +436,14 @@ static int output_frame(AVFilterContext *ctx)
 static int handle_overlay_eof(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
+    int ret;
+
     /* Repeat previous frame on secondary input */
-    if (s->over_prev && s->eof_action == EOF_ACTION_REPEAT)
-        blend_frame(ctx, s->main, s->over_prev, s->x, s->y);
+    if (s->over_prev && s->eof_action == EOF_ACTION_REPEAT) {
+        if ((ret = blend_frame(ctx, s->main, s->over_prev)) < 0)
+            return ret;
     /* End both streams */
-    else if (s->eof_action == EOF_ACTION_ENDALL)
+    } else if (s->eof_action == EOF_ACTION_ENDALL)
         return AVERROR_EOF;
     return output_frame(ctx);
 }
@@ -353,11 +488,14 @@ static int request_frame(AVFilterLink *outlink)
     if (s->main->pts == AV_NOPTS_VALUE ||
         s->over_next->pts == AV_NOPTS_VALUE ||
         !av_compare_ts(s->over_next->pts, tb_over, s->main->pts, tb_main)) {
-        blend_frame(ctx, s->main, s->over_next, s->x, s->y);
+        ret = blend_frame(ctx, s->main, s->over_next);
         av_frame_free(&s->over_prev);
         FFSWAP(AVFrame*, s->over_prev, s->over_next);
+        if (ret < 0)
+            return ret;
     } else if (s->over_prev) {
-        blend_frame(ctx, s->main, s->over_prev, s->x, s->y);
+        if ((ret = blend_frame(ctx, s->main, s->over_prev)) < 0)
+            return ret;
     }
 
     return output_frame(ctx);
@@ -376,6 +514,16 @@ static const AVOption options[] = {
         { "repeat", "Repeat the previous frame.",   0, AV_OPT_TYPE_CONST, { .i64 = EOF_ACTION_REPEAT }, .flags = FLAGS, "eof_action" },
         { "endall", "End both streams.",            0, AV_OPT_TYPE_CONST, { .i64 = EOF_ACTION_ENDALL }, .flags = FLAGS, "eof_action" },
         { "pass",   "Pass through the main input.", 0, AV_OPT_TYPE_CONST, { .i64 = EOF_ACTION_PASS },   .flags = FLAGS, "eof_action" },
+    { "format", "Pixel format of the main input, and of the output",
+        OFFSET(format), AV_OPT_TYPE_INT, { .i64 = OVERLAY_FORMAT_YUV420 },
+        0, OVERLAY_FORMAT_NB - 1, .flags = FLAGS, "format" },
+        { "yuv420",    "yuv420p, blended with yuva420p",      0, AV_OPT_TYPE_CONST, { .i64 = OVERLAY_FORMAT_YUV420 },    .flags = FLAGS, "format" },
+        { "nv12",      "nv12, blended with yuva420p",         0, AV_OPT_TYPE_CONST, { .i64 = OVERLAY_FORMAT_NV12 },      .flags = FLAGS, "format" },
+        { "yuv422p10", "yuv422p10, blended with yuva422p10",  0, AV_OPT_TYPE_CONST, { .i64 = OVERLAY_FORMAT_YUV422P10 }, .flags = FLAGS, "format" },
+    { "alpha", "Alpha mode of the overlay", OFFSET(premultiplied), AV_OPT_TYPE_INT,
+        { .i64 = 0 }, 0, 1, .flags = FLAGS, "alpha" },
+        { "straight",      "Color is independent of alpha.",  0, AV_OPT_TYPE_CONST, { .i64 = 0 }, .flags = FLAGS, "alpha" },
+        { "premultiplied", "Color is premultiplied by alpha.", 0, AV_OPT_TYPE_CONST, { .i64 = 1 }, .flags = FLAGS, "alpha" },
     { NULL },
 };
 
@@ -426,6 +574,8 @@ AVFilter ff_vf_overlay = {
 
     .query_formats = query_formats,
 
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
+
     .inputs    = avfilter_vf_overlay_inputs,
     .outputs   = avfilter_vf_overlay_outputs,
 };
@@ -52,7 +52,8 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
         frame->height = h;
         frame->format = link->format;
 
-        ret = av_frame_get_buffer(frame, 32);
+        ret = av_frame_get_pooled_buffer(frame, 32,
+                                         link->dst->graph->buffer_pool_set);
     }
     if (ret < 0)
         av_frame_free(&frame);
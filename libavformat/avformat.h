@@ -1893,6 +1893,95 @@ int av_index_search_timestamp(AVStream *st, int64_t timestamp, int flags);
 int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags);
 
+/**
+ * A fragment of a track in a fragmented ISO base media (MP4) file.
+ */
+typedef struct AVFragmentIndexEntry {
+    /**
+     * Start time of the fragment in the track timescale, as given by the
+     * tfra or sidx box or the decode time of its first sample.
+     */
+    int64_t time;
+    /**
+     * Duration of the fragment in the track timescale, the sum of the
+     * durations of its samples, 0 if unknown.
+     */
+    int64_t duration;
+    /**
+     * Byte offset of the moof box starting the fragment.
+     */
+    int64_t offset;
+    /**
+     * Size in bytes of the fragment, up to the end of the mdat box
+     * following the moof box.
+     */
+    int64_t size;
+    /**
+     * Nonzero if the fragment starts with a sync sample.
+     */
+    int keyframe;
+} AVFragmentIndexEntry;
+
+typedef struct AVFragmentIndexTrack {
+    int track_id;
+    /**
+     * Number of time units per second, 0 if unknown.
+     */
+    int timescale;
+
+    AVFragmentIndexEntry *entries;
+    int nb_entries;
+} AVFragmentIndexTrack;
+
+/**
+ * Index of the fragments of a fragmented ISO base media file.
+ * Allocated by av_fragment_index_build(), freed by av_fragment_index_free().
+ */
+typedef struct AVFragmentIndex {
+    AVFragmentIndexTrack *tracks;
+    int nb_tracks;
+
+    /**
+     * Byte offset and size of the first run of consecutive sidx boxes,
+     * sidx_offset is -1 if the file has no sidx box.
+     */
+    int64_t sidx_offset;
+    int64_t sidx_size;
+} AVFragmentIndex;
+
+/**
+ * Ignore the mfra and sidx boxes and read every moof box of the file.
+ */
+#define AV_FRAGMENT_INDEX_SCAN 1
+
+/**
+ * Only locate the sidx boxes: stop after the first run of sidx boxes and
+ * skip the moof boxes before it. The index then only has the entries of
+ * the sidx boxes, if any.
+ */
+#define AV_FRAGMENT_INDEX_SIDX 2
+
+/**
+ * Build the fragment index of a fragmented ISO base media file without
+ * demuxing it.
+ *
+ * The index is taken from the sidx boxes if they cover all the tracks,
+ * else from the mfra box at the end of seekable files, reading only the
+ * header of each fragment, else from a single pass over the moof boxes.
+ *
+ * @param pb    the file, seekable or positioned at its start
+ * @param index pointer to the newly allocated index on success
+ * @param flags a combination of AV_FRAGMENT_INDEX_* flags
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_fragment_index_build(AVIOContext *pb, AVFragmentIndex **index, int flags);
+
+/**
+ * Free an index allocated by av_fragment_index_build() and set the pointer
+ * to it to NULL.
+ */
+void av_fragment_index_free(AVFragmentIndex **index);
+
 
 /**
  * Split a URL string into components.
@@ -53,6 +53,29 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Get the data already present in the buffer of a read AVIOContext, which
+ * can be accessed without a refill. The data is not consumed, use
+ * avio_skip() to do so once it has been handled.
+ *
+ * @param data address at which to store a pointer to the buffered data,
+ *    valid until the next call that references the same IO context
+ * @return number of bytes available at *data
+ */
+int ffio_peek_buffered(AVIOContext *s, const unsigned char **data);
+
+/**
+ * Read size bytes from AVIOContext as a reference to the data of the
+ * underlying protocol, without copying them, if the protocol supports it
+ * (e.g. the file protocol with the mmap option set).
+ * The referenced data is read-only and followed by
+ * AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes.
+ * @return size on success, the IO context is then advanced by size bytes,
+ *         or AVERROR(ENOSYS) if the data cannot be referenced, nothing is
+ *         read in that case
+ */
+int ffio_read_buffer(AVIOContext *s, int size, AVBufferRef **buf);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
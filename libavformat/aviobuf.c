@@ -40,6 +40,12 @@
  */
 #define SHORT_SEEK_THRESHOLD 4096
 
+/**
+ * Amount read after a range referenced with ffio_read_buffer(), enough for
+ * the header in front of the next packet without reading much of its data.
+ */
+#define REFERENCE_READ_SIZE 4096
+
 typedef struct AVIOInternal {
     const AVClass *class;
 
@@ -621,6 +627,12 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_peek_buffered(AVIOContext *s, const unsigned char **data)
+{
+    *data = s->buf_ptr;
+    return s->write_flag ? 0 : s->buf_end - s->buf_ptr;
+}
+
 int avio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -823,6 +835,42 @@ static int64_t io_read_seek(void *opaque, int stream_index, int64_t timestamp, i
     return internal->h->prot->url_read_seek(internal->h, stream_index, timestamp, flags);
 }
 
+int ffio_read_buffer(AVIOContext *s, int size, AVBufferRef **buf)
+{
+    AVIOInternal *internal = s->opaque;
+    int64_t pos = avio_tell(s);
+    int ret;
+
+    if (s->read_packet != io_read_packet || s->write_flag ||
+        s->update_checksum || size <= 0 || pos < 0 ||
+        !(s->seekable & AVIO_SEEKABLE_NORMAL) ||
+        !internal->h->prot->url_get_buffer)
+        return AVERROR(ENOSYS);
+
+    ret = internal->h->prot->url_get_buffer(internal->h, pos, size, buf);
+    if (ret < 0)
+        return ret;
+
+    /* Skip the range without reading any of it, then read only a little,
+     * as the data after a header is likely referenced as well. */
+    if ((ret = s->seek(s->opaque, pos + size, SEEK_SET)) < 0) {
+        av_buffer_unref(buf);
+        return ret;
+    }
+    s->buf_ptr     = s->buffer;
+    s->buf_end     = s->buffer;
+    s->pos         = pos + size;
+    s->eof_reached = 0;
+
+    ret = s->read_packet(s->opaque, s->buffer,
+                         FFMIN(s->buffer_size, REFERENCE_READ_SIZE));
+    if (ret > 0) {
+        s->buf_end = s->buffer + ret;
+        s->pos    += ret;
+    }
+    return size;
+}
+
 int ffio_fdopen(AVIOContext **s, URLContext *h)
 {
     AVIOInternal *internal = NULL;
@@ -19,9 +19,16 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE /* O_DIRECT and fallocate() */
+
+#include <stdatomic.h>
+
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/internal.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avformat.h"
 #include <fcntl.h>
 #if HAVE_IO_H
@@ -30,6 +37,9 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <sys/stat.h>
 #include <stdlib.h>
 #include "os_support.h"
@@ -38,16 +48,60 @@
 
 /* standard file protocol */
 
+typedef struct DirectBuffer {
+    uint8_t *alloc;
+    uint8_t *data;      ///< aligned to DIRECT_ALIGN
+    int64_t start;      ///< file offset of the first byte held
+    int len;            ///< number of bytes held
+} DirectBuffer;
+
+/* Large buffer writing, the buffers are written out with O_DIRECT where
+ * possible, by a separate thread while the other buffer is being filled. */
+typedef struct DirectWriter {
+    int fd;             ///< buffered descriptor, for the unaligned parts
+    int direct_fd;      ///< descriptor opened with O_DIRECT, -1 if none
+    int buf_size;
+    DirectBuffer buf[2];
+    int cur;            ///< buffer being filled
+    int64_t pos;        ///< logical write position
+    int64_t size;       ///< end of the written data
+    int error;
+#if HAVE_THREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int thread_started;
+    DirectBuffer *pending; ///< buffer handed to the thread
+    int quit;
+#endif
+} DirectWriter;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
     int trunc;
     int follow;
+    int use_mmap;
+    int direct;
+    int direct_buf_size;
+    int64_t preallocate;
+    DirectWriter *writer;
+    AVBufferRef *window;    ///< mapping the packets are referenced from
+    struct FileMapping *map;
+    int64_t window_pos;     ///< file offset of the window
+    int64_t file_size;      ///< file size when last checked
+    unsigned pkt_id;        ///< id of the last packet referenced
+    int64_t pad_pos;        ///< file offset of its padding, -1 if none
+    uint8_t pad_data[AV_INPUT_BUFFER_PADDING_SIZE]; ///< file data it replaced
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "Truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "mmap", "Map the file in memory and return packet data by reference", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "direct", "Write through large buffers with direct I/O and a writer thread", offsetof(FileContext, direct), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+    { "direct_buffer_size", "Size of each of the two direct I/O buffers", offsetof(FileContext, direct_buf_size), AV_OPT_TYPE_INT, { .i64 = 4 << 20 }, 1 << 16, 1 << 30, AV_OPT_FLAG_ENCODING_PARAM },
+    { "preallocate", "Preallocate space for this many bytes on write", offsetof(FileContext, preallocate), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -100,6 +154,262 @@ static int file_check(URLContext *h, int mask)
 
 #if CONFIG_FILE_PROTOCOL
 
+/* O_DIRECT needs the file offsets, sizes and memory to be aligned to the
+ * logical block size of the device, this covers all common ones. */
+#define DIRECT_ALIGN 4096
+
+static int write_at(int fd, const uint8_t *buf, int size, int64_t pos)
+{
+    if (size && lseek(fd, pos, SEEK_SET) < 0)
+        return AVERROR(errno);
+    while (size > 0) {
+        int ret = write(fd, buf, size);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        buf  += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/* Write the aligned middle of the buffer with O_DIRECT and the unaligned
+ * head and tail through the page cache. */
+static int write_buffer(DirectWriter *w, DirectBuffer *b)
+{
+    int off = b->start & (DIRECT_ALIGN - 1);
+    const uint8_t *data = b->data + off;
+    int head = off ? FFMIN(DIRECT_ALIGN - off, b->len) : 0;
+    int body = (b->len - head) & ~(DIRECT_ALIGN - 1);
+    int ret;
+
+    if (w->direct_fd < 0) {
+        head = b->len;
+        body = 0;
+    }
+
+    if ((ret = write_at(w->fd, data, head, b->start)) < 0)
+        return ret;
+    if (body) {
+        ret = write_at(w->direct_fd, data + head, body, b->start + head);
+        /* the file system may accept O_DIRECT on open but not the alignment
+         * of the writes, continue through the page cache then */
+        if (ret == AVERROR(EINVAL)) {
+            close(w->direct_fd);
+            w->direct_fd = -1;
+            ret = write_at(w->fd, data + head, body, b->start + head);
+        }
+        if (ret < 0)
+            return ret;
+    }
+    if ((ret = write_at(w->fd, data + head + body, b->len - head - body,
+                        b->start + head + body)) < 0)
+        return ret;
+    return 0;
+}
+
+#if HAVE_THREADS
+static void *writer_thread(void *arg)
+{
+    DirectWriter *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        DirectBuffer *b;
+        int ret;
+
+        while (!w->pending && !w->quit)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (!w->pending)
+            break;
+
+        b = w->pending;
+        pthread_mutex_unlock(&w->lock);
+        ret = write_buffer(w, b);
+        pthread_mutex_lock(&w->lock);
+
+        if (ret < 0 && !w->error)
+            w->error = ret;
+        w->pending = NULL;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return NULL;
+}
+#endif
+
+/* Wait until no buffer is being written in the background. */
+static int writer_wait(DirectWriter *w)
+{
+    int ret;
+#if HAVE_THREADS
+    pthread_mutex_lock(&w->lock);
+    while (w->pending)
+        pthread_cond_wait(&w->cond, &w->lock);
+    ret = w->error;
+    pthread_mutex_unlock(&w->lock);
+#else
+    ret = w->error;
+#endif
+    return ret;
+}
+
+/* Hand the current buffer over for writing and switch to the other one. */
+static int writer_submit(DirectWriter *w)
+{
+    DirectBuffer *b = &w->buf[w->cur];
+    int ret = writer_wait(w);
+
+    if (ret < 0)
+        return ret;
+
+#if HAVE_THREADS
+    if (w->thread_started) {
+        pthread_mutex_lock(&w->lock);
+        w->pending = b;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+    } else
+#endif
+    if ((ret = write_buffer(w, b)) < 0)
+        return w->error = ret;
+
+    w->cur ^= 1;
+    w->buf[w->cur].start = w->pos;
+    w->buf[w->cur].len   = 0;
+    return 0;
+}
+
+/* Write out everything buffered so far. */
+static int writer_flush(DirectWriter *w)
+{
+    DirectBuffer *b = &w->buf[w->cur];
+    int ret = writer_wait(w);
+
+    if (ret < 0)
+        return ret;
+    if (b->len && (ret = write_buffer(w, b)) < 0)
+        return w->error = ret;
+    b->start = w->pos;
+    b->len   = 0;
+    return 0;
+}
+
+static int writer_write(DirectWriter *w, const uint8_t *buf, int size)
+{
+    int left = size;
+
+    if (w->error < 0)
+        return w->error;
+
+    while (left > 0) {
+        DirectBuffer *b = &w->buf[w->cur];
+        int off = b->start & (DIRECT_ALIGN - 1);
+        int n   = FFMIN(left, w->buf_size - off - b->len);
+        int ret;
+
+        memcpy(b->data + off + b->len, buf, n);
+        b->len += n;
+        buf    += n;
+        left   -= n;
+        w->pos += n;
+        w->size = FFMAX(w->size, w->pos);
+
+        if (off + b->len == w->buf_size && (ret = writer_submit(w)) < 0)
+            return ret;
+    }
+    return size;
+}
+
+static void writer_close(DirectWriter **pw)
+{
+    DirectWriter *w = *pw;
+    int i;
+
+    if (!w)
+        return;
+#if HAVE_THREADS
+    if (w->thread_started) {
+        pthread_mutex_lock(&w->lock);
+        w->quit = 1;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->lock);
+    }
+#endif
+    if (w->direct_fd >= 0)
+        close(w->direct_fd);
+    for (i = 0; i < 2; i++)
+        av_free(w->buf[i].alloc);
+    av_freep(pw);
+}
+
+static int writer_open(URLContext *h, const char *filename)
+{
+    FileContext *c = h->priv_data;
+    DirectWriter *w;
+    struct stat st;
+    int i;
+
+    w = c->writer = av_mallocz(sizeof(*w));
+    if (!w)
+        return AVERROR(ENOMEM);
+    w->fd        = c->fd;
+    w->direct_fd = -1;
+    w->buf_size  = FFALIGN(c->direct_buf_size, DIRECT_ALIGN);
+    /* writing starts at the beginning of the file, as with plain writes */
+    if (fstat(c->fd, &st) < 0)
+        return AVERROR(errno);
+    w->pos  = 0;
+    w->size = st.st_size;
+
+    for (i = 0; i < 2; i++) {
+        w->buf[i].alloc = av_malloc(w->buf_size + DIRECT_ALIGN);
+        if (!w->buf[i].alloc)
+            return AVERROR(ENOMEM);
+        w->buf[i].data = (uint8_t *)FFALIGN((uintptr_t)w->buf[i].alloc,
+                                            DIRECT_ALIGN);
+    }
+
+#ifdef O_DIRECT
+    w->direct_fd = avpriv_open(filename, O_WRONLY | O_DIRECT, 0666);
+#endif
+    if (w->direct_fd < 0)
+        av_log(h, AV_LOG_WARNING, "Direct I/O is not available for %s, "
+               "writing through the page cache\n", filename);
+
+#if HAVE_THREADS
+    if (pthread_mutex_init(&w->lock, NULL))
+        return AVERROR(ENOMEM);
+    if (pthread_cond_init(&w->cond, NULL)) {
+        pthread_mutex_destroy(&w->lock);
+        return AVERROR(ENOMEM);
+    }
+    if (pthread_create(&w->thread, NULL, writer_thread, w)) {
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->lock);
+        av_log(h, AV_LOG_WARNING, "Unable to start the writer thread\n");
+    } else {
+        w->thread_started = 1;
+    }
+#endif
+    return 0;
+}
+
+static int file_direct_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->writer)
+        return file_write(h, buf, size);
+    return writer_write(c->writer, buf, size);
+}
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -126,6 +436,27 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (fd == -1)
         return AVERROR(errno);
     c->fd = fd;
+
+    if (flags & AVIO_FLAG_WRITE && c->preallocate) {
+#if HAVE_FALLOCATE && defined(FALLOC_FL_KEEP_SIZE)
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, c->preallocate) < 0)
+#endif
+            av_log(h, AV_LOG_WARNING, "Unable to preallocate %"PRId64" bytes\n",
+                   c->preallocate);
+    }
+
+    if (c->direct && flags & AVIO_FLAG_WRITE) {
+        int ret;
+
+        if (flags & AVIO_FLAG_READ) {
+            av_log(h, AV_LOG_WARNING, "Direct I/O is only used for write "
+                   "only access, ignoring it for %s\n", filename);
+        } else if ((ret = writer_open(h, filename)) < 0) {
+            writer_close(&c->writer);
+            close(fd);
+            return ret;
+        }
+    }
     return 0;
 }
 
@@ -139,7 +470,28 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         struct stat st;
 
         ret = fstat(c->fd, &st);
-        return ret < 0 ? AVERROR(errno) : st.st_size;
+        if (ret < 0)
+            return AVERROR(errno);
+        return c->writer ? FFMAX(st.st_size, c->writer->size) : st.st_size;
+    }
+
+    if (c->writer) {
+        DirectWriter *w = c->writer;
+
+        if (whence == SEEK_CUR)
+            pos += w->pos;
+        else if (whence == SEEK_END)
+            pos += w->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        if (pos != w->pos) {
+            if ((ret = writer_flush(w)) < 0)
+                return ret;
+            w->pos = w->buf[w->cur].start = pos;
+        }
+        return pos;
     }
 
     ret = lseek(c->fd, pos, whence);
@@ -147,21 +499,184 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     return ret < 0 ? AVERROR(errno) : ret;
 }
 
+#if HAVE_MMAP
+/* Minimum size of the file mappings the packets are referenced from. */
+#define MMAP_WINDOW_SIZE (16 << 20)
+
+typedef struct FileMapping {
+    uint8_t *addr;
+    size_t size;
+    atomic_uint last_pkt;   ///< id of the last packet, 0 once it is released
+} FileMapping;
+
+typedef struct FilePacket {
+    AVBufferRef *window;
+    FileMapping *map;
+    unsigned id;
+} FilePacket;
+
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    FileMapping *map = opaque;
+    munmap(map->addr, map->size);
+    av_free(map);
+}
+
+static void file_packet_free(void *opaque, uint8_t *data)
+{
+    FilePacket *pkt = opaque;
+    unsigned id = pkt->id;
+
+    atomic_compare_exchange_strong(&pkt->map->last_pkt, &id, 0);
+    av_buffer_unref(&pkt->window);
+    av_free(pkt);
+}
+
+static int map_window(FileContext *c, int64_t pos, int64_t end)
+{
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t map_pos, map_end;
+    FileMapping *map;
+    AVBufferRef *window;
+
+    if (page <= 0)
+        return AVERROR(ENOSYS);
+    map_pos = pos & ~(page - 1);
+    map_end = FFMIN(FFMAX(end, map_pos + MMAP_WINDOW_SIZE), c->file_size);
+    if (map_end - map_pos > INT_MAX)
+        return AVERROR(ENOSYS);
+
+    map = av_malloc(sizeof(*map));
+    if (!map)
+        return AVERROR(ENOMEM);
+    map->size = map_end - map_pos;
+    atomic_init(&map->last_pkt, 0);
+    map->addr = mmap(NULL, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                     c->fd, map_pos);
+    if (map->addr == MAP_FAILED) {
+        int ret = AVERROR(errno);
+        av_free(map);
+        return ret;
+    }
+    window = av_buffer_create(map->addr, map->size, file_unmap, map, 0);
+    if (!window) {
+        munmap(map->addr, map->size);
+        av_free(map);
+        return AVERROR(ENOMEM);
+    }
+
+    av_buffer_unref(&c->window);
+    c->window     = window;
+    c->map        = map;
+    c->window_pos = map_pos;
+    c->pad_pos    = -1;
+    return 0;
+}
+
+/* The packets are referenced from a private mapping of a large part of the
+ * file, only the page holding the padding of each packet is copied on write
+ * when it is zeroed. The mapping is used for the following packets as long
+ * as they do not overlap the padding of the previous one, or that packet is
+ * gone and the data under its padding can be put back. */
+static int file_get_buffer(URLContext *h, int64_t pos, int size,
+                           AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    int64_t end = pos + size + AV_INPUT_BUFFER_PADDING_SIZE;
+    FilePacket *pkt;
+    uint8_t *data;
+    int ret;
+
+    if (!c->use_mmap || c->follow || h->flags & AVIO_FLAG_WRITE)
+        return AVERROR(ENOSYS);
+
+    /* touching pages past the end of the file would fault */
+    if (end > c->file_size) {
+        struct stat st;
+
+        if (fstat(c->fd, &st) < 0)
+            return AVERROR(errno);
+        c->file_size = st.st_size;
+        if (end > c->file_size)
+            return AVERROR(ENOSYS);
+    }
+
+    if (c->window && pos >= c->window_pos &&
+        end <= c->window_pos + c->window->size && c->pad_pos >= 0 &&
+        pos < c->pad_pos + AV_INPUT_BUFFER_PADDING_SIZE) {
+        if (pos >= c->pad_pos && !atomic_load(&c->map->last_pkt))
+            memcpy(c->window->data + (c->pad_pos - c->window_pos),
+                   c->pad_data, sizeof(c->pad_data));
+        else
+            av_buffer_unref(&c->window);
+    }
+    if (!c->window || pos < c->window_pos ||
+        end > c->window_pos + c->window->size) {
+        if ((ret = map_window(c, pos, end)) < 0)
+            return ret;
+    }
+
+    pkt = av_malloc(sizeof(*pkt));
+    if (!pkt)
+        return AVERROR(ENOMEM);
+    pkt->window = av_buffer_ref(c->window);
+    pkt->map    = c->map;
+    if (!++c->pkt_id)
+        c->pkt_id++;
+    pkt->id     = c->pkt_id;
+    data = c->window->data + (pos - c->window_pos);
+    *buf = pkt->window ? av_buffer_create(data, size, file_packet_free, pkt,
+                                          AV_BUFFER_FLAG_READONLY) : NULL;
+    if (!*buf) {
+        av_buffer_unref(&pkt->window);
+        av_free(pkt);
+        return AVERROR(ENOMEM);
+    }
+
+    atomic_store(&c->map->last_pkt, pkt->id);
+    c->pad_pos = pos + size;
+    memcpy(c->pad_data, data + size, sizeof(c->pad_data));
+    memset(data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    return 0;
+}
+#endif
+
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    struct stat st;
+    int64_t size = -1;
+    int ret = 0;
+
+    if (c->writer) {
+        ret = writer_flush(c->writer);
+        size = c->writer->size;
+        writer_close(&c->writer);
+    } else if (fstat(c->fd, &st) >= 0) {
+        size = st.st_size;
+    }
+    /* release the preallocated space past the end of the data */
+    if (h->flags & AVIO_FLAG_WRITE && c->preallocate && size >= 0 &&
+        ftruncate(c->fd, size) < 0 && !ret)
+        ret = AVERROR(errno);
+    av_buffer_unref(&c->window);
+    if (close(c->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 const URLProtocol ff_file_protocol = {
     .name                = "file",
     .url_open            = file_open,
     .url_read            = file_read,
-    .url_write           = file_write,
+    .url_write           = file_direct_write,
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+#if HAVE_MMAP
+    .url_get_buffer      = file_get_buffer,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
 };
@@ -0,0 +1,778 @@
+/*
+ * Fragment index of fragmented ISO base media files
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Fragment index of fragmented ISO base media files, built from the sidx
+ * or mfra boxes or a single pass over the moof boxes without demuxing.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#include "libavcodec/bytestream.h"
+
+#include "avformat.h"
+#include "avio.h"
+#include "isom.h"
+
+/* largest box read into memory at once */
+#define MAX_BOX_SIZE (64 << 20)
+
+typedef struct FragTrack {
+    uint32_t default_duration;  ///< from the trex box
+    uint32_t default_flags;
+    int64_t next_time;          ///< end of the last fragment, for missing tfdt
+    unsigned int entries_size;  ///< allocated size of the entries
+    int run_start;              ///< number of entries before the sidx run
+    int in_run;                 ///< the track is referenced by the sidx run
+} FragTrack;
+
+typedef struct FragIndexContext {
+    AVIOContext *pb;
+    int64_t file_size;          ///< INT64_MAX if unknown
+    AVFragmentIndex *index;
+    FragTrack *priv;            ///< per track state, parallel to index->tracks
+    uint8_t *buf;
+    unsigned int buf_size;
+
+    int64_t run_end;            ///< end of the media covered by the sidx run
+} FragIndexContext;
+
+typedef struct TrafInfo {
+    int track;                  ///< index in the tracks, -1 without tfhd
+    int64_t time;
+    int has_time;
+    int64_t duration;
+    int keyframe;
+} TrafInfo;
+
+static int find_track(FragIndexContext *c, int track_id)
+{
+    AVFragmentIndex *index = c->index;
+    AVFragmentIndexTrack *tracks;
+    FragTrack *priv;
+    int i;
+
+    for (i = 0; i < index->nb_tracks; i++)
+        if (index->tracks[i].track_id == track_id)
+            return i;
+
+    tracks = av_realloc_array(index->tracks, index->nb_tracks + 1, sizeof(*tracks));
+    if (!tracks)
+        return AVERROR(ENOMEM);
+    index->tracks = tracks;
+    priv = av_realloc_array(c->priv, index->nb_tracks + 1, sizeof(*priv));
+    if (!priv)
+        return AVERROR(ENOMEM);
+    c->priv = priv;
+
+    memset(&tracks[i], 0, sizeof(*tracks));
+    memset(&priv[i],   0, sizeof(*priv));
+    tracks[i].track_id = track_id;
+    return index->nb_tracks++;
+}
+
+static int add_entry(FragIndexContext *c, int track,
+                     const AVFragmentIndexEntry *entry)
+{
+    AVFragmentIndexTrack *t = &c->index->tracks[track];
+    AVFragmentIndexEntry *entries;
+
+    if (t->nb_entries >= INT_MAX / sizeof(*entries) - 1)
+        return AVERROR(ENOMEM);
+    entries = av_fast_realloc(t->entries, &c->priv[track].entries_size,
+                              (t->nb_entries + 1) * sizeof(*entries));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    t->entries = entries;
+    entries[t->nb_entries++] = *entry;
+    return 0;
+}
+
+/**
+ * Read the header of the box at the current position of pb, which must end
+ * before end. size is the size of the whole box.
+ */
+static int read_box_header(AVIOContext *pb, int64_t end,
+                           uint32_t *tag, int64_t *size)
+{
+    int64_t pos = avio_tell(pb);
+    int64_t len;
+
+    if (end - pos < 8)
+        return AVERROR_EOF;
+    len  = avio_rb32(pb);
+    *tag = avio_rb32(pb);
+    if (len == 1)
+        len = avio_rb64(pb);
+    else if (len == 0 && end != INT64_MAX)
+        len = end - pos;
+    if (pb->eof_reached)
+        return AVERROR_EOF;
+    if (len < 8 || len > end - pos)
+        return AVERROR_INVALIDDATA;
+
+    *size = len;
+    return 0;
+}
+
+/**
+ * Read the next size bytes of pb into the context buffer.
+ */
+static int read_payload(FragIndexContext *c, int64_t size)
+{
+    if (size < 0 || size > MAX_BOX_SIZE)
+        return AVERROR_INVALIDDATA;
+    av_fast_malloc(&c->buf, &c->buf_size, FFMAX(size, 1));
+    if (!c->buf)
+        return AVERROR(ENOMEM);
+    if (avio_read(c->pb, c->buf, size) != size)
+        return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+/**
+ * Split the next box of gb, which is advanced past it, into box.
+ */
+static int get_box(GetByteContext *gb, GetByteContext *box, uint32_t *tag)
+{
+    uint64_t size;
+    int header = 8;
+
+    if (bytestream2_get_bytes_left(gb) < 8)
+        return AVERROR_EOF;
+    size = bytestream2_get_be32u(gb);
+    *tag = bytestream2_get_be32u(gb);
+    if (size == 1) {
+        if (bytestream2_get_bytes_left(gb) < 8)
+            return AVERROR_INVALIDDATA;
+        size   = bytestream2_get_be64u(gb);
+        header = 16;
+    } else if (size == 0) {
+        size = bytestream2_get_bytes_left(gb) + header;
+    }
+    if (size < header || size - header > bytestream2_get_bytes_left(gb))
+        return AVERROR_INVALIDDATA;
+
+    bytestream2_init(box, gb->buffer, size - header);
+    bytestream2_skipu(gb, size - header);
+    return 0;
+}
+
+static int parse_mdia(FragIndexContext *c, int64_t end, int *timescale)
+{
+    AVIOContext *pb = c->pb;
+    int64_t size;
+    uint32_t tag;
+    int ret;
+
+    while (1) {
+        int64_t pos = avio_tell(pb), next;
+
+        if ((ret = read_box_header(pb, end, &tag, &size)) < 0)
+            break;
+        next = pos + size;
+
+        if (tag == MKBETAG('m','d','h','d')) {
+            int version = avio_r8(pb);
+            avio_skip(pb, version == 1 ? 19 : 11);
+            *timescale = avio_rb32(pb);
+        }
+        if (avio_seek(pb, next, SEEK_SET) < 0)
+            return AVERROR_INVALIDDATA;
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int parse_trak(FragIndexContext *c, int64_t end)
+{
+    AVIOContext *pb = c->pb;
+    int track_id = -1, timescale = 0;
+    int64_t size;
+    uint32_t tag;
+    int ret;
+
+    while (1) {
+        int64_t pos = avio_tell(pb), next;
+
+        if ((ret = read_box_header(pb, end, &tag, &size)) < 0)
+            break;
+        next = pos + size;
+
+        if (tag == MKBETAG('t','k','h','d')) {
+            int version = avio_r8(pb);
+            avio_skip(pb, version == 1 ? 19 : 11);
+            track_id = avio_rb32(pb);
+        } else if (tag == MKBETAG('m','d','i','a')) {
+            if ((ret = parse_mdia(c, next, &timescale)) < 0)
+                return ret;
+        }
+        if (avio_seek(pb, next, SEEK_SET) < 0)
+            return AVERROR_INVALIDDATA;
+    }
+    if (ret != AVERROR_EOF)
+        return ret;
+
+    if (track_id >= 0) {
+        int track = find_track(c, track_id);
+        if (track < 0)
+            return track;
+        c->index->tracks[track].timescale = timescale;
+    }
+    return 0;
+}
+
+static int parse_moov(FragIndexContext *c, int64_t end)
+{
+    AVIOContext *pb = c->pb;
+    int64_t size;
+    uint32_t tag;
+    int ret;
+
+    while (1) {
+        int64_t pos = avio_tell(pb), next;
+
+        if ((ret = read_box_header(pb, end, &tag, &size)) < 0)
+            break;
+        next = pos + size;
+
+        if (tag == MKBETAG('t','r','a','k')) {
+            if ((ret = parse_trak(c, next)) < 0)
+                return ret;
+        } else if (tag == MKBETAG('m','v','e','x')) {
+            uint32_t mvex_tag;
+            int64_t mvex_size;
+
+            while (1) {
+                int64_t mvex_pos = avio_tell(pb), mvex_next;
+
+                if (read_box_header(pb, next, &mvex_tag, &mvex_size) < 0)
+                    break;
+                mvex_next = mvex_pos + mvex_size;
+
+                if (mvex_tag == MKBETAG('t','r','e','x')) {
+                    int track;
+
+                    avio_rb32(pb); /* version + flags */
+                    track = find_track(c, avio_rb32(pb));
+                    if (track < 0)
+                        return track;
+                    avio_rb32(pb); /* default_sample_description_index */
+                    c->priv[track].default_duration = avio_rb32(pb);
+                    avio_rb32(pb); /* default_sample_size */
+                    c->priv[track].default_flags    = avio_rb32(pb);
+                }
+                if (avio_seek(pb, mvex_next, SEEK_SET) < 0)
+                    return AVERROR_INVALIDDATA;
+            }
+        }
+        if (avio_seek(pb, next, SEEK_SET) < 0)
+            return AVERROR_INVALIDDATA;
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int parse_trun(GetByteContext *gb, uint32_t default_duration,
+                      uint32_t default_flags, TrafInfo *traf, int first)
+{
+    unsigned flags, entries, sample_size, i;
+    uint32_t first_flags;
+
+    bytestream2_skip(gb, 1); /* version */
+    flags   = bytestream2_get_be24(gb);
+    entries = bytestream2_get_be32(gb);
+    if (flags & MOV_TRUN_DATA_OFFSET)
+        bytestream2_skip(gb, 4);
+    first_flags = flags & MOV_TRUN_FIRST_SAMPLE_FLAGS ?
+                  bytestream2_get_be32(gb) : default_flags;
+
+    sample_size = 4 * (!!(flags & MOV_TRUN_SAMPLE_DURATION) +
+                       !!(flags & MOV_TRUN_SAMPLE_SIZE)     +
+                       !!(flags & MOV_TRUN_SAMPLE_FLAGS)    +
+                       !!(flags & MOV_TRUN_SAMPLE_CTS));
+    if (entries > INT_MAX ||
+        (uint64_t)entries * sample_size > bytestream2_get_bytes_left(gb))
+        return AVERROR_INVALIDDATA;
+
+    /* all samples use the defaults, the count is not bounded by the box */
+    if (!sample_size) {
+        if (first && entries)
+            traf->keyframe = !(first_flags & MOV_FRAG_SAMPLE_FLAG_IS_NON_SYNC);
+        traf->duration += (int64_t)entries * default_duration;
+        return entries;
+    }
+
+    for (i = 0; i < entries; i++) {
+        uint32_t duration     = default_duration;
+        uint32_t sample_flags = i ? default_flags : first_flags;
+
+        if (flags & MOV_TRUN_SAMPLE_DURATION)
+            duration = bytestream2_get_be32u(gb);
+        if (flags & MOV_TRUN_SAMPLE_SIZE)
+            bytestream2_skipu(gb, 4);
+        if (flags & MOV_TRUN_SAMPLE_FLAGS)
+            sample_flags = bytestream2_get_be32u(gb);
+        if (flags & MOV_TRUN_SAMPLE_CTS)
+            bytestream2_skipu(gb, 4);
+
+        if (first && !i)
+            traf->keyframe = !(sample_flags & MOV_FRAG_SAMPLE_FLAG_IS_NON_SYNC);
+        traf->duration += duration;
+    }
+    return entries;
+}
+
+static int parse_traf(FragIndexContext *c, GetByteContext *gb, TrafInfo *traf)
+{
+    uint32_t default_duration = 0, default_flags = 0;
+    int64_t nb_samples = 0;
+    int ret;
+    GetByteContext box;
+    uint32_t tag;
+
+    memset(traf, 0, sizeof(*traf));
+    traf->track = -1;
+
+    while ((ret = get_box(gb, &box, &tag)) >= 0) {
+        if (tag == MKBETAG('t','f','h','d')) {
+            int flags;
+
+            bytestream2_skip(&box, 1); /* version */
+            flags = bytestream2_get_be24(&box);
+            ret = find_track(c, bytestream2_get_be32(&box));
+            if (ret < 0)
+                return ret;
+            traf->track      = ret;
+            default_duration = c->priv[ret].default_duration;
+            default_flags    = c->priv[ret].default_flags;
+
+            if (flags & MOV_TFHD_BASE_DATA_OFFSET)
+                bytestream2_skip(&box, 8);
+            if (flags & MOV_TFHD_STSD_ID)
+                bytestream2_skip(&box, 4);
+            if (flags & MOV_TFHD_DEFAULT_DURATION)
+                default_duration = bytestream2_get_be32(&box);
+            if (flags & MOV_TFHD_DEFAULT_SIZE)
+                bytestream2_skip(&box, 4);
+            if (flags & MOV_TFHD_DEFAULT_FLAGS)
+                default_flags = bytestream2_get_be32(&box);
+        } else if (tag == MKBETAG('t','f','d','t')) {
+            int version = bytestream2_get_byte(&box);
+
+            bytestream2_skip(&box, 3);
+            traf->time     = version == 1 ? bytestream2_get_be64(&box) :
+                                            bytestream2_get_be32(&box);
+            traf->has_time = 1;
+        } else if (tag == MKBETAG('t','r','u','n') && traf->track >= 0) {
+            ret = parse_trun(&box, default_duration, default_flags, traf,
+                             !nb_samples);
+            if (ret < 0)
+                return ret;
+            nb_samples += ret;
+        }
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+/**
+ * Return the size of the fragment starting with the moof box at offset,
+ * that is up to the end of the mdat box following it, and leave pb at the
+ * end of the fragment.
+ */
+static int64_t fragment_size(FragIndexContext *c, int64_t offset,
+                             int64_t moof_size)
+{
+    AVIOContext *pb = c->pb;
+    int64_t size = moof_size, box_size;
+    uint32_t tag;
+
+    if (avio_seek(pb, offset + size, SEEK_SET) < 0)
+        return size;
+    while (read_box_header(pb, c->file_size, &tag, &box_size) >= 0 &&
+           tag != MKBETAG('m','o','o','f') && tag != MKBETAG('s','i','d','x') &&
+           tag != MKBETAG('m','f','r','a')) {
+        size += box_size;
+        if (tag == MKBETAG('m','d','a','t') ||
+            avio_seek(pb, offset + size, SEEK_SET) < 0)
+            break;
+    }
+    avio_seek(pb, offset + size, SEEK_SET);
+    return size;
+}
+
+/**
+ * Parse the moof box in the context buffer. Add an entry for each of its
+ * tracks, or only fill the duration and keyframe flag of entry for the
+ * given track if entry is not NULL.
+ */
+static int parse_moof(FragIndexContext *c, int64_t moof_size, int64_t offset,
+                      int64_t size, int track, AVFragmentIndexEntry *entry)
+{
+    GetByteContext gb, box;
+    TrafInfo traf;
+    uint32_t tag;
+    int ret;
+
+    bytestream2_init(&gb, c->buf, moof_size);
+    while ((ret = get_box(&gb, &box, &tag)) >= 0) {
+        AVFragmentIndexEntry e;
+
+        if (tag != MKBETAG('t','r','a','f'))
+            continue;
+        if ((ret = parse_traf(c, &box, &traf)) < 0)
+            return ret;
+        if (traf.track < 0)
+            continue;
+
+        if (entry) {
+            if (traf.track == track) {
+                entry->duration = traf.duration;
+                entry->keyframe = traf.keyframe;
+                break;
+            }
+            continue;
+        }
+
+        e.time     = traf.has_time ? traf.time : c->priv[traf.track].next_time;
+        e.duration = traf.duration;
+        e.offset   = offset;
+        e.size     = size;
+        e.keyframe = traf.keyframe;
+        c->priv[traf.track].next_time = e.time + e.duration;
+        if ((ret = add_entry(c, traf.track, &e)) < 0)
+            return ret;
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+/**
+ * Read the moof box at offset and fill the size, duration and keyframe flag
+ * of entry from it.
+ */
+static int read_fragment(FragIndexContext *c, int track,
+                         AVFragmentIndexEntry *entry)
+{
+    AVIOContext *pb = c->pb;
+    int64_t size;
+    uint32_t tag;
+    int ret;
+
+    if (avio_seek(pb, entry->offset, SEEK_SET) < 0)
+        return AVERROR_INVALIDDATA;
+    if ((ret = read_box_header(pb, c->file_size, &tag, &size)) < 0)
+        return ret;
+    if (tag != MKBETAG('m','o','o','f'))
+        return AVERROR_INVALIDDATA;
+    size -= avio_tell(pb) - entry->offset;
+    if ((ret = read_payload(c, size)) < 0)
+        return ret;
+
+    entry->size = fragment_size(c, entry->offset, avio_tell(pb) - entry->offset);
+    return parse_moof(c, size, entry->offset, entry->size, track, entry);
+}
+
+/**
+ * Read the tfra boxes of the mfra box at the end of the file and the moof
+ * boxes they point to.
+ *
+ * @return 1 if the file has a mfra box, 0 if not
+ */
+static int read_mfra(FragIndexContext *c)
+{
+    AVIOContext *pb = c->pb;
+    GetByteContext gb, box;
+    int64_t size, mfra_pos;
+    uint32_t tag;
+    int i, j, ret;
+
+    if (c->file_size < 16 ||
+        avio_seek(pb, c->file_size - 16, SEEK_SET) < 0)
+        return 0;
+    avio_rb32(pb);
+    if (avio_rb32(pb) != MKBETAG('m','f','r','o'))
+        return 0;
+    avio_rb32(pb); /* version + flags */
+    mfra_pos = c->file_size - avio_rb32(pb);
+    if (mfra_pos < 0 || avio_seek(pb, mfra_pos, SEEK_SET) < 0 ||
+        read_box_header(pb, c->file_size, &tag, &size) < 0 ||
+        tag != MKBETAG('m','f','r','a'))
+        return 0;
+    size -= avio_tell(pb) - mfra_pos;
+    if ((ret = read_payload(c, size)) < 0)
+        return ret;
+
+    bytestream2_init(&gb, c->buf, size);
+    while (get_box(&gb, &box, &tag) >= 0) {
+        int version, lengths, track, nb_entries;
+        int64_t last_offset = -1;
+
+        if (tag != MKBETAG('t','f','r','a'))
+            continue;
+        version = bytestream2_get_byte(&box);
+        bytestream2_skip(&box, 3);
+        if ((track = find_track(c, bytestream2_get_be32(&box))) < 0)
+            return track;
+        lengths    = bytestream2_get_be32(&box);
+        nb_entries = bytestream2_get_be32(&box);
+
+        for (i = 0; i < nb_entries && bytestream2_get_bytes_left(&box) > 0; i++) {
+            AVFragmentIndexEntry e = { 0 };
+
+            if (version == 1) {
+                e.time   = bytestream2_get_be64(&box);
+                e.offset = bytestream2_get_be64(&box);
+            } else {
+                e.time   = bytestream2_get_be32(&box);
+                e.offset = bytestream2_get_be32(&box);
+            }
+            bytestream2_skip(&box, ((lengths >> 4) & 3) + 1 +
+                                   ((lengths >> 2) & 3) + 1 +
+                                   ((lengths >> 0) & 3) + 1);
+            /* several sync samples of one fragment */
+            if (e.offset == last_offset)
+                continue;
+            last_offset = e.offset;
+            if ((ret = add_entry(c, track, &e)) < 0)
+                return ret;
+        }
+    }
+
+    /* the mfra box is parsed from the context buffer, so read the moof
+     * boxes only now */
+    for (i = 0; i < c->index->nb_tracks; i++) {
+        AVFragmentIndexTrack *t = &c->index->tracks[i];
+        for (j = 0; j < t->nb_entries; j++)
+            if ((ret = read_fragment(c, i, &t->entries[j])) < 0)
+                return ret;
+    }
+    return 1;
+}
+
+static int parse_sidx(FragIndexContext *c, int64_t end, int64_t size)
+{
+    GetByteContext gb;
+    AVFragmentIndexEntry e = { 0 };
+    int version, track, timescale, nb_refs, i, ret;
+
+    bytestream2_init(&gb, c->buf, size);
+    version = bytestream2_get_byte(&gb);
+    bytestream2_skip(&gb, 3);
+    if ((track = find_track(c, bytestream2_get_be32(&gb))) < 0)
+        return track;
+    timescale = bytestream2_get_be32(&gb);
+    if (version == 0) {
+        e.time    = bytestream2_get_be32(&gb);
+        e.offset  = bytestream2_get_be32(&gb);
+    } else {
+        e.time    = bytestream2_get_be64(&gb);
+        e.offset  = bytestream2_get_be64(&gb);
+    }
+    e.offset += end;
+    bytestream2_skip(&gb, 2); /* reserved */
+    nb_refs = bytestream2_get_be16(&gb);
+    if (bytestream2_get_bytes_left(&gb) < 12 * nb_refs)
+        return AVERROR_INVALIDDATA;
+
+    /* a sidx box referencing other sidx boxes, they are read in turn */
+    for (i = 0; i < nb_refs; i++)
+        if (AV_RB32(gb.buffer + 12 * i) & 0x80000000)
+            return 0;
+
+    if (!c->index->tracks[track].timescale)
+        c->index->tracks[track].timescale = timescale;
+    c->priv[track].in_run = 1;
+
+    for (i = 0; i < nb_refs; i++) {
+        e.size     = bytestream2_get_be32u(&gb) & 0x7fffffff;
+        e.duration = bytestream2_get_be32u(&gb);
+        e.keyframe = bytestream2_get_be32u(&gb) >> 31;
+        if ((ret = add_entry(c, track, &e)) < 0)
+            return ret;
+        e.time   += e.duration;
+        e.offset += e.size;
+    }
+    c->priv[track].next_time = e.time;
+    c->run_end = FFMAX(c->run_end, e.offset);
+    return 0;
+}
+
+/**
+ * Finish a run of consecutive sidx boxes. The entries read from it are
+ * kept if it references all the tracks, else they are dropped and the
+ * fragments it covers are read.
+ *
+ * @return the end of the media covered by the run, -1 if it is dropped
+ */
+static int64_t end_sidx_run(FragIndexContext *c)
+{
+    AVFragmentIndex *index = c->index;
+    int64_t end = c->run_end;
+    int i, complete = index->nb_tracks > 0;
+
+    for (i = 0; i < index->nb_tracks; i++)
+        complete &= c->priv[i].in_run;
+    for (i = 0; i < index->nb_tracks; i++) {
+        if (!complete)
+            index->tracks[i].nb_entries = c->priv[i].run_start;
+        c->priv[i].in_run = 0;
+    }
+    c->run_end = -1;
+    return complete ? end : -1;
+}
+
+static int build_index(FragIndexContext *c, int flags)
+{
+    AVIOContext *pb = c->pb;
+    AVFragmentIndex *index = c->index;
+    int in_run = 0, tried_mfra = 0, ret;
+
+    while (1) {
+        int64_t pos = avio_tell(pb), size, header, end;
+        uint32_t tag;
+
+        if (read_box_header(pb, c->file_size, &tag, &size) < 0)
+            break;
+        header = avio_tell(pb) - pos;
+        end    = pos + size;
+
+        if (in_run && tag != MKBETAG('s','i','d','x')) {
+            int64_t run_end = end_sidx_run(c);
+
+            in_run = 0;
+            if (flags & AV_FRAGMENT_INDEX_SIDX)
+                return 0;
+            if (run_end > pos) {
+                if (avio_seek(pb, run_end, SEEK_SET) < 0)
+                    break;
+                continue;
+            }
+        }
+
+        switch (tag) {
+        case MKBETAG('m','o','o','v'):
+            if ((ret = parse_moov(c, end)) < 0)
+                return ret;
+            break;
+        case MKBETAG('s','i','d','x'):
+            if (index->sidx_offset < 0) {
+                index->sidx_offset = pos;
+                index->sidx_size   = size;
+            } else if (pos == index->sidx_offset + index->sidx_size) {
+                index->sidx_size  += size;
+            }
+            if (flags & AV_FRAGMENT_INDEX_SCAN)
+                break;
+            if (!in_run) {
+                int i;
+                for (i = 0; i < index->nb_tracks; i++)
+                    c->priv[i].run_start = index->tracks[i].nb_entries;
+            }
+            if ((ret = read_payload(c, size - header)) < 0 ||
+                (ret = parse_sidx(c, end, size - header)) < 0)
+                return ret;
+            in_run = 1;
+            break;
+        case MKBETAG('m','o','o','f'):
+            if (flags & AV_FRAGMENT_INDEX_SIDX)
+                break;
+            /* fragments not covered by sidx boxes, if the file has a mfra
+             * box it indexes them all */
+            if (!(flags & AV_FRAGMENT_INDEX_SCAN) && !tried_mfra &&
+                pb->seekable && c->file_size != INT64_MAX) {
+                int nb_entries = 0, i;
+
+                tried_mfra = 1;
+                for (i = 0; i < index->nb_tracks; i++)
+                    nb_entries += index->tracks[i].nb_entries;
+                if (!nb_entries && (ret = read_mfra(c)))
+                    return FFMIN(ret, 0);
+                if (avio_seek(pb, pos + header, SEEK_SET) < 0)
+                    return AVERROR_INVALIDDATA;
+            }
+            if ((ret = read_payload(c, size - header)) < 0 ||
+                (ret = parse_moof(c, size - header, pos,
+                                  fragment_size(c, pos, size), -1, NULL)) < 0)
+                return ret;
+            /* fragment_size() left pb at the end of the fragment */
+            continue;
+        }
+
+        if (avio_seek(pb, end, SEEK_SET) < 0)
+            break;
+    }
+
+    if (in_run)
+        end_sidx_run(c);
+    return 0;
+}
+
+int av_fragment_index_build(AVIOContext *pb, AVFragmentIndex **pindex, int flags)
+{
+    FragIndexContext c = { pb };
+    int ret;
+
+    *pindex = NULL;
+    c.index = av_mallocz(sizeof(*c.index));
+    if (!c.index)
+        return AVERROR(ENOMEM);
+    c.index->sidx_offset = -1;
+    c.run_end            = -1;
+
+    c.file_size = avio_size(pb);
+    if (c.file_size <= 0)
+        c.file_size = INT64_MAX;
+
+    if (avio_seek(pb, 0, SEEK_SET) < 0) {
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+    if ((ret = build_index(&c, flags)) < 0)
+        goto fail;
+
+    av_freep(&c.buf);
+    av_freep(&c.priv);
+    *pindex = c.index;
+    return 0;
+
+fail:
+    av_freep(&c.buf);
+    av_freep(&c.priv);
+    av_fragment_index_free(&c.index);
+    return ret;
+}
+
+void av_fragment_index_free(AVFragmentIndex **pindex)
+{
+    AVFragmentIndex *index = *pindex;
+    int i;
+
+    if (!index)
+        return;
+    for (i = 0; i < index->nb_tracks; i++)
+        av_freep(&index->tracks[i].entries);
+    av_freep(&index->tracks);
+    av_freep(pindex);
+}
@@ -46,30 +46,48 @@ typedef struct ListEntry {
     struct ListEntry *next;
 } ListEntry;
 
+typedef struct HLSVariant {
+    AVFormatContext *avf;
+    char *basename;        // Segment filename pattern.
+    char *playlist;        // Media playlist filename.
+    int *stream_map;       // Output stream index for every input stream, or -1.
+    int has_video;
+    int64_t sequence;
+    int64_t start_sequence;
+    // The following timestamps are in AV_TIME_BASE units.
+    int64_t end_pts;
+    int64_t duration;      // last segment duration computed so far.
+    int64_t bandwidth;     // Declared or measured peak bitrate.
+    int measure_bandwidth;
+    int split_pending;
+    int nb_entries;
+    ListEntry *list;
+    ListEntry *end_list;
+    int recovered;
+} HLSVariant;
+
 typedef struct HLSContext {
     const AVClass *class;  // Class for private options.
     unsigned number;
-    int64_t sequence;
     int64_t start_sequence;
     AVOutputFormat *oformat;
-    AVFormatContext *avf;
     float time;            // Set by a private option.
     int  size;             // Set by a private option.
     int  wrap;             // Set by a private option.
     int  version;          // Set by a private option.
     int  allowcache;
     int64_t recording_time;
-    int has_video;
     // The following timestamps are in AV_TIME_BASE units.
     int64_t start_pts;
-    int64_t end_pts;
-    int64_t duration;      // last segment duration computed so far.
-    int nb_entries;
-    ListEntry *list;
-    ListEntry *end_list;
+    int64_t split_pts;     // Cut point shared by all the variants.
     char *basename;
     char *baseurl;
 
+    char *variant_map;     // Set by a private option.
+    HLSVariant *variants;
+    int nb_variants;
+    int master_written;
+
     int encrypt;           // Set by a private option.
     char *key;             // Set by a private option.
     int key_len;
@@ -77,8 +95,6 @@ typedef struct HLSContext {
     char *iv;              // Set by a private option.
     int iv_len;
 
-    int recovered;
-
     char *key_basename;
 
     AVDictionary *enc_opts;
@@ -189,13 +205,13 @@ static int setup_encryption(AVFormatContext *s)
     return 0;
 }
 
-static int hls_mux_init(AVFormatContext *s)
+static int hls_mux_init(AVFormatContext *s, HLSVariant *var)
 {
     HLSContext *hls = s->priv_data;
     AVFormatContext *oc;
     int i;
 
-    hls->avf = oc = avformat_alloc_context();
+    var->avf = oc = avformat_alloc_context();
     if (!oc)
         return AVERROR(ENOMEM);
 
@@ -207,18 +223,37 @@ static int hls_mux_init(AVFormatContext *s)
 
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st;
+        AVCodecParameters *par = s->streams[i]->codecpar;
+
+        if (var->stream_map[i] < 0)
+            continue;
         if (!(st = avformat_new_stream(oc, NULL)))
             return AVERROR(ENOMEM);
-        avcodec_parameters_copy(st->codecpar, s->streams[i]->codecpar);
+        avcodec_parameters_copy(st->codecpar, par);
         st->sample_aspect_ratio = s->streams[i]->sample_aspect_ratio;
         st->time_base = s->streams[i]->time_base;
+
+        var->stream_map[i] = st->index;
+        var->has_video    += par->codec_type == AVMEDIA_TYPE_VIDEO;
+        if (par->bit_rate > 0)
+            var->bandwidth += par->bit_rate;
+        else
+            var->measure_bandwidth = 1;
     }
 
+    if (var->has_video > 1)
+        av_log(s, AV_LOG_WARNING,
+               "More than a single video stream present, "
+               "expect issues decoding it.\n");
+
+    if (var->measure_bandwidth)
+        var->bandwidth = 0;
+
     return 0;
 }
 
-static int append_entry(HLSContext *hls, int64_t duration, const char *name,
-                        int discont)
+static int append_entry(HLSContext *hls, HLSVariant *var, int64_t duration,
+                        const char *name, int discont)
 {
     ListEntry *en = av_malloc(sizeof(*en));
 
@@ -231,37 +266,38 @@ static int append_entry(HLSContext *hls, int64_t duration, const char *name,
     en->duration = duration;
     en->next     = NULL;
 
-    if (!hls->list)
-        hls->list = en;
+    if (!var->list)
+        var->list = en;
     else
-        hls->end_list->next = en;
+        var->end_list->next = en;
 
-    hls->end_list = en;
+    var->end_list = en;
 
-    if (hls->nb_entries >= hls->size) {
-        en = hls->list;
-        hls->list = en->next;
+    if (var->nb_entries >= hls->size) {
+        en = var->list;
+        var->list = en->next;
         av_free(en);
     } else
-        hls->nb_entries++;
+        var->nb_entries++;
 
-    hls->sequence++;
+    var->sequence++;
 
     return 0;
 }
 
-static void free_entries(HLSContext *hls)
+static void free_entries(HLSVariant *var)
 {
-    ListEntry *p = hls->list, *en;
+    ListEntry *p = var->list, *en;
 
     while(p) {
         en = p;
         p = p->next;
         av_free(en);
     }
+    var->list = var->end_list = NULL;
 }
 
-static int hls_window(AVFormatContext *s, int last)
+static int hls_window(AVFormatContext *s, HLSVariant *var, int last)
 {
     HLSContext *hls = s->priv_data;
     ListEntry *en;
@@ -269,13 +305,13 @@ static int hls_window(AVFormatContext *s, int last)
     int ret = 0;
     AVIOContext *out = NULL;
     char temp_filename[1024];
-    int64_t sequence = FFMAX(hls->start_sequence, hls->sequence - hls->size);
+    int64_t sequence = FFMAX(var->start_sequence, var->sequence - hls->size);
 
-    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", s->filename);
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", var->playlist);
     if ((ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, NULL)) < 0)
         goto fail;
 
-    for (en = hls->list; en; en = en->next) {
+    for (en = var->list; en; en = en->next) {
         if (target_duration < en->duration)
             target_duration = en->duration;
     }
@@ -293,7 +329,7 @@ static int hls_window(AVFormatContext *s, int last)
     av_log(s, AV_LOG_VERBOSE, "EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
            sequence);
 
-    for (en = hls->list; en; en = en->next) {
+    for (en = var->list; en; en = en->next) {
         if (en->discont) {
             avio_printf(out, "#EXT-X-DISCONTINUITY\n");
         }
@@ -333,22 +369,68 @@ static int hls_window(AVFormatContext *s, int last)
 fail:
     ff_format_io_close(s, &out);
     if (ret >= 0)
-        ff_rename(temp_filename, s->filename);
+        ff_rename(temp_filename, var->playlist);
     return ret;
 }
 
-static int hls_start(AVFormatContext *s)
+/**
+ * Write the master playlist referencing every variant playlist.
+ * Unless last is set, nothing is written until the bandwidth of every
+ * variant is known.
+ */
+static int hls_write_master(AVFormatContext *s, int last)
+{
+    HLSContext *hls = s->priv_data;
+    AVIOContext *out = NULL;
+    char temp_filename[sizeof(s->filename) + 4];
+    int i, j, ret;
+
+    for (i = 0; i < hls->nb_variants; i++)
+        if (!hls->variants[i].bandwidth && !last)
+            return 0;
+
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", s->filename);
+    if ((ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, NULL)) < 0)
+        return ret;
+
+    avio_printf(out, "#EXTM3U\n");
+    avio_printf(out, "#EXT-X-VERSION:%d\n", hls->version);
+
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+        AVFormatContext *oc = var->avf;
+
+        avio_printf(out, "#EXT-X-STREAM-INF:BANDWIDTH=%"PRId64,
+                    var->bandwidth);
+        for (j = 0; j < oc->nb_streams; j++) {
+            AVCodecParameters *par = oc->streams[j]->codecpar;
+            if (par->codec_type == AVMEDIA_TYPE_VIDEO &&
+                par->width && par->height) {
+                avio_printf(out, ",RESOLUTION=%dx%d", par->width, par->height);
+                break;
+            }
+        }
+        avio_printf(out, "\n%s\n", av_basename(var->playlist));
+    }
+
+    ff_format_io_close(s, &out);
+
+    hls->master_written = 1;
+
+    return ff_rename(temp_filename, s->filename);
+}
+
+static int hls_start(AVFormatContext *s, HLSVariant *var)
 {
     HLSContext *c = s->priv_data;
-    AVFormatContext *oc = c->avf;
+    AVFormatContext *oc = var->avf;
     int err = 0;
     AVDictionary *opts = NULL;
 
 
     if (av_get_frame_filename(oc->filename, sizeof(oc->filename),
-                              c->basename, c->wrap ? c->sequence % c->wrap : c->sequence) < 0)
+                              var->basename, c->wrap ? var->sequence % c->wrap : var->sequence) < 0)
         return AVERROR(EINVAL);
-    c->number++;
 
     if (c->encrypt) {
         if ((err = av_dict_copy(&opts, c->enc_opts, 0)) < 0)
@@ -357,7 +439,7 @@ static int hls_start(AVFormatContext *s)
             uint8_t iv[16] = { 0 };
             char buf[33];
 
-            AV_WB64(iv + 8, c->sequence);
+            AV_WB64(iv + 8, var->sequence);
             ff_data_to_hex(buf, iv, sizeof(iv), 0);
             buf[32] = '\0';
 
@@ -378,6 +460,60 @@ fail:
     return err;
 }
 
+/**
+ * Flush and close the current segment of a variant and add it to the
+ * variant playlist entries.
+ */
+static int hls_end_segment(AVFormatContext *s, HLSVariant *var, int last)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = var->avf;
+    int ret;
+
+    if (last)
+        av_write_trailer(oc);
+    else
+        av_write_frame(oc, NULL); /* Flush any buffered data */
+
+    if (var->measure_bandwidth && var->duration > 0) {
+        int64_t bandwidth = av_rescale(avio_tell(oc->pb), 8 * AV_TIME_BASE,
+                                       var->duration);
+        var->bandwidth = FFMAX(var->bandwidth, bandwidth);
+    }
+
+    ff_format_io_close(s, &oc->pb);
+
+    ret = append_entry(hls, var, var->duration, av_basename(oc->filename),
+                       var->recovered);
+    var->recovered = 0;
+
+    return ret;
+}
+
+static int hls_split(AVFormatContext *s, HLSVariant *var, int64_t pts)
+{
+    HLSContext *hls = s->priv_data;
+    int ret;
+
+    if ((ret = hls_end_segment(s, var, 0)) < 0)
+        return ret;
+
+    var->end_pts       = pts;
+    var->duration      = 0;
+    var->split_pending = 0;
+
+    if ((ret = hls_start(s, var)) < 0)
+        return ret;
+
+    if ((ret = hls_window(s, var, 0)) < 0)
+        return ret;
+
+    if (hls->nb_variants > 1 && !hls->master_written)
+        return hls_write_master(s, 0);
+
+    return 0;
+}
+
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
 {
     int len = ff_get_line(s, buf, maxlen);
@@ -386,7 +522,7 @@ static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
     return len;
 }
 
-static int hls_recover(AVFormatContext *s)
+static int hls_recover(AVFormatContext *s, HLSVariant *var)
 {
     HLSContext *hls = s->priv_data;
     char line[1024];
@@ -395,27 +531,29 @@ static int hls_recover(AVFormatContext *s)
     int ret, is_segment = 0, is_discont = 0;
     int64_t duration = 0;
 
-    ret = s->io_open(s, &io, s->filename, AVIO_FLAG_READ, NULL);
+    ret = s->io_open(s, &io, var->playlist, AVIO_FLAG_READ, NULL);
     if (ret < 0) {
         av_log(s, AV_LOG_WARNING,
-               "Cannot recover the playlist, generating a new one.\n");
-        hls->start_sequence = 0;
-        hls->sequence = 0;
+               "Cannot recover the playlist %s, generating a new one.\n",
+               var->playlist);
+        var->start_sequence = 0;
+        var->sequence = 0;
         return 0;
     }
 
     read_chomp_line(io, line, sizeof(line));
     if (strcmp(line, "#EXTM3U")) {
         av_log(s, AV_LOG_ERROR,
-               "The playlist file is present but unparsable."
-               " Please remove it.\n");
+               "The playlist file %s is present but unparsable."
+               " Please remove it.\n", var->playlist);
+        ff_format_io_close(s, &io);
         return AVERROR_INVALIDDATA;
     }
 
     while (!io->eof_reached) {
         read_chomp_line(io, line, sizeof(line));
         if (av_strstart(line, "#EXT-X-MEDIA-SEQUENCE:", &ptr)) {
-            hls->sequence = hls->start_sequence = atoi(ptr);
+            var->sequence = var->start_sequence = atoi(ptr);
         } else if (av_strstart(line, "#EXTINF:", &ptr)) {
             is_segment = 1;
             duration   = atof(ptr) * AV_TIME_BASE;
@@ -425,14 +563,98 @@ static int hls_recover(AVFormatContext *s)
             continue;
         } else if (line[0]) {
             if (is_segment) {
-                append_entry(hls, duration, av_basename(line), is_discont);
+                append_entry(hls, var, duration, av_basename(line), is_discont);
                 is_segment = 0;
                 is_discont = 0;
             }
         }
     }
 
-    hls->recovered = 1;
+    ff_format_io_close(s, &io);
+
+    var->recovered = 1;
+
+    return 0;
+}
+
+/**
+ * Parse the variant map, a space separated list of variants, each being
+ * a comma separated list of input stream indexes. Without a map a single
+ * variant carries every stream.
+ */
+static int hls_parse_variant_map(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    const char *p;
+    int i, nb_variants = 0;
+
+    if (!hls->variant_map) {
+        nb_variants = 1;
+    } else {
+        for (p = hls->variant_map; *p; p += strcspn(p, " ")) {
+            p += strspn(p, " ");
+            if (*p)
+                nb_variants++;
+        }
+        if (!nb_variants) {
+            av_log(s, AV_LOG_ERROR, "Empty variant map\n");
+            return AVERROR(EINVAL);
+        }
+    }
+
+    hls->variants = av_mallocz_array(nb_variants, sizeof(*hls->variants));
+    if (!hls->variants)
+        return AVERROR(ENOMEM);
+    hls->nb_variants = nb_variants;
+
+    for (i = 0; i < nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+        int j;
+
+        var->stream_map = av_malloc_array(s->nb_streams,
+                                          sizeof(*var->stream_map));
+        if (!var->stream_map)
+            return AVERROR(ENOMEM);
+        for (j = 0; j < s->nb_streams; j++)
+            var->stream_map[j] = hls->variant_map ? -1 : j;
+    }
+
+    if (!hls->variant_map)
+        return 0;
+
+    p = hls->variant_map;
+    for (i = 0; i < nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+        char *end;
+
+        p += strspn(p, " ");
+        for (;;) {
+            long idx = strtol(p, &end, 10);
+
+            if (end == p || idx < 0 || idx >= s->nb_streams ||
+                (*end && *end != ',' && *end != ' ')) {
+                av_log(s, AV_LOG_ERROR,
+                       "Invalid stream index in variant map '%s'\n",
+                       hls->variant_map);
+                return AVERROR(EINVAL);
+            }
+            var->stream_map[idx] = 0;
+            if (*end != ',')
+                break;
+            p = end + 1;
+        }
+        p = end;
+    }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        int j, mapped = 0;
+
+        for (j = 0; j < nb_variants; j++)
+            mapped |= hls->variants[j].stream_map[i] >= 0;
+        if (!mapped)
+            av_log(s, AV_LOG_WARNING,
+                   "Stream %d is not part of any variant, dropping it.\n", i);
+    }
 
     return 0;
 }
@@ -441,9 +663,9 @@ static int hls_setup(AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
     const char *pattern = "%d.ts";
-    int basename_size = strlen(s->filename) + strlen(pattern) + 1;
+    int basename_size = strlen(s->filename) + 1;
     char *p;
-    int ret;
+    int i, ret;
 
     if (hls->encrypt)
         basename_size += 7;
@@ -469,35 +691,72 @@ static int hls_setup(AVFormatContext *s)
             return ret;
     }
 
-    if (hls->start_sequence < 0) {
-        ret = hls_recover(s);
-        if (ret < 0)
-            return ret;
-    }
+    if ((ret = hls_parse_variant_map(s)) < 0)
+        return ret;
+
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+        const char *prefix = hls->basename + (hls->encrypt ? 7 : 0);
+        int size = basename_size + strlen(pattern) + 16;
+
+        var->basename = av_malloc(size);
+        var->playlist = av_malloc(size);
+        if (!var->basename || !var->playlist)
+            return AVERROR(ENOMEM);
 
-    av_strlcat(hls->basename, pattern, basename_size);
+        if (hls->nb_variants > 1) {
+            snprintf(var->basename, size, "%s_%d_%s", hls->basename, i, pattern);
+            snprintf(var->playlist, size, "%s_%d.m3u8", prefix, i);
+        } else {
+            snprintf(var->basename, size, "%s%s", hls->basename, pattern);
+            av_strlcpy(var->playlist, s->filename, size);
+        }
+
+        var->sequence = var->start_sequence = FFMAX(hls->start_sequence, 0);
+
+        if (hls->start_sequence < 0) {
+            ret = hls_recover(s, var);
+            if (ret < 0)
+                return ret;
+        }
+    }
 
     return 0;
 }
 
+static void hls_free(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    int i;
+
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+
+        if (var->avf) {
+            ff_format_io_close(s, &var->avf->pb);
+            avformat_free_context(var->avf);
+        }
+        av_freep(&var->basename);
+        av_freep(&var->playlist);
+        av_freep(&var->stream_map);
+        free_entries(var);
+    }
+    av_freep(&hls->variants);
+    hls->nb_variants = 0;
+
+    av_freep(&hls->basename);
+    free_encryption(s);
+}
+
 static int hls_write_header(AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
     int ret, i;
 
-    hls->sequence       = hls->start_sequence;
+    hls->number         = 1;
     hls->recording_time = hls->time * AV_TIME_BASE;
     hls->start_pts      = AV_NOPTS_VALUE;
 
-    for (i = 0; i < s->nb_streams; i++)
-        hls->has_video +=
-            s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
-
-    if (hls->has_video > 1)
-        av_log(s, AV_LOG_WARNING,
-               "More than a single video stream present, "
-               "expect issues decoding it.\n");
-
     hls->oformat = av_guess_format("mpegts", NULL, NULL);
 
     if (!hls->oformat) {
@@ -508,92 +767,116 @@ static int hls_write_header(AVFormatContext *s)
     if ((ret = hls_setup(s)) < 0)
         goto fail;
 
-    if ((ret = hls_mux_init(s)) < 0)
-        goto fail;
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
 
-    if ((ret = hls_start(s)) < 0)
-        goto fail;
+        if ((ret = hls_mux_init(s, var)) < 0)
+            goto fail;
 
-    if ((ret = avformat_write_header(hls->avf, NULL)) < 0)
-        return ret;
+        if ((ret = hls_start(s, var)) < 0)
+            goto fail;
 
+        if ((ret = avformat_write_header(var->avf, NULL)) < 0)
+            goto fail;
+    }
 
-fail:
-    if (ret) {
-        av_free(hls->basename);
-        if (hls->avf)
-            avformat_free_context(hls->avf);
+    if (hls->nb_variants > 1)
+        ret = hls_write_master(s, 0);
 
-        free_encryption(s);
-    }
+fail:
+    if (ret < 0)
+        hls_free(s);
     return ret;
 }
 
 static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     HLSContext *hls = s->priv_data;
-    AVFormatContext *oc = hls->avf;
     AVStream *st = s->streams[pkt->stream_index];
     int64_t end_pts = hls->recording_time * hls->number;
     int64_t pts     = av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q);
-    int ret, can_split = 1;
+    int i, j, ret;
 
     if (hls->start_pts == AV_NOPTS_VALUE) {
         hls->start_pts = pts;
-        hls->end_pts   = pts;
+        for (i = 0; i < hls->nb_variants; i++)
+            hls->variants[i].end_pts = pts;
     }
 
-    if (hls->has_video) {
-        can_split = st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
-                    pkt->flags & AV_PKT_FLAG_KEY;
-    }
-    if (pkt->pts == AV_NOPTS_VALUE)
-        can_split = 0;
-    else
-        hls->duration = pts - hls->end_pts;
-
-    if (can_split && pts - hls->start_pts >= end_pts) {
-        ret = append_entry(hls, hls->duration, av_basename(hls->avf->filename), hls->recovered);
-        hls->recovered = 0;
-        if (ret)
-            return ret;
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
+        int can_split = 1;
 
-        hls->end_pts = pts;
-        hls->duration = 0;
-
-        av_write_frame(oc, NULL); /* Flush any buffered data */
-        ff_format_io_close(s, &oc->pb);
-
-        ret = hls_start(s);
+        if (var->stream_map[pkt->stream_index] < 0)
+            continue;
 
-        if (ret)
-            return ret;
+        if (var->has_video) {
+            can_split = st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+                        pkt->flags & AV_PKT_FLAG_KEY;
+        }
+        if (pkt->pts == AV_NOPTS_VALUE)
+            can_split = 0;
+        else
+            var->duration = pts - var->end_pts;
+
+        /* The first variant reaching the segment boundary sets the cut
+         * point, every variant then splits on its first suitable packet
+         * at or after it, so that the segments of all the renditions
+         * stay aligned. The cut point is not moved again before every
+         * variant has split on it, or has gone a whole segment duration
+         * past it without a packet to split on (a sparse or ended
+         * stream), so that such a variant does not hold back the others;
+         * it splits on the next cut point instead. */
+        if (can_split && !var->split_pending &&
+            pts - hls->start_pts >= end_pts) {
+            int pending = 0;
+
+            for (j = 0; j < hls->nb_variants; j++) {
+                HLSVariant *other = &hls->variants[j];
+                if (other->split_pending &&
+                    pts - hls->split_pts >= hls->recording_time)
+                    other->split_pending = 0;
+                pending |= other->split_pending;
+            }
+            if (!pending) {
+                hls->split_pts = pts;
+                hls->number++;
+                end_pts = hls->recording_time * hls->number;
+                for (j = 0; j < hls->nb_variants; j++)
+                    hls->variants[j].split_pending = 1;
+            }
+        }
 
-        oc = hls->avf;
+        if (can_split && var->split_pending && pts >= hls->split_pts) {
+            if ((ret = hls_split(s, var, pts)) < 0)
+                return ret;
+        }
 
-        if ((ret = hls_window(s, 0)) < 0)
+        ret = ff_write_chained(var->avf, var->stream_map[pkt->stream_index],
+                               pkt, s);
+        if (ret < 0)
             return ret;
     }
 
-    ret = ff_write_chained(oc, pkt->stream_index, pkt, s);
-
-    return ret;
+    return 0;
 }
 
 static int hls_write_trailer(struct AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
-    AVFormatContext *oc = hls->avf;
+    int i;
 
-    av_write_trailer(oc);
-    ff_format_io_close(s, &oc->pb);
-    avformat_free_context(oc);
-    av_free(hls->basename);
-    append_entry(hls, hls->duration, av_basename(hls->avf->filename), 0);
-    hls_window(s, 1);
+    for (i = 0; i < hls->nb_variants; i++) {
+        HLSVariant *var = &hls->variants[i];
 
-    free_entries(hls);
-    free_encryption(s);
+        hls_end_segment(s, var, 1);
+        hls_window(s, var, 1);
+    }
+
+    if (hls->nb_variants > 1)
+        hls_write_master(s, 1);
+
+    hls_free(s);
     return 0;
 }
 
@@ -608,6 +891,7 @@ static const AVOption options[] = {
     {"hls_allow_cache", "explicitly set whether the client MAY (1) or MUST NOT (0) cache media segments", OFFSET(allowcache), AV_OPT_TYPE_INT, {.i64 = -1}, INT_MIN, INT_MAX, E},
     {"hls_base_url",  "url to prepend to each playlist entry",   OFFSET(baseurl), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,       E},
     {"hls_version",   "protocol version",                        OFFSET(version), AV_OPT_TYPE_INT,    {.i64 = 3},     2, 3, E},
+    {"hls_variants",  "space separated list of variants, each a comma separated list of stream indexes", OFFSET(variant_map), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, E},
     {"hls_enc",       "AES128 encryption support",               OFFSET(encrypt), AV_OPT_TYPE_INT,    {.i64 = 0},     0, 1, E},
     {"hls_enc_key",   "use the specified hex-coded 16byte key to encrypt the segments",  OFFSET(key), AV_OPT_TYPE_BINARY, .flags = E},
     {"hls_enc_key_url", "url to access the key to decrypt the segments",    OFFSET(key_url), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0, E},
@@ -94,6 +94,7 @@ typedef struct EbmlList {
 
 typedef struct EbmlBin {
     int      size;
+    AVBufferRef *buf;
     uint8_t *data;
     int64_t  pos;
 } EbmlBin;
@@ -769,15 +770,27 @@ static int ebml_read_ascii(AVIOContext *pb, int size, char **str)
  */
 static int ebml_read_binary(AVIOContext *pb, int length, EbmlBin *bin)
 {
-    av_free(bin->data);
+    av_buffer_unref(&bin->buf);
+    bin->data = NULL;
     bin->size = 0;
+    bin->pos  = avio_tell(pb);
+
+    /* reference large elements such as blocks if the protocol allows it */
+    if (length > pb->buffer_size &&
+        ffio_read_buffer(pb, length, &bin->buf) == length) {
+        bin->data = bin->buf->data;
+        bin->size = length;
+        return 0;
+    }
 
-    if (!(bin->data = av_mallocz(length + AV_INPUT_BUFFER_PADDING_SIZE)))
+    if (!(bin->buf = av_buffer_alloc(length + AV_INPUT_BUFFER_PADDING_SIZE)))
         return AVERROR(ENOMEM);
+    memset(bin->buf->data + length, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    bin->data = bin->buf->data;
 
-    bin->pos  = avio_tell(pb);
     if (avio_read(pb, bin->data, length) != length) {
-        av_freep(&bin->data);
+        av_buffer_unref(&bin->buf);
+        bin->data = NULL;
         return AVERROR(EIO);
     }
 
@@ -995,7 +1008,8 @@ static void ebml_free(EbmlSyntax *syntax, void *data)
             av_freep(data_off);
             break;
         case EBML_BIN:
-            av_freep(&((EbmlBin *) data_off)->data);
+            av_buffer_unref(&((EbmlBin *) data_off)->buf);
+            ((EbmlBin *) data_off)->data = NULL;
             break;
         case EBML_NEST:
             if (syntax[i].list_elem_size) {
@@ -1764,10 +1778,17 @@ static int matroska_parse_tracks(AVFormatContext *s)
                     track->codec_priv.size = 0;
                     av_log(matroska->ctx, AV_LOG_ERROR,
                            "Failed to decode codec private data\n");
+                } else if (codec_priv != track->codec_priv.data) {
+                    av_buffer_unref(&track->codec_priv.buf);
+                    track->codec_priv.buf = av_buffer_create(track->codec_priv.data,
+                                                             track->codec_priv.size,
+                                                             NULL, NULL, 0);
+                    if (!track->codec_priv.buf) {
+                        av_freep(&track->codec_priv.data);
+                        track->codec_priv.size = 0;
+                        return AVERROR(ENOMEM);
+                    }
                 }
-
-                if (codec_priv != track->codec_priv.data)
-                    av_free(codec_priv);
             }
         }
 
@@ -2503,7 +2524,7 @@ fail:
 
 static int matroska_parse_frame(MatroskaDemuxContext *matroska,
                                 MatroskaTrack *track, AVStream *st,
-                                uint8_t *data, int pkt_size,
+                                AVBufferRef *buf, uint8_t *data, int pkt_size,
                                 uint64_t timecode, uint64_t duration,
                                 int64_t pos, int is_keyframe)
 {
@@ -2536,26 +2557,41 @@ static int matroska_parse_frame(MatroskaDemuxContext *matroska,
 
     pkt = av_mallocz(sizeof(AVPacket));
     if (!pkt) {
-        av_freep(&pkt_data);
-        return AVERROR(ENOMEM);
-    }
-    /* XXX: prevent data copy... */
-    if (av_new_packet(pkt, pkt_size + offset) < 0) {
-        av_free(pkt);
-        av_freep(&pkt_data);
+        if (pkt_data != data)
+            av_freep(&pkt_data);
         return AVERROR(ENOMEM);
     }
 
-    if (st->codecpar->codec_id == AV_CODEC_ID_PRORES) {
-        uint8_t *buf = pkt->data;
-        bytestream_put_be32(&buf, pkt_size);
-        bytestream_put_be32(&buf, MKBETAG('i', 'c', 'p', 'f'));
-    }
+    if (buf && pkt_data == data && !offset &&
+        track->type != MATROSKA_TRACK_TYPE_SUBTITLE) {
+        /* reference the block, subtitles are modified in place below */
+        av_init_packet(pkt);
+        pkt->buf = av_buffer_ref(buf);
+        if (!pkt->buf) {
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
+        pkt->data = data;
+        pkt->size = pkt_size;
+    } else {
+        if (av_new_packet(pkt, pkt_size + offset) < 0) {
+            av_free(pkt);
+            if (pkt_data != data)
+                av_freep(&pkt_data);
+            return AVERROR(ENOMEM);
+        }
 
-    memcpy(pkt->data + offset, pkt_data, pkt_size);
+        if (st->codecpar->codec_id == AV_CODEC_ID_PRORES) {
+            uint8_t *hdr = pkt->data;
+            bytestream_put_be32(&hdr, pkt_size);
+            bytestream_put_be32(&hdr, MKBETAG('i', 'c', 'p', 'f'));
+        }
 
-    if (pkt_data != data)
-        av_free(pkt_data);
+        memcpy(pkt->data + offset, pkt_data, pkt_size);
+
+        if (pkt_data != data)
+            av_free(pkt_data);
+    }
 
     pkt->flags        = is_keyframe;
     pkt->stream_index = st->index;
@@ -2596,7 +2632,8 @@ fail:
     return res;
 }
 
-static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
+static int matroska_parse_block(MatroskaDemuxContext *matroska,
+                                AVBufferRef *buf, uint8_t *data,
                                 int size, int64_t pos, uint64_t cluster_time,
                                 uint64_t block_duration, int is_keyframe,
                                 int64_t cluster_pos)
@@ -2607,6 +2644,7 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     AVStream *st;
     int16_t block_time;
     uint32_t *lace_size = NULL;
+    uint8_t *block_end;
     int n, flags, laces = 0;
     uint64_t num, duration;
 
@@ -2658,6 +2696,7 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
 
     if (res)
         goto end;
+    block_end = data + size;
 
     if (block_duration != AV_NOPTS_VALUE) {
         duration = block_duration / laces;
@@ -2686,7 +2725,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
             if (res)
                 goto end;
         } else {
-            res = matroska_parse_frame(matroska, track, st, data, lace_size[n],
+            /* only the last lace is followed by zeroed padding, the
+             * others have to be copied */
+            res = matroska_parse_frame(matroska, track, st,
+                                       data + lace_size[n] == block_end ? buf : NULL,
+                                       data, lace_size[n],
                                        timecode, duration, pos,
                                        !n ? is_keyframe : 0);
             if (res)
@@ -2745,7 +2788,8 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
             if (!blocks[i].non_simple)
                 blocks[i].duration = AV_NOPTS_VALUE;
-            res = matroska_parse_block(matroska, blocks[i].bin.data,
+            res = matroska_parse_block(matroska, blocks[i].bin.buf,
+                                       blocks[i].bin.data,
                                        blocks[i].bin.size, blocks[i].bin.pos,
                                        matroska->current_cluster.timecode,
                                        blocks[i].duration, is_keyframe,
@@ -2780,7 +2824,8 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
             if (!blocks[i].non_simple)
                 blocks[i].duration = AV_NOPTS_VALUE;
-            res = matroska_parse_block(matroska, blocks[i].bin.data,
+            res = matroska_parse_block(matroska, blocks[i].bin.buf,
+                                       blocks[i].bin.data,
                                        blocks[i].bin.size, blocks[i].bin.pos,
                                        cluster.timecode, blocks[i].duration,
                                        is_keyframe, pos);
@@ -76,6 +76,8 @@ static const AVOption options[] = {
     { "use_editlist", "use edit list", offsetof(MOVMuxContext, use_editlist), AV_OPT_TYPE_INT, {.i64 = -1}, -1, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { "fragment_index", "Fragment number of the next fragment", offsetof(MOVMuxContext, fragments), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "frag_interleave", "Interleave samples within fragments (max number of consecutive samples, lower is tighter interleaving, but with more overhead)", offsetof(MOVMuxContext, frag_interleave), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "moov_size", "Reserve space for the moov atom at the beginning of the file", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "moov_duration", "Reserve space for the moov atom of a file of the given duration in seconds", offsetof(MOVMuxContext, reserved_moov_duration), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL },
 };
 
@@ -3917,6 +3919,41 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Rough upper bound of the moov size for a file of the given duration: the
+ * sample tables take a few bytes per sample and per chunk, and the rest is
+ * mostly per track boxes and codec extradata.
+ */
+static int estimate_moov_size(AVFormatContext *s, int duration)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int64_t size = 4096;
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        int64_t samples;
+
+        size += 1024 + mov->tracks[i].vos_len;
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            /* stsz, ctts and the chunk tables, assume 60 fps if unknown */
+            AVRational rate = st->avg_frame_rate;
+            if (rate.num <= 0 || rate.den <= 0)
+                rate = (AVRational){ 60, 1 };
+            samples = av_rescale(duration, rate.num, rate.den);
+            size   += samples * 20;
+        } else if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+            /* stsz and the chunk tables, assume 1024 sample frames */
+            samples = av_rescale(duration, st->codecpar->sample_rate, 1024);
+            size   += samples * 12;
+        } else {
+            size   += duration * 16;
+        }
+    }
+
+    return FFMIN(size, INT_MAX);
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -4126,8 +4163,16 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->reserved_moov_duration && !mov->reserved_moov_size)
+            mov->reserved_moov_size = estimate_moov_size(s, mov->reserved_moov_duration);
+        if (mov->flags & FF_MOV_FLAG_FASTSTART || mov->reserved_moov_size)
             mov->reserved_header_pos = avio_tell(pb);
+        if (mov->reserved_moov_size) {
+            mov->reserved_moov_size = FFMAX(mov->reserved_moov_size, 8);
+            avio_wb32(pb, mov->reserved_moov_size);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, mov->reserved_moov_size - 8);
+        }
         mov_write_mdat_tag(pb, mov);
     }
 
@@ -4242,6 +4287,39 @@ static int compute_sidx_size(AVFormatContext *s)
     return sidx_size;
 }
 
+/*
+ * Write the moov atom into the space reserved in front of the mdat, the data
+ * does not move so the chunk offsets stay the same. The remainder of the
+ * reserved space is left as a free atom. Returns AVERROR(ENOSPC) without
+ * writing anything if the moov atom does not fit.
+ */
+static int write_reserved_moov(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb;
+    int moov_size = get_moov_size(s);
+
+    if (moov_size < 0)
+        return moov_size;
+
+    if (moov_size != mov->reserved_moov_size &&
+        moov_size + 8 > mov->reserved_moov_size) {
+        av_log(s, AV_LOG_WARNING, "The moov atom (%d bytes) does not fit in "
+               "the %d reserved bytes, %s\n", moov_size, mov->reserved_moov_size,
+               mov->flags & FF_MOV_FLAG_FASTSTART ?
+               "moving the data instead" : "writing it at the end of the file");
+        return AVERROR(ENOSPC);
+    }
+
+    avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+    mov_write_moov_tag(pb, mov, s);
+    if (moov_size < mov->reserved_moov_size) {
+        avio_wb32(pb, mov->reserved_moov_size - moov_size);
+        ffio_wfourcc(pb, "free");
+    }
+    return 0;
+}
+
 static int shift_data(AVFormatContext *s)
 {
     int ret = 0, moov_size;
@@ -4345,6 +4423,13 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, moov_pos, SEEK_SET);
 
+        if (mov->reserved_moov_size) {
+            res = write_reserved_moov(s);
+            if (res != AVERROR(ENOSPC))
+                goto error;
+            res = 0;
+        }
+
         if (mov->flags & FF_MOV_FLAG_FASTSTART) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
@@ -169,6 +169,8 @@ typedef struct MOVMuxContext {
     int first_trun;
 
     int64_t reserved_header_pos;
+    int reserved_moov_size; ///< space reserved for the moov atom, 0 if none
+    int reserved_moov_duration;
 
     char *major_brand;
 
@@ -140,6 +140,22 @@ struct MpegTSContext {
 
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+
+    /** bitmap of the pids to drop before any parsing, see discard_pid() */
+    uint32_t discard_map[NB_PID_MAX / 32];
+    /** set when the programs changed and discard_map must be rebuilt */
+    int discard_map_dirty;
+    /** AVProgram.discard == AVDISCARD_ALL state discard_map was built for */
+    uint8_t *programs_discarded;
+    int nb_programs_discarded;
+
+    /** pool for the PES buffers of unbounded size */
+    AVBufferPool *pes_pool;
+
+    /** program to output in raw mode, -1 for the whole stream */
+    int raw_program;
+    /** bitmap of the pids of raw_program */
+    uint32_t raw_pid_map[NB_PID_MAX / 32];
 };
 
 #define MPEGTS_OPTIONS \
@@ -166,6 +182,9 @@ static const AVOption raw_options[] = {
       offsetof(MpegTSContext, raw_packet_size), AV_OPT_TYPE_INT,
       { .i64 = 0 }, 0, 0,
       AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY },
+    { "program",       "Only output the packets of the program with this number, without the PAT.",
+      offsetof(MpegTSContext, raw_program), AV_OPT_TYPE_INT,
+      { .i64 = -1 }, -1, 0xffff, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -222,12 +241,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for (i = 0; i < ts->nb_prg; i++)
         if (ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_map_dirty = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    ts->discard_map_dirty = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -241,6 +262,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    ts->discard_map_dirty = 1;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
@@ -260,6 +282,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
     if (p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_map_dirty = 1;
 }
 
 /**
@@ -304,6 +327,52 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+static void update_discard_map(MpegTSContext *ts)
+{
+    int i, j;
+
+    memset(ts->discard_map, 0, sizeof(ts->discard_map));
+    for (i = 0; i < ts->nb_prg; i++) {
+        struct Program *p = &ts->prg[i];
+        for (j = 0; j < p->nb_pids; j++) {
+            unsigned int pid = p->pids[j];
+            if (pid && discard_pid(ts, pid))
+                ts->discard_map[pid >> 5] |= 1U << (pid & 31);
+        }
+    }
+    ts->discard_map_dirty = 0;
+}
+
+/**
+ * Mark the discard map for rebuilding if the caller changed the program
+ * selection since it was built.
+ */
+static void check_programs_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i;
+
+    if (ts->nb_programs_discarded != s->nb_programs) {
+        if (av_reallocp_array(&ts->programs_discarded, s->nb_programs,
+                              sizeof(*ts->programs_discarded)) < 0) {
+            ts->nb_programs_discarded = 0;
+            ts->discard_map_dirty     = 1;
+            return;
+        }
+        memset(ts->programs_discarded, 0, s->nb_programs);
+        ts->nb_programs_discarded = s->nb_programs;
+        ts->discard_map_dirty     = 1;
+    }
+
+    for (i = 0; i < s->nb_programs; i++) {
+        uint8_t discarded = s->programs[i]->discard == AVDISCARD_ALL;
+        if (ts->programs_discarded[i] != discarded) {
+            ts->programs_discarded[i] = discarded;
+            ts->discard_map_dirty     = 1;
+        }
+    }
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -800,6 +869,23 @@ static int read_sl_header(PESContext *pes, SLConfigDescr *sl,
     return (bitstream_tell(&bc) + 7) >> 3;
 }
 
+static AVBufferRef *alloc_pes_buffer(MpegTSContext *ts, int size)
+{
+    /* Unbounded PES packets, usually video, all get the maximum payload
+     * size: recycle those large buffers instead of allocating each one. */
+    if (size == MAX_PES_PAYLOAD) {
+        if (!ts->pes_pool) {
+            ts->pes_pool = av_buffer_pool_init(MAX_PES_PAYLOAD +
+                                               AV_INPUT_BUFFER_PADDING_SIZE,
+                                               NULL);
+            if (!ts->pes_pool)
+                return NULL;
+        }
+        return av_buffer_pool_get(ts->pes_pool);
+    }
+    return av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+}
+
 /* return non zero if a packet could be constructed */
 static int mpegts_push_data(MpegTSFilter *filter,
                             const uint8_t *buf, int buf_size, int is_start,
@@ -865,8 +951,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = alloc_pes_buffer(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -972,8 +1057,7 @@ skip:
                     pes->data_index + buf_size > pes->total_size) {
                     new_pes_packet(pes, ts->pkt);
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  AV_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = alloc_pes_buffer(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -1803,17 +1887,109 @@ static void sdt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
     }
 }
 
-/* handle one TS packet */
-static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
+static void raw_pmt_cb(MpegTSFilter *filter, const uint8_t *section,
+                       int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    MpegTSSectionFilter *tssf = &filter->u.section_filter;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    int program_info_length, pcr_pid, pid, desc_list_len;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PMT_TID || h->id != ts->raw_program)
+        return;
+    if (h->version == tssf->last_ver)
+        return;
+    tssf->last_ver = h->version;
+
+    pcr_pid = get16(&p, p_end);
+    if (pcr_pid < 0)
+        return;
+    pcr_pid &= 0x1fff;
+    program_info_length = get16(&p, p_end);
+    if (program_info_length < 0)
+        return;
+    p += program_info_length & 0xfff;
+    if (p > p_end)
+        return;
+
+    memset(ts->raw_pid_map, 0, sizeof(ts->raw_pid_map));
+    ts->raw_pid_map[filter->pid >> 5] |= 1U << (filter->pid & 31);
+    ts->raw_pid_map[pcr_pid     >> 5] |= 1U << (pcr_pid     & 31);
+
+    for (;;) {
+        if (get8(&p, p_end) < 0) // stream type
+            break;
+        pid = get16(&p, p_end);
+        if (pid < 0)
+            break;
+        pid &= 0x1fff;
+        desc_list_len = get16(&p, p_end);
+        if (desc_list_len < 0)
+            break;
+        p += desc_list_len & 0xfff;
+        if (p > p_end)
+            break;
+        av_log(ts->stream, AV_LOG_TRACE, "raw program pid=0x%x\n", pid);
+        ts->raw_pid_map[pid >> 5] |= 1U << (pid & 31);
+    }
+}
+
+static void raw_pat_cb(MpegTSFilter *filter, const uint8_t *section,
+                       int section_len)
+{
+    MpegTSContext *ts = filter->u.section_filter.opaque;
+    MpegTSSectionFilter *tssf = &filter->u.section_filter;
+    SectionHeader h1, *h = &h1;
+    const uint8_t *p, *p_end;
+    int sid, pmt_pid;
+
+    p_end = section + section_len - 4;
+    p     = section;
+    if (parse_section_header(h, &p, p_end) < 0)
+        return;
+    if (h->tid != PAT_TID)
+        return;
+    if (h->version == tssf->last_ver)
+        return;
+    tssf->last_ver = h->version;
+
+    for (;;) {
+        sid = get16(&p, p_end);
+        if (sid < 0)
+            break;
+        pmt_pid = get16(&p, p_end);
+        if (pmt_pid < 0)
+            break;
+        pmt_pid &= 0x1fff;
+
+        if (sid == ts->raw_program && pmt_pid != PAT_PID) {
+            if (ts->pids[pmt_pid])
+                mpegts_close_filter(ts, ts->pids[pmt_pid]);
+            mpegts_open_section_filter(ts, pmt_pid, raw_pmt_cb, ts, 1);
+            memset(ts->raw_pid_map, 0, sizeof(ts->raw_pid_map));
+            ts->raw_pid_map[pmt_pid >> 5] |= 1U << (pmt_pid & 31);
+            break;
+        }
+    }
+}
+
+/* handle one TS packet, pos being the position following its 188 bytes */
+static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 {
     MpegTSFilter *tss;
     int len, pid, cc, expected_cc, cc_ok, afc, is_start, is_discontinuity,
         has_adaptation, has_payload;
     const uint8_t *p, *p_end;
-    int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if (pid && discard_pid(ts, pid))
+    if (ts->discard_map_dirty)
+        update_discard_map(ts);
+    if (ts->discard_map[pid >> 5] & (1U << (pid & 31)))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -1864,7 +2040,6 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     if (p >= p_end)
         return 0;
 
-    pos = avio_tell(ts->stream->pb);
     MOD_UNLIKELY(ts->pos47, pos, ts->raw_packet_size, ts->pos);
 
     if (tss->type == MPEGTS_SECTION) {
@@ -1984,19 +2159,52 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         }
     }
 
+    check_programs_discard(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
     for (;;) {
+        AVIOContext *pb = s->pb;
+        int avail;
+
         if (ts->stop_parse > 0)
             break;
+
+        /* Handle the synchronized packets already present in the IO
+         * buffer in place, in a single batch. */
+        avail = ffio_peek_buffered(pb, &data);
+        if (avail >= ts->raw_packet_size && data[0] == 0x47) {
+            int64_t pos = avio_tell(pb);
+            int len = 0, done = 0;
+
+            do {
+                packet_num++;
+                if (nb_packets != 0 && packet_num >= nb_packets) {
+                    done = 1;
+                    break;
+                }
+                ret  = handle_packet(ts, data + len, pos + len + TS_PACKET_SIZE);
+                len += ts->raw_packet_size;
+                if (ret != 0) {
+                    done = 1;
+                    break;
+                }
+            } while (!ts->stop_parse && avail - len >= ts->raw_packet_size &&
+                     data[len] == 0x47);
+            avio_skip(pb, len);
+            if (done)
+                break;
+            continue;
+        }
+
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets)
             break;
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
-        ret = handle_packet(ts, data);
+        ret = handle_packet(ts, data, avio_tell(pb));
         finished_reading_packet(s, ts->raw_packet_size);
         if (ret != 0)
             break;
@@ -2155,6 +2363,9 @@ static int mpegts_read_header(AVFormatContext *s)
         st->start_time      = ts->cur_pcr;
         av_log(ts->stream, AV_LOG_TRACE, "start=%0.3f pcr=%0.3f incr=%d\n",
                 st->start_time / 1000000.0, pcrs[0] / 27e6, ts->pcr_incr);
+
+        if (ts->raw_program >= 0)
+            mpegts_open_section_filter(ts, PAT_PID, raw_pat_cb, ts, 1);
     }
 
     avio_seek(pb, pos, SEEK_SET);
@@ -2174,11 +2385,31 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
 
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
-    ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
-    pkt->pos = avio_tell(s->pb);
-    if (ret < 0) {
-        av_packet_unref(pkt);
-        return ret;
+    for (;;) {
+        int pid;
+
+        ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
+        pkt->pos = avio_tell(s->pb);
+        if (ret < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
+        if (ts->raw_program < 0)
+            break;
+
+        /* Track the PSI of the selected program and pass through its
+         * packets only, the PAT being left to the muxer. */
+        pid = AV_RB16(data + 1) & 0x1fff;
+        if (ts->pids[pid] && (ret = handle_packet(ts, data, pkt->pos)) < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
+        if (ts->raw_pid_map[pid >> 5] & (1U << (pid & 31)))
+            break;
+        finished_reading_packet(s, ts->raw_packet_size);
+        /* the PCR increment is per input packet, dropped ones included */
+        if (ts->mpeg2ts_compute_pcr)
+            ts->cur_pcr += ts->pcr_incr;
     }
     if (data != pkt->data)
         memcpy(pkt->data, data, ts->raw_packet_size);
@@ -2191,6 +2422,9 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
             for (i = 0; i < MAX_PACKET_READAHEAD; i++) {
                 avio_seek(s->pb, pos + i * ts->raw_packet_size, SEEK_SET);
                 avio_read(s->pb, pcr_buf, 12);
+                /* other programs have their own clocks */
+                if ((AV_RB16(pcr_buf + 1) & 0x1fff) != (AV_RB16(pkt->data + 1) & 0x1fff))
+                    continue;
                 if (parse_pcr(&next_pcr_h, &next_pcr_l, pcr_buf) == 0) {
                     /* XXX: not precise enough */
                     ts->pcr_incr =
@@ -2207,6 +2441,9 @@ static int mpegts_raw_read_packet(AVFormatContext *s, AVPacket *pkt)
         pkt->duration = ts->pcr_incr;
         ts->cur_pcr  += ts->pcr_incr;
     }
+    /* every forwarded packet can be remuxed on its own */
+    if (ts->raw_program >= 0)
+        pkt->flags |= AV_PKT_FLAG_KEY;
     pkt->stream_index = 0;
     return 0;
 }
@@ -2247,6 +2484,9 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+
+    av_freep(&ts->programs_discarded);
+    av_buffer_pool_uninit(&ts->pes_pool);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
@@ -2355,6 +2595,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
     len1 = len;
     ts->pkt = pkt;
     ts->stop_parse = 0;
+    check_programs_discard(ts);
     for (;;) {
         if (ts->stop_parse > 0)
             break;
@@ -2364,7 +2605,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
             buf++;
             len--;
         } else {
-            handle_packet(ts, buf);
+            handle_packet(ts, buf, avio_tell(ts->stream->pb));
             buf += TS_PACKET_SIZE;
             len -= TS_PACKET_SIZE;
         }
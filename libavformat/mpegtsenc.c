@@ -90,6 +90,18 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_AAC_LATM        0x02
 #define MPEGTS_FLAG_SYSTEM_B        0x04
     int flags;
+
+    int passthrough;         ///< forwarding the TS packets of a single program
+    int passthrough_pmt;     ///< the PMT of the forwarded program was found
+    uint8_t *passthrough_cc; ///< continuity counter of every forwarded pid
+    int passthrough_multi;   ///< the input carries several programs
+    uint32_t passthrough_pids[NB_PID_MAX / 32]; ///< pids of the program
+    uint8_t passthrough_section[1024]; ///< PMT section being gathered
+    int passthrough_section_size; ///< its size so far, -1 when not gathering
+    int tables_version;      ///< version of the generated PAT and SDT
+    int64_t passthrough_pcr; ///< last PCR of the forwarded program
+    int64_t pat_pcr;         ///< PCR at which the PAT was last sent
+    int64_t sdt_pcr;         ///< PCR at which the SDT was last sent
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -223,8 +235,8 @@ static void mpegts_write_pat(AVFormatContext *s)
         put16(&q, service->sid);
         put16(&q, 0xe000 | service->pmt.pid);
     }
-    mpegts_write_section1(&ts->pat, PAT_TID, ts->tsid, 0, 0, 0,
-                          data, q - data);
+    mpegts_write_section1(&ts->pat, PAT_TID, ts->tsid, ts->tables_version,
+                          0, 0, data, q - data);
 }
 
 static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
@@ -450,8 +462,8 @@ static void mpegts_write_sdt(AVFormatContext *s)
         desc_list_len_ptr[0] = val >> 8;
         desc_list_len_ptr[1] = val;
     }
-    mpegts_write_section1(&ts->sdt, SDT_TID, ts->tsid, 0, 0, 0,
-                          data, q - data);
+    mpegts_write_section1(&ts->sdt, SDT_TID, ts->tsid, ts->tables_version,
+                          0, 0, data, q - data);
 }
 
 static MpegTSService *mpegts_add_service(MpegTSWrite *ts, int sid,
@@ -553,9 +565,32 @@ static int mpegts_write_header(AVFormatContext *s)
     ts->sdt.write_packet = section_write_packet;
     ts->sdt.opaque       = s;
 
+    for (i = 0; i < s->nb_streams; i++)
+        if (s->streams[i]->codecpar->codec_id == AV_CODEC_ID_MPEG2TS)
+            ts->passthrough = 1;
+    if (ts->passthrough) {
+        if (s->nb_streams > 1) {
+            av_log(s, AV_LOG_ERROR,
+                   "A transport stream cannot be forwarded along with other streams\n");
+            av_free(service);
+            return AVERROR(EINVAL);
+        }
+        ts->passthrough_cc = av_malloc(NB_PID_MAX);
+        if (!ts->passthrough_cc) {
+            av_free(service);
+            return AVERROR(ENOMEM);
+        }
+        memset(ts->passthrough_cc, 15, NB_PID_MAX);
+        ts->passthrough_pcr = AV_NOPTS_VALUE;
+        ts->passthrough_section_size = -1;
+        ts->pat_pcr         = AV_NOPTS_VALUE;
+        ts->sdt_pcr         = AV_NOPTS_VALUE;
+    }
+
     pids = av_malloc(s->nb_streams * sizeof(*pids));
     if (!pids) {
         av_free(service);
+        av_freep(&ts->passthrough_cc);
         return AVERROR(ENOMEM);
     }
 
@@ -713,6 +748,7 @@ static int mpegts_write_header(AVFormatContext *s)
 fail:
     av_free(service);
     av_free(pids);
+    av_freep(&ts->passthrough_cc);
     for (i = 0; i < s->nb_streams; i++) {
         st    = s->streams[i];
         ts_st = st->priv_data;
@@ -741,8 +777,10 @@ static void retransmit_si_info(AVFormatContext *s)
     if (++ts->pat_packet_count == ts->pat_packet_period) {
         ts->pat_packet_count = 0;
         mpegts_write_pat(s);
-        for (i = 0; i < ts->nb_services; i++)
-            mpegts_write_pmt(s, ts->services[i]);
+        /* a forwarded program carries its own PMT */
+        if (!ts->passthrough)
+            for (i = 0; i < ts->nb_services; i++)
+                mpegts_write_pmt(s, ts->services[i]);
     }
 }
 
@@ -1036,6 +1074,188 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
     avio_flush(s->pb);
 }
 
+/* Send the SDT and PAT of a forwarded program regularly, in time based on
+ * its PCR, or every few packets if it has none. */
+static void passthrough_retransmit_si_info(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int64_t pcr = ts->passthrough_pcr;
+
+    if (pcr == AV_NOPTS_VALUE) {
+        retransmit_si_info(s);
+        return;
+    }
+
+    /* a count set to period - 1 requests an immediate retransmission */
+    if (ts->sdt_packet_count == ts->sdt_packet_period - 1 ||
+        ts->sdt_pcr == AV_NOPTS_VALUE || pcr < ts->sdt_pcr ||
+        pcr - ts->sdt_pcr >= SDT_RETRANS_TIME * (int64_t)(PCR_TIME_BASE / 1000)) {
+        ts->sdt_packet_count = 0;
+        ts->sdt_pcr          = pcr;
+        mpegts_write_sdt(s);
+    }
+    if (ts->pat_packet_count == ts->pat_packet_period - 1 ||
+        ts->pat_pcr == AV_NOPTS_VALUE || pcr < ts->pat_pcr ||
+        pcr - ts->pat_pcr >= PAT_RETRANS_TIME * (int64_t)(PCR_TIME_BASE / 1000)) {
+        ts->pat_packet_count = 0;
+        ts->pat_pcr          = pcr;
+        mpegts_write_pat(s);
+    }
+}
+
+/* Collect the PCR and elementary stream pids of the forwarded program from
+ * its complete PMT section. */
+static void passthrough_parse_pmt(MpegTSWrite *ts, MpegTSService *service,
+                                  const uint8_t *p, const uint8_t *p_end)
+{
+    const uint8_t *end = p_end - 4;
+    int pid;
+
+    if (end < p + 12)
+        return;
+
+    memset(ts->passthrough_pids, 0, sizeof(ts->passthrough_pids));
+    service->pcr_pid = AV_RB16(p + 8) & 0x1fff;
+    ts->passthrough_pids[service->pcr_pid >> 5] |= 1U << (service->pcr_pid & 31);
+    p += 12 + (AV_RB16(p + 10) & 0xfff);
+    while (p + 5 <= end) {
+        pid = AV_RB16(p + 1) & 0x1fff;
+        ts->passthrough_pids[pid >> 5] |= 1U << (pid & 31);
+        p += 5 + (AV_RB16(p + 3) & 0xfff);
+    }
+}
+
+/* Gather the PMT section of the forwarded program, which may span several
+ * TS packets, and parse it once it is complete. */
+static void passthrough_add_pmt_data(MpegTSWrite *ts, MpegTSService *service,
+                                     const uint8_t *p, int len, int start)
+{
+    uint8_t *section = ts->passthrough_section;
+    int size = start ? 0 : ts->passthrough_section_size;
+    int section_size;
+
+    if (size < 0)
+        return;
+    len = FFMIN(len, sizeof(ts->passthrough_section) - size);
+    memcpy(section + size, p, len);
+    size += len;
+    ts->passthrough_section_size = size;
+    if (size < 3)
+        return;
+
+    section_size = 3 + (AV_RB16(section + 1) & 0xfff);
+    if (section_size > sizeof(ts->passthrough_section)) {
+        ts->passthrough_section_size = -1;
+        return;
+    }
+    if (size < section_size)
+        return;
+    ts->passthrough_section_size = -1;
+    passthrough_parse_pmt(ts, service, section, section + section_size);
+}
+
+/* Forward the TS packets of a single program untouched, except for the
+ * continuity counters which are rewritten. The PAT and SDT are generated
+ * for the program, based on its PMT. Only the first program found is
+ * forwarded if the input carries several. */
+static int mpegts_write_passthrough(AVFormatContext *s, const AVPacket *pkt)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSService *service = ts->services[0];
+    const uint8_t *buf = pkt->data;
+    int size = pkt->size;
+
+    if (size % TS_PACKET_SIZE) {
+        av_log(s, AV_LOG_ERROR,
+               "Forwarded packet size %d is not a multiple of %d\n",
+               size, TS_PACKET_SIZE);
+        return AVERROR_INVALIDDATA;
+    }
+
+    for (; size > 0; buf += TS_PACKET_SIZE, size -= TS_PACKET_SIZE) {
+        uint8_t packet[TS_PACKET_SIZE];
+        int pid = AV_RB16(buf + 1) & 0x1fff;
+
+        if (buf[0] != 0x47) {
+            av_log(s, AV_LOG_ERROR, "Forwarded packet without sync byte\n");
+            return AVERROR_INVALIDDATA;
+        }
+        if (pid == PAT_PID || pid == SDT_PID || pid == 0x1fff)
+            continue;
+
+        /* look for the PMT at the start of the sections */
+        if ((buf[1] & 0x40) && (buf[3] & 0x10)) {
+            const uint8_t *p = buf + 4, *p_end = buf + TS_PACKET_SIZE;
+
+            if (buf[3] & 0x20)
+                p += p[0] + 1;
+            if (p < p_end)
+                p += p[0] + 1;
+            if (p + 5 <= p_end && p[0] == PMT_TID) {
+                int sid = AV_RB16(p + 3);
+
+                if (ts->passthrough_pmt && pid != service->pmt.pid) {
+                    /* the PMT of another program */
+                    if (!ts->passthrough_multi)
+                        av_log(s, AV_LOG_WARNING, "Ignoring program %d, only "
+                               "program %d is forwarded\n", sid, service->sid);
+                    ts->passthrough_multi = 1;
+                    continue;
+                }
+                if (!ts->passthrough_pmt || sid != service->sid) {
+                    av_log(s, AV_LOG_VERBOSE,
+                           "Forwarding program %d with PMT pid 0x%x\n",
+                           sid, pid);
+                    /* signal the new service id in the PAT and SDT */
+                    if (ts->passthrough_pmt)
+                        ts->tables_version = (ts->tables_version + 1) & 0x1f;
+                    memset(ts->passthrough_pids, 0, sizeof(ts->passthrough_pids));
+                    service->sid         = sid;
+                    service->pmt.pid     = pid;
+                    service->pcr_pid     = 0x1fff;
+                    ts->passthrough_pmt  = 1;
+                    ts->pat_packet_count = ts->pat_packet_period - 1;
+                    ts->sdt_packet_count = ts->sdt_packet_period - 1;
+                }
+                passthrough_add_pmt_data(ts, service, p, p_end - p, 1);
+            }
+        } else if (ts->passthrough_pmt && pid == service->pmt.pid &&
+                   (buf[3] & 0x10)) {
+            const uint8_t *p = buf + 4;
+
+            if (buf[3] & 0x20)
+                p += p[0] + 1;
+            if (p < buf + TS_PACKET_SIZE)
+                passthrough_add_pmt_data(ts, service, p,
+                                         buf + TS_PACKET_SIZE - p, 0);
+        }
+        /* nothing can be decoded before the PMT, and only its pids are
+         * forwarded once it has been parsed */
+        if (!ts->passthrough_pmt)
+            continue;
+        if (pid != service->pmt.pid &&
+            !(ts->passthrough_pids[pid >> 5] & (1U << (pid & 31))))
+            continue;
+
+        /* track the program clock, for the SI retransmission */
+        if (pid == service->pcr_pid && (buf[3] & 0x20) && buf[4] >= 7 &&
+            (buf[5] & 0x10))
+            ts->passthrough_pcr = ((int64_t)AV_RB32(buf + 6) << 1 | buf[10] >> 7) * 300 +
+                                  (AV_RB16(buf + 10) & 0x1ff);
+
+        passthrough_retransmit_si_info(s);
+
+        memcpy(packet, buf, TS_PACKET_SIZE);
+        if (packet[3] & 0x10)
+            ts->passthrough_cc[pid] = (ts->passthrough_cc[pid] + 1) & 0xf;
+        packet[3] = (packet[3] & 0xf0) | ts->passthrough_cc[pid];
+        mpegts_prefix_m2ts_header(s);
+        avio_write(s->pb, packet, TS_PACKET_SIZE);
+    }
+
+    return 0;
+}
+
 static int mpegts_write_packet_internal(AVFormatContext *s, AVPacket *pkt)
 {
     AVStream *st = s->streams[pkt->stream_index];
@@ -1060,6 +1280,9 @@ static int mpegts_write_packet_internal(AVFormatContext *s, AVPacket *pkt)
         ts->flags           &= ~MPEGTS_FLAG_REEMIT_PAT_PMT;
     }
 
+    if (ts->passthrough)
+        return mpegts_write_passthrough(s, pkt);
+
     if (pkt->pts != AV_NOPTS_VALUE)
         pts = pkt->pts + delay;
     if (pkt->dts != AV_NOPTS_VALUE)
@@ -1226,6 +1449,7 @@ static int mpegts_write_end(AVFormatContext *s)
         av_free(service);
     }
     av_free(ts->services);
+    av_freep(&ts->passthrough_cc);
 
     return 0;
 }
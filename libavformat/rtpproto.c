@@ -26,6 +26,7 @@
 
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -57,6 +58,9 @@ typedef struct RTPContext {
     int pkt_size;
     char *sources;
     char *block;
+    int batch;
+    int64_t bitrate;
+    uint32_t batch_timestamp;   ///< timestamp of the queued RTP packets
 } RTPContext;
 
 #define OFFSET(x) offsetof(RTPContext, x)
@@ -73,6 +77,8 @@ static const AVOption options[] = {
     { "pkt_size",           "Maximum packet size",                                              OFFSET(pkt_size),        AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "sources",            "Source list",                                                      OFFSET(sources),         AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",              "Block list",                                                       OFFSET(block),           AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch",              "Maximum number of RTP packets of a frame to send per system call",  OFFSET(batch),           AV_OPT_TYPE_INT,    { .i64 =  0 },     0, 1024,    .flags = E },
+    { "bitrate",            "Pace the RTP output to this bitrate (in bits/s)",                  OFFSET(bitrate),         AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
     { NULL }
 };
 
@@ -226,7 +232,8 @@ static void build_udp_url(RTPContext *s,
                           const char *hostname,
                           int port, int local_port,
                           const char *include_sources,
-                          const char *exclude_sources)
+                          const char *exclude_sources,
+                          int batch, int64_t bitrate)
 {
     ff_url_join(buf, buf_size, "udp", NULL, hostname, port, NULL);
     if (local_port >= 0)
@@ -243,6 +250,10 @@ static void build_udp_url(RTPContext *s,
         url_add_option(buf, buf_size, "sources=%s", include_sources);
     if (exclude_sources && exclude_sources[0])
         url_add_option(buf, buf_size, "block=%s", exclude_sources);
+    if (batch > 1)
+        url_add_option(buf, buf_size, "batch=%d", batch);
+    if (bitrate > 0)
+        url_add_option(buf, buf_size, "bitrate=%"PRId64, bitrate);
 }
 
 static void rtp_parse_addr_list(URLContext *h, char *buf,
@@ -298,6 +309,8 @@ static void rtp_parse_addr_list(URLContext *h, char *buf,
  *         'sources=ip[,ip]'  : list allowed source IP addresses
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
+ *         'batch=n'          : send up to n RTP packets of a frame per system call
+ *         'bitrate=n'        : pace the RTP output to n bits per second
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -349,6 +362,12 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "write_to_source", p)) {
             s->write_to_source = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch", p)) {
+            s->batch = FFMIN(FFMAX(strtoll(buf, NULL, 10), 0), 1024);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = FFMAX(strtoll(buf, NULL, 10), 0);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             av_strlcpy(include_sources, buf, sizeof(include_sources));
 
@@ -366,8 +385,11 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
     }
 
+    if (s->write_to_source)
+        s->batch = 0;
     build_udp_url(s, buf, sizeof(buf),
-                  hostname, rtp_port, s->local_rtpport, sources, block);
+                  hostname, rtp_port, s->local_rtpport, sources, block,
+                  s->batch, s->bitrate);
     if (ffurl_open(&s->rtp_hd, buf, flags, &h->interrupt_callback, NULL,
                    h->protocols, h) < 0)
         goto fail;
@@ -375,7 +397,8 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         s->local_rtcpport = ff_udp_get_local_port(s->rtp_hd) + 1;
 
     build_udp_url(s, buf, sizeof(buf),
-                  hostname, s->rtcp_port, s->local_rtcpport, sources, block);
+                  hostname, s->rtcp_port, s->local_rtcpport, sources, block,
+                  0, 0);
     if (ffurl_open(&s->rtcp_hd, buf, flags, &h->interrupt_callback, NULL,
                    h->protocols, h) < 0)
         goto fail;
@@ -508,6 +531,25 @@ static int rtp_write(URLContext *h, const uint8_t *buf, int size)
     } else {
         /* RTP payload type */
         hd = s->rtp_hd;
+
+        if (s->batch > 1 && size >= 8) {
+            /* the packets of a frame share a timestamp and are queued
+             * together, the frame is sent once the marker bit ends it or
+             * the next frame starts */
+            uint32_t timestamp = AV_RB32(buf + 4);
+            if (timestamp != s->batch_timestamp &&
+                (ret = ff_udp_flush(hd)) < 0)
+                return ret;
+            s->batch_timestamp = timestamp;
+
+            ret = ffurl_write(hd, buf, size);
+            if (ret >= 0 && buf[1] & 0x80) {
+                int err = ff_udp_flush(hd);
+                if (err < 0)
+                    return err;
+            }
+            return ret;
+        }
     }
 
     ret = ffurl_write(hd, buf, size);
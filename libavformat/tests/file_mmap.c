@@ -0,0 +1,147 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/dict.h"
+
+#include "libavformat/avformat.h"
+
+#define PKT_SIZE (1 << 16)
+#define NB_PKTS  4
+
+static int check_faults;
+
+static uint8_t pattern(int64_t pos)
+{
+    return pos % 251 + 1;
+}
+
+static int write_file(const char *filename)
+{
+    uint8_t buf[PKT_SIZE];
+    FILE *f = fopen(filename, "wb");
+    int i, j;
+
+    if (!f) {
+        perror(filename);
+        return 1;
+    }
+    for (i = 0; i < NB_PKTS; i++) {
+        for (j = 0; j < PKT_SIZE; j++)
+            buf[j] = pattern((int64_t)i * PKT_SIZE + j);
+        fwrite(buf, 1, PKT_SIZE, f);
+    }
+    fclose(f);
+    return 0;
+}
+
+static void check_packet(AVPacket *pkt, int use_mmap, int hold, int i)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    int j, mapped, data_ok = 1, padding_ok = 1;
+
+    /* the packets read and copied are writable, the mapped ones are not
+     * and lie at the same offset within a page as in the file */
+    mapped = !av_buffer_is_writable(pkt->buf);
+    if (mapped && page > 0 &&
+        ((uintptr_t)pkt->data & (page - 1)) != (pkt->pos & (page - 1))) {
+        printf("mmap %d packet %d: data not from a mapping of the file\n",
+               use_mmap, i);
+        check_faults++;
+    }
+    for (j = 0; j < pkt->size; j++)
+        data_ok &= pkt->data[j] == pattern(pkt->pos + j);
+    for (j = 0; j < AV_INPUT_BUFFER_PADDING_SIZE; j++)
+        padding_ok &= !pkt->data[pkt->size + j];
+    check_faults += !data_ok + !padding_ok;
+
+    printf("mmap %d%s packet %d pos %"PRId64" size %d %s, data %s, padding %s\n",
+           use_mmap, hold ? " held" : "", i, pkt->pos, pkt->size,
+           mapped ? "mapped" : "copied",
+           data_ok ? "ok" : "wrong", padding_ok ? "zeroed" : "not zeroed");
+}
+
+/* Read the packets one after the other, each right after the previous
+ * one, and check each as it is read or, if hold is set, all of them once
+ * they are all read. */
+static void read_packets(const char *filename, int use_mmap, int hold)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkts[NB_PKTS];
+    int i, nb_pkts = 0, ret;
+
+    av_dict_set(&opts, "mmap", use_mmap ? "1" : "0", 0);
+    ret = avio_open2(&pb, filename, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        printf("failed to open %s\n", filename);
+        check_faults++;
+        return;
+    }
+
+    for (i = 0; i < NB_PKTS; i++) {
+        AVPacket *pkt = &pkts[nb_pkts];
+
+        ret = av_get_packet(pb, pkt, PKT_SIZE);
+        if (ret != PKT_SIZE) {
+            printf("mmap %d packet %d: read %d bytes\n", use_mmap, i, ret);
+            check_faults++;
+            av_packet_unref(pkt);
+            break;
+        }
+        if (hold) {
+            nb_pkts++;
+        } else {
+            check_packet(pkt, use_mmap, hold, i);
+            av_packet_unref(pkt);
+        }
+    }
+    for (i = 0; i < nb_pkts; i++) {
+        check_packet(&pkts[i], use_mmap, hold, i);
+        av_packet_unref(&pkts[i]);
+    }
+
+    avio_closep(&pb);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = argc > 1 ? argv[1] : "file_mmap.bin";
+
+    av_register_all();
+
+    if (write_file(filename))
+        return 1;
+
+    read_packets(filename, 0, 0);
+    // All but the last packet, whose padding would run past the end of
+    // the file, are mapped.
+    read_packets(filename, 1, 0);
+    // The padding of each packet covers the start of the next one, which
+    // is only put back once the packet is released.
+    read_packets(filename, 1, 1);
+
+    unlink(filename);
+
+    return check_faults > 0 ? 1 : 0;
+}
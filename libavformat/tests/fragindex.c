@@ -0,0 +1,268 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+
+#include "libavformat/avformat.h"
+
+static const uint8_t h264_extradata[] = {
+    0x01, 0x4d, 0x40, 0x1e, 0xff, 0xe1, 0x00, 0x02, 0x67, 0x4d, 0x01, 0x00, 0x02, 0x68, 0xef
+};
+static const uint8_t aac_extradata[] = {
+    0x12, 0x10
+};
+
+typedef struct Buffer {
+    uint8_t *data;
+    int size;
+    int pos;
+} Buffer;
+
+static int add_stream(AVFormatContext *ctx, enum AVMediaType type,
+                      enum AVCodecID codec_id, const uint8_t *extradata,
+                      int extradata_size, int time_base)
+{
+    AVStream *st = avformat_new_stream(ctx, NULL);
+
+    if (!st)
+        return AVERROR(ENOMEM);
+    st->codecpar->codec_type = type;
+    st->codecpar->codec_id   = codec_id;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        st->codecpar->width  = 640;
+        st->codecpar->height = 480;
+    } else {
+        st->codecpar->sample_rate = 44100;
+        st->codecpar->channels    = 2;
+    }
+    st->time_base = (AVRational){ 1, time_base };
+    st->codecpar->extradata = av_mallocz(extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!st->codecpar->extradata)
+        return AVERROR(ENOMEM);
+    memcpy(st->codecpar->extradata, extradata, extradata_size);
+    st->codecpar->extradata_size = extradata_size;
+    return 0;
+}
+
+/* three 10 frame gops of video at 25 fps with the matching aac audio */
+static int mux(const char *movflags, Buffer *buf)
+{
+    AVFormatContext *ctx = NULL;
+    AVDictionary *opts = NULL;
+    int64_t audio_dts = 0, video_dts = 0;
+    int frames = 0, ret;
+
+    ctx = avformat_alloc_context();
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    ctx->oformat = av_guess_format("mp4", NULL, NULL);
+    ctx->flags |= AVFMT_FLAG_BITEXACT;
+    if ((ret = add_stream(ctx, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_H264,
+                          h264_extradata, sizeof(h264_extradata), 25)) < 0 ||
+        (ret = add_stream(ctx, AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_AAC,
+                          aac_extradata, sizeof(aac_extradata), 44100)) < 0 ||
+        (ret = avio_open_dyn_buf(&ctx->pb)) < 0)
+        goto end;
+
+    av_dict_set(&opts, "movflags", movflags, 0);
+    if ((ret = avformat_write_header(ctx, &opts)) < 0)
+        goto end;
+
+    while (frames < 30) {
+        AVPacket pkt;
+        uint8_t data[4];
+
+        av_init_packet(&pkt);
+        if (av_compare_ts(audio_dts, ctx->streams[1]->time_base,
+                          video_dts, ctx->streams[0]->time_base) < 0) {
+            pkt.stream_index = 1;
+            pkt.dts = pkt.pts = audio_dts;
+            pkt.duration = 1024;
+            pkt.flags |= AV_PKT_FLAG_KEY;
+            audio_dts += 1024;
+        } else {
+            pkt.stream_index = 0;
+            pkt.dts = pkt.pts = video_dts;
+            pkt.duration = 1;
+            if (frames % 10 == 0)
+                pkt.flags |= AV_PKT_FLAG_KEY;
+            video_dts++;
+            frames++;
+        }
+        AV_WB32(data, pkt.pts);
+        pkt.data = data;
+        pkt.size = sizeof(data);
+        if ((ret = av_write_frame(ctx, &pkt)) < 0)
+            goto end;
+    }
+    ret = av_write_trailer(ctx);
+
+end:
+    av_dict_free(&opts);
+    if (ctx->pb)
+        buf->size = avio_close_dyn_buf(ctx->pb, &buf->data);
+    avformat_free_context(ctx);
+    return ret;
+}
+
+static int io_read(void *opaque, uint8_t *data, int size)
+{
+    Buffer *buf = opaque;
+
+    size = FFMIN(size, buf->size - buf->pos);
+    if (size <= 0)
+        return AVERROR_EOF;
+    memcpy(data, buf->data + buf->pos, size);
+    buf->pos += size;
+    return size;
+}
+
+static int64_t io_seek(void *opaque, int64_t offset, int whence)
+{
+    Buffer *buf = opaque;
+
+    if (whence == AVSEEK_SIZE)
+        return buf->size;
+    if (whence != SEEK_SET || offset < 0 || offset > buf->size)
+        return AVERROR(EINVAL);
+    buf->pos = offset;
+    return offset;
+}
+
+static int build(Buffer *buf, int seekable, int flags, AVFragmentIndex **index)
+{
+    AVIOContext *pb;
+    uint8_t *iobuf = av_malloc(4096);
+    int ret;
+
+    if (!iobuf)
+        return AVERROR(ENOMEM);
+    pb = avio_alloc_context(iobuf, 4096, 0, buf, io_read, NULL,
+                            seekable ? io_seek : NULL);
+    if (!pb) {
+        av_free(iobuf);
+        return AVERROR(ENOMEM);
+    }
+    buf->pos = 0;
+    ret = av_fragment_index_build(pb, index, flags);
+    av_freep(&pb->buffer);
+    av_freep(&pb);
+    return ret;
+}
+
+static void print_index(const AVFragmentIndex *index)
+{
+    int i, j;
+
+    if (index->sidx_offset >= 0)
+        printf("sidx %"PRId64" %"PRId64"\n", index->sidx_offset, index->sidx_size);
+    for (i = 0; i < index->nb_tracks; i++) {
+        const AVFragmentIndexTrack *t = &index->tracks[i];
+        printf("track %d timescale %d entries %d\n",
+               t->track_id, t->timescale, t->nb_entries);
+        for (j = 0; j < t->nb_entries; j++) {
+            const AVFragmentIndexEntry *e = &t->entries[j];
+            printf("  time %"PRId64" duration %"PRId64" offset %"PRId64
+                   " size %"PRId64" key %d\n",
+                   e->time, e->duration, e->offset, e->size, e->keyframe);
+        }
+    }
+}
+
+static int same_index(const AVFragmentIndex *a, const AVFragmentIndex *b)
+{
+    int i, j;
+
+    if (a->nb_tracks != b->nb_tracks)
+        return 0;
+    for (i = 0; i < a->nb_tracks; i++) {
+        const AVFragmentIndexTrack *ta = &a->tracks[i], *tb = &b->tracks[i];
+        if (ta->track_id != tb->track_id || ta->timescale != tb->timescale ||
+            ta->nb_entries != tb->nb_entries)
+            return 0;
+        for (j = 0; j < ta->nb_entries; j++) {
+            const AVFragmentIndexEntry *ea = &ta->entries[j], *eb = &tb->entries[j];
+            if (ea->time != eb->time || ea->duration != eb->duration ||
+                ea->offset != eb->offset || ea->size != eb->size ||
+                ea->keyframe != eb->keyframe)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static const struct {
+    const char *name;
+    const char *movflags;
+} tests[] = {
+    { "mfra", "frag_keyframe+empty_moov" },
+    { "sidx", "frag_keyframe+empty_moov+dash" },
+    { "scan", "frag_keyframe+empty_moov+skip_trailer" },
+};
+
+int main(void)
+{
+    int i, ret = 0;
+
+    av_register_all();
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        AVFragmentIndex *index = NULL, *scan = NULL, *stream = NULL;
+        AVFragmentIndex *sidx = NULL;
+        Buffer buf = { 0 };
+        int j, nb_entries = 0;
+
+        printf("%s\n", tests[i].name);
+        if (mux(tests[i].movflags, &buf) < 0 ||
+            build(&buf, 1, 0, &index) < 0 ||
+            build(&buf, 1, AV_FRAGMENT_INDEX_SCAN, &scan) < 0 ||
+            build(&buf, 0, 0, &stream) < 0 ||
+            build(&buf, 1, AV_FRAGMENT_INDEX_SIDX, &sidx) < 0) {
+            printf("failed\n");
+            ret = 1;
+        } else {
+            print_index(index);
+            if (!same_index(index, scan)) {
+                printf("differs from the moof scan\n");
+                print_index(scan);
+                ret = 1;
+            }
+            if (!same_index(index, stream)) {
+                printf("differs from the unseekable read\n");
+                print_index(stream);
+                ret = 1;
+            }
+            for (j = 0; j < sidx->nb_tracks; j++)
+                nb_entries += sidx->tracks[j].nb_entries;
+            printf("sidx only: sidx %"PRId64" %"PRId64" entries %d\n",
+                   sidx->sidx_offset, sidx->sidx_size, nb_entries);
+        }
+        av_fragment_index_free(&index);
+        av_fragment_index_free(&scan);
+        av_fragment_index_free(&stream);
+        av_fragment_index_free(&sidx);
+        av_free(buf.data);
+    }
+
+    return ret;
+}
@@ -50,6 +50,10 @@ uint8_t iobuf[32768];
 AVDictionary *opts;
 
 int write_file;
+int seekable;
+uint8_t *seek_buf;
+unsigned int seek_buf_alloc;
+int seek_buf_pos, read_pos;
 const char *cur_name;
 FILE* out;
 int out_size;
@@ -97,6 +101,17 @@ static void reset_count_warnings(void)
 
 static int io_write(void *opaque, uint8_t *buf, int size)
 {
+    if (seekable) {
+        uint8_t *ptr = av_fast_realloc(seek_buf, &seek_buf_alloc,
+                                       seek_buf_pos + size);
+        if (!ptr)
+            return AVERROR(ENOMEM);
+        seek_buf = ptr;
+        memcpy(seek_buf + seek_buf_pos, buf, size);
+        seek_buf_pos += size;
+        out_size = FFMAX(out_size, seek_buf_pos);
+        return size;
+    }
     out_size += size;
     av_md5_update(md5, buf, size);
     if (out)
@@ -104,6 +119,58 @@ static int io_write(void *opaque, uint8_t *buf, int size)
     return size;
 }
 
+static int64_t io_seek(void *opaque, int64_t offset, int whence)
+{
+    int *pos = opaque;
+    switch (whence) {
+    case SEEK_SET: break;
+    case SEEK_CUR: offset += *pos;   break;
+    case SEEK_END: offset += out_size; break;
+    case AVSEEK_SIZE: return out_size;
+    default: return AVERROR(EINVAL);
+    }
+    if (offset < 0 || offset > out_size)
+        return AVERROR(EINVAL);
+    *pos = offset;
+    return offset;
+}
+
+static int io_read(void *opaque, uint8_t *buf, int size)
+{
+    size = FFMIN(size, out_size - read_pos);
+    if (size <= 0)
+        return AVERROR_EOF;
+    memcpy(buf, seek_buf + read_pos, size);
+    read_pos += size;
+    return size;
+}
+
+// The muxer reopens its own output for reading when moving the moov to
+// the start of the file; hand it a reader over the written data.
+static int io_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                   int flags, AVDictionary **options)
+{
+    uint8_t *buf;
+    if (flags != AVIO_FLAG_READ)
+        return AVERROR(EINVAL);
+    buf = av_malloc(4096);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    read_pos = 0;
+    *pb = avio_alloc_context(buf, 4096, 0, &read_pos, io_read, NULL, io_seek);
+    if (!*pb) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static void io_close(AVFormatContext *s, AVIOContext *pb)
+{
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+}
+
 static int io_write_data_type(void *opaque, uint8_t *buf, int size,
                               enum AVIODataMarkerType type, int64_t time)
 {
@@ -140,6 +207,7 @@ static void init_out(const char *name)
     snprintf(buf, sizeof(buf), "%s.%s", cur_name, format);
 
     av_md5_init(md5);
+    seek_buf_pos = 0;
     if (write_file) {
         out = fopen(buf, "wb");
         if (!out)
@@ -151,6 +219,11 @@ static void init_out(const char *name)
 static void close_out(void)
 {
     int i;
+    if (seekable) {
+        av_md5_update(md5, seek_buf, out_size);
+        if (out)
+            fwrite(seek_buf, 1, out_size, out);
+    }
     av_md5_final(md5, hash);
     for (i = 0; i < HASH_SIZE; i++)
         printf("%02x", hash[i]);
@@ -174,6 +247,33 @@ static void check_func(int value, int line, const char *msg, ...)
 }
 #define check(value, ...) check_func(value, __LINE__, __VA_ARGS__)
 
+// Returns the offset of the n:th top level atom of the seekable output,
+// or -1 if there aren't that many.
+static int atom_pos(int n)
+{
+    int pos = 0;
+    while (n-- > 0) {
+        if (pos + 8 > out_size)
+            return -1;
+        pos += AV_RB32(&seek_buf[pos]);
+    }
+    return pos + 8 <= out_size ? pos : -1;
+}
+
+static int is_atom(int n, const char *type)
+{
+    int pos = atom_pos(n);
+    return pos >= 0 && !memcmp(&seek_buf[pos + 4], type, 4);
+}
+
+static int num_atoms(void)
+{
+    int n = 0;
+    while (atom_pos(n) >= 0)
+        n++;
+    return n;
+}
+
 static void init_fps(int bf, int audio_preroll, int fps)
 {
     AVStream *st;
@@ -184,10 +284,17 @@ static void init_fps(int bf, int audio_preroll, int fps)
     ctx->oformat = av_guess_format(format, NULL, NULL);
     if (!ctx->oformat)
         exit(1);
-    ctx->pb = avio_alloc_context(iobuf, iobuf_size, AVIO_FLAG_WRITE, NULL, NULL, io_write, NULL);
+    if (seekable) {
+        ctx->pb = avio_alloc_context(iobuf, iobuf_size, AVIO_FLAG_WRITE, &seek_buf_pos, NULL, io_write, io_seek);
+        ctx->io_open  = io_open;
+        ctx->io_close = io_close;
+    } else {
+        ctx->pb = avio_alloc_context(iobuf, iobuf_size, AVIO_FLAG_WRITE, NULL, NULL, io_write, NULL);
+    }
     if (!ctx->pb)
         exit(1);
-    ctx->pb->write_data_type = io_write_data_type;
+    if (!seekable)
+        ctx->pb->write_data_type = io_write_data_type;
     ctx->flags |= AVFMT_FLAG_BITEXACT;
 
     st = avformat_new_stream(ctx, NULL);
@@ -761,6 +868,73 @@ int main(int argc, char **argv)
     finish();
     close_out();
 
+    // The remaining tests write a plain, non-fragmented file to a seekable
+    // output, reserving space for the moov atom at the start of the file.
+    // The mdat is always preceded by an 8 byte free atom, kept as a
+    // placeholder for a 64 bit mdat size.
+    seekable = 1;
+
+    // The moov fits in the reserved space; the rest of it is left as a
+    // free atom in between the moov and the mdat.
+    init_count_warnings();
+    init_out("moov-size");
+    av_dict_set(&opts, "moov_size", "4096", 0);
+    init(0, 0);
+    mux_gops(2);
+    finish();
+    close_out();
+    reset_count_warnings();
+    check(num_warnings == 0, "Warnings printed when the moov fits");
+    check(is_atom(1, "moov") && is_atom(2, "free") && is_atom(4, "mdat") &&
+          atom_pos(3) == 4096 + atom_pos(1), "moov not written in the reserved space");
+
+    // Same, but with the space estimated from the expected duration.
+    init_count_warnings();
+    init_out("moov-duration");
+    av_dict_set(&opts, "moov_duration", "2", 0);
+    init(0, 0);
+    mux_gops(2);
+    finish();
+    close_out();
+    reset_count_warnings();
+    check(num_warnings == 0, "Warnings printed when the moov fits");
+    check(is_atom(1, "moov") && is_atom(2, "free") && is_atom(4, "mdat"),
+          "moov not written in the space reserved for the duration");
+
+    // The moov doesn't fit; with faststart, the data is shifted to make
+    // room for it in front of the reserved space.
+    init_count_warnings();
+    init_out("moov-size-faststart");
+    av_dict_set(&opts, "moov_size", "64", 0);
+    av_dict_set(&opts, "movflags", "faststart", 0);
+    init(0, 0);
+    mux_gops(2);
+    finish();
+    close_out();
+    reset_count_warnings();
+    check(num_warnings > 0, "No warnings printed for a too small moov_size");
+    check(is_atom(1, "moov") && is_atom(2, "free") && is_atom(4, "mdat") &&
+          atom_pos(3) == 64 + atom_pos(2) && num_atoms() == 5,
+          "moov not moved to the start with faststart");
+
+    // The moov doesn't fit and there's no faststart; it ends up at the
+    // end of the file and the reserved space stays a free atom.
+    init_count_warnings();
+    init_out("moov-size-overflow");
+    av_dict_set(&opts, "moov_size", "64", 0);
+    init(0, 0);
+    mux_gops(2);
+    finish();
+    close_out();
+    reset_count_warnings();
+    check(num_warnings > 0, "No warnings printed for a too small moov_size");
+    check(is_atom(1, "free") && atom_pos(2) == 64 + atom_pos(1) &&
+          is_atom(3, "mdat") && is_atom(4, "moov") && num_atoms() == 5,
+          "moov not written at the end of the file");
+
+    seekable = 0;
+
+    av_free(seek_buf);
     av_free(md5);
 
     return check_faults > 0 ? 1 : 0;
@@ -26,12 +26,16 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 #include "internal.h"
 #include "network.h"
 #include "os_support.h"
@@ -57,10 +61,28 @@ typedef struct UDPContext {
     char *localaddr;
     char *sources;
     char *block;
+
+    /* batched output */
+    int batch;              ///< maximum number of queued packets
+    int nb_queued;
+    int slot_size;
+    uint8_t *queue;         ///< batch slots of slot_size bytes each
+    int *queue_len;
+#if HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+#endif
+
+    /* output pacing */
+    int64_t bitrate;
+    int64_t pace_start;     ///< time at which pacing started
+    int64_t pace_bits;      ///< bits sent since pace_start
 } UDPContext;
 
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
+#define UDP_MAX_BATCH 1024
+#define UDP_PACE_INTERVAL 1000  ///< longest burst sent when pacing, in microseconds
 
 #define OFFSET(x) offsetof(UDPContext, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
@@ -75,6 +97,8 @@ static const AVOption options[] = {
     { "localaddr",      "Local address",                                   OFFSET(localaddr),      AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch",          "Number of packets to send per system call",       OFFSET(batch),          AV_OPT_TYPE_INT,    { .i64 =  0 },     0, UDP_MAX_BATCH, .flags = E },
+    { "bitrate",        "Pace the output to this bitrate (in bits/s)",     OFFSET(bitrate),        AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
     { NULL }
 };
 
@@ -503,6 +527,12 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch", p)) {
+            s->batch = FFMIN(FFMAX(strtoll(buf, NULL, 10), 0), UDP_MAX_BATCH);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = FFMAX(strtoll(buf, NULL, 10), 0);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "sources", p)) {
             if (parse_source_list(buf, include_sources, &num_include_sources,
                                   FF_ARRAY_ELEMS(include_sources)))
@@ -624,6 +654,20 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
     }
 
+    if (is_output && s->batch > 1) {
+        s->slot_size = h->max_packet_size;
+        s->queue     = av_malloc_array(s->batch, s->slot_size);
+        s->queue_len = av_malloc_array(s->batch, sizeof(*s->queue_len));
+        if (!s->queue || !s->queue_len)
+            goto fail;
+#if HAVE_SENDMMSG
+        s->msgs = av_mallocz_array(s->batch, sizeof(*s->msgs));
+        s->iov  = av_mallocz_array(s->batch, sizeof(*s->iov));
+        if (!s->msgs || !s->iov)
+            goto fail;
+#endif
+    }
+
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -634,6 +678,12 @@ static int udp_open(URLContext *h, const char *uri, int flags)
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
+    av_freep(&s->queue);
+    av_freep(&s->queue_len);
+#if HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+#endif
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -655,7 +705,30 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
-static int udp_write(URLContext *h, const uint8_t *buf, int size)
+/**
+ * Wait until size more bytes may be sent without exceeding the configured
+ * bitrate. If the output has fallen more than a second behind, the pacing
+ * is restarted instead of catching up with a burst.
+ */
+static void udp_pace(UDPContext *s, int64_t size)
+{
+    int64_t now, due;
+
+    if (!s->bitrate)
+        return;
+
+    now = av_gettime_relative();
+    due = s->pace_start + av_rescale(s->pace_bits, 1000000, s->bitrate);
+    if (!s->pace_start || now - due > 1000000) {
+        s->pace_start = now;
+        s->pace_bits  = 0;
+    } else if (due > now) {
+        av_usleep(due - now);
+    }
+    s->pace_bits += 8LL * size;
+}
+
+static int udp_send(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
@@ -676,13 +749,128 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+/**
+ * Send the queued packets from start to end, with as few system calls as
+ * possible.
+ */
+static int udp_send_queued(URLContext *h, int start, int end)
+{
+    UDPContext *s = h->priv_data;
+    int ret = 0;
+
+#if HAVE_SENDMMSG
+    while (start < end) {
+        if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+            ret = ff_network_wait_fd(s->udp_fd, 1);
+            if (ret < 0)
+                break;
+        }
+        ret = sendmmsg(s->udp_fd, s->msgs + start, end - start, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EINTR) ||
+                (ret == AVERROR(EAGAIN) && !(h->flags & AVIO_FLAG_NONBLOCK)))
+                continue;
+            break;
+        }
+        start += ret;
+    }
+#else
+    for (; start < end; start++) {
+        ret = udp_send(h, s->queue + start * s->slot_size, s->queue_len[start]);
+        if (ret < 0)
+            break;
+    }
+#endif
+    return ret < 0 ? ret : 0;
+}
+
+/**
+ * Send all queued packets. When pacing, the batch is split into chunks of
+ * at most UDP_PACE_INTERVAL worth of data, each sent when it is due, so
+ * that a large batch does not leave as a single burst.
+ */
+int ff_udp_flush(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int64_t chunk_size = INT64_MAX;
+    int i, start = 0, ret = 0;
+
+    if (!s->nb_queued)
+        return 0;
+
+#if HAVE_SENDMMSG
+    for (i = 0; i < s->nb_queued; i++) {
+        struct msghdr *msg = &s->msgs[i].msg_hdr;
+
+        s->iov[i].iov_base = s->queue + i * s->slot_size;
+        s->iov[i].iov_len  = s->queue_len[i];
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov    = &s->iov[i];
+        msg->msg_iovlen = 1;
+        if (!s->is_connected) {
+            msg->msg_name    = &s->dest_addr;
+            msg->msg_namelen = s->dest_addr_len;
+        }
+    }
+#endif
+
+    if (s->bitrate)
+        chunk_size = av_rescale(s->bitrate, UDP_PACE_INTERVAL, 8 * 1000000);
+
+    while (start < s->nb_queued) {
+        int64_t size = s->queue_len[start];
+
+        /* a chunk holds at least one packet */
+        for (i = start + 1; i < s->nb_queued; i++) {
+            if (size + s->queue_len[i] > chunk_size)
+                break;
+            size += s->queue_len[i];
+        }
+        udp_pace(s, size);
+        if ((ret = udp_send_queued(h, start, i)) < 0)
+            break;
+        start = i;
+    }
+
+    /* packets that could not be sent are dropped */
+    s->nb_queued = 0;
+    return ret;
+}
+
+static int udp_write(URLContext *h, const uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int ret;
+
+    if (!s->queue || size > s->slot_size) {
+        if ((ret = ff_udp_flush(h)) < 0)
+            return ret;
+        udp_pace(s, size);
+        return udp_send(h, buf, size);
+    }
+
+    memcpy(s->queue + s->nb_queued * s->slot_size, buf, size);
+    s->queue_len[s->nb_queued++] = size;
+    if (s->nb_queued == s->batch && (ret = ff_udp_flush(h)) < 0)
+        return ret;
+    return size;
+}
+
 static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+    ff_udp_flush(h);
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr);
     closesocket(s->udp_fd);
+    av_freep(&s->queue);
+    av_freep(&s->queue_len);
+#if HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+#endif
     return 0;
 }
 
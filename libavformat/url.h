@@ -27,6 +27,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -89,6 +90,16 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Return a reference to size bytes of the resource starting at pos,
+     * without copying them, for protocols that can map their data. The data
+     * must be followed by AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes, as in
+     * any packet. Returns AVERROR(ENOSYS) if the range
+     * cannot be referenced, the caller then reads it as usual. The read
+     * position is not changed.
+     */
+    int (*url_get_buffer)(URLContext *h, int64_t pos, int size,
+                          AVBufferRef **buf);
 } URLProtocol;
 
 /**
@@ -242,6 +253,10 @@ int ff_check_interrupt(AVIOInterruptCB *cb);
 /* udp.c */
 int ff_udp_set_remote_url(URLContext *h, const char *uri);
 int ff_udp_get_local_port(URLContext *h);
+/**
+ * Send the packets queued on a udp URLContext opened with the batch option.
+ */
+int ff_udp_flush(URLContext *h);
 
 /**
  * Assemble a URL string from components. This is the reverse operation
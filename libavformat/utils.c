@@ -41,6 +41,7 @@
 
 #include "audiointerleave.h"
 #include "avformat.h"
+#include "avio_internal.h"
 #include "id3v2.h"
 #include "internal.h"
 #include "metadata.h"
@@ -121,6 +122,15 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     pkt->size = 0;
     pkt->pos  = avio_tell(s);
 
+    /* Reference packets larger than the IO buffer instead of copying them,
+     * if the protocol allows it. */
+    if (size > s->buffer_size &&
+        ffio_read_buffer(s, size, &pkt->buf) == size) {
+        pkt->data = pkt->buf->data;
+        pkt->size = size;
+        return size;
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -332,3 +332,283 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 
     return ret;
 }
+
+typedef struct BufferPoolSetBucket {
+    struct BufferPoolSet *set;
+    AVBufferPool *pool;
+    int size;
+    /* number of buffers handed out from this bucket and not released yet */
+    int in_use;
+} BufferPoolSetBucket;
+
+typedef struct BufferPoolSet {
+    AVMutex mutex;
+
+    /*
+     * One reference is held by the AVBufferRef given to the caller and one
+     * by each bucket pool that has not been freed yet, since the buckets are
+     * accessed when the buffers of the pools are released.
+     */
+    atomic_uint refcount;
+
+    BufferPoolSetBucket **buckets;
+    int                nb_buckets;
+
+    int64_t max_size;
+    int64_t allocated;
+    int64_t peak;
+} BufferPoolSet;
+
+static void pool_set_unref(BufferPoolSet *set)
+{
+    int i;
+
+    if (atomic_fetch_add_explicit(&set->refcount, -1, memory_order_acq_rel) != 1)
+        return;
+
+    for (i = 0; i < set->nb_buckets; i++)
+        av_freep(&set->buckets[i]);
+    av_freep(&set->buckets);
+    ff_mutex_destroy(&set->mutex);
+    av_free(set);
+}
+
+static void pool_set_free(void *opaque, uint8_t *data)
+{
+    BufferPoolSet *set = (BufferPoolSet *)data;
+    int i;
+
+    for (i = 0; i < set->nb_buckets; i++)
+        av_buffer_pool_uninit(&set->buckets[i]->pool);
+
+    pool_set_unref(set);
+}
+
+AVBufferRef *av_buffer_pool_set_alloc(int64_t max_size)
+{
+    BufferPoolSet *set;
+    AVBufferRef *ret;
+
+    if (max_size < 0)
+        return NULL;
+
+    set = av_mallocz(sizeof(*set));
+    if (!set)
+        return NULL;
+
+    ff_mutex_init(&set->mutex, NULL);
+    atomic_init(&set->refcount, 1);
+    set->max_size = max_size;
+
+    ret = av_buffer_create((uint8_t *)set, sizeof(*set), pool_set_free, NULL, 0);
+    if (!ret) {
+        ff_mutex_destroy(&set->mutex);
+        av_free(set);
+    }
+
+    return ret;
+}
+
+static void pool_set_free_buffer(void *opaque, uint8_t *data)
+{
+    BufferPoolSetBucket *bucket = opaque;
+    BufferPoolSet *set = bucket->set;
+
+    av_free(data);
+
+    ff_mutex_lock(&set->mutex);
+    set->allocated -= bucket->size;
+    ff_mutex_unlock(&set->mutex);
+}
+
+static AVBufferRef *pool_set_alloc_buffer(void *opaque, int size)
+{
+    BufferPoolSetBucket *bucket = opaque;
+    BufferPoolSet *set = bucket->set;
+    AVBufferRef *ret = NULL;
+    uint8_t *data;
+
+    ff_mutex_lock(&set->mutex);
+    if (set->max_size && set->allocated + size > set->max_size) {
+        ff_mutex_unlock(&set->mutex);
+        return NULL;
+    }
+    set->allocated += size;
+    set->peak       = FFMAX(set->peak, set->allocated);
+    ff_mutex_unlock(&set->mutex);
+
+    data = av_malloc(size);
+    if (data)
+        ret = av_buffer_create(data, size, pool_set_free_buffer, bucket, 0);
+    if (!ret) {
+        av_free(data);
+        ff_mutex_lock(&set->mutex);
+        set->allocated -= size;
+        ff_mutex_unlock(&set->mutex);
+    }
+
+    return ret;
+}
+
+static void pool_set_pool_free(void *opaque)
+{
+    BufferPoolSetBucket *bucket = opaque;
+
+    pool_set_unref(bucket->set);
+}
+
+static void pool_set_release_buffer(void *opaque, uint8_t *data)
+{
+    BufferPoolEntry      *buf = opaque;
+    BufferPoolSetBucket *bucket = buf->pool->opaque;
+    BufferPoolSet       *set    = bucket->set;
+
+    ff_mutex_lock(&set->mutex);
+    bucket->in_use--;
+    ff_mutex_unlock(&set->mutex);
+
+    /* the pool, and thus the set, is kept alive by this buffer until here */
+    pool_release_buffer(opaque, data);
+}
+
+/*
+ * Round the size up to a multiple of 1/8 of its highest power of two, so
+ * that close sizes end up in the same bucket while wasting at most 12.5%.
+ */
+static int pool_set_bucket_size(int size)
+{
+    int64_t align = FFMAX(4096, 1 << FFMAX(av_log2(size) - 3, 0));
+    int64_t ret   = FFALIGN((int64_t)FFMAX(size, 1), align);
+
+    return ret > INT_MAX ? size : ret;
+}
+
+static BufferPoolSetBucket *pool_set_get_bucket(BufferPoolSet *set, int size)
+{
+    BufferPoolSetBucket *bucket, **buckets;
+    int i;
+
+    for (i = 0; i < set->nb_buckets; i++)
+        if (set->buckets[i]->size == size)
+            return set->buckets[i];
+
+    buckets = av_realloc_array(set->buckets, set->nb_buckets + 1,
+                               sizeof(*set->buckets));
+    if (!buckets)
+        return NULL;
+    set->buckets = buckets;
+
+    bucket = av_mallocz(sizeof(*bucket));
+    if (!bucket)
+        return NULL;
+    bucket->set  = set;
+    bucket->size = size;
+
+    set->buckets[set->nb_buckets++] = bucket;
+
+    return bucket;
+}
+
+/*
+ * Free the pools of all the buckets other than keep that have no buffers in
+ * use, releasing all the memory they hold. Returns nonzero if any pool was
+ * freed.
+ */
+static int pool_set_trim(BufferPoolSet *set, BufferPoolSetBucket *keep)
+{
+    int i, trimmed = 0;
+
+    while (1) {
+        AVBufferPool *pool = NULL;
+
+        ff_mutex_lock(&set->mutex);
+        for (i = 0; i < set->nb_buckets; i++) {
+            BufferPoolSetBucket *bucket = set->buckets[i];
+            if (bucket != keep && bucket->pool && !bucket->in_use) {
+                pool         = bucket->pool;
+                bucket->pool = NULL;
+                break;
+            }
+        }
+        ff_mutex_unlock(&set->mutex);
+
+        if (!pool)
+            break;
+
+        /* must be done without holding the set mutex, the buffers are freed
+         * immediately since none of them is in use */
+        av_buffer_pool_uninit(&pool);
+        trimmed = 1;
+    }
+
+    return trimmed;
+}
+
+AVBufferRef *av_buffer_pool_set_get(AVBufferRef *ref, int size)
+{
+    BufferPoolSet *set = (BufferPoolSet *)ref->data;
+    BufferPoolSetBucket *bucket;
+    AVBufferPool *pool;
+    AVBufferRef *ret;
+
+    if (size < 0)
+        return NULL;
+
+    ff_mutex_lock(&set->mutex);
+    bucket = pool_set_get_bucket(set, pool_set_bucket_size(size));
+    if (!bucket)
+        goto fail;
+
+    if (!bucket->pool) {
+        bucket->pool = av_buffer_pool_init2(bucket->size, bucket,
+                                            pool_set_alloc_buffer,
+                                            pool_set_pool_free);
+        if (!bucket->pool)
+            goto fail;
+        atomic_fetch_add_explicit(&set->refcount, 1, memory_order_relaxed);
+    }
+
+    /* the pool cannot be trimmed while it has buffers in use, so
+     * reserve one before leaving the lock */
+    bucket->in_use++;
+    pool = bucket->pool;
+    ff_mutex_unlock(&set->mutex);
+
+    ret = av_buffer_pool_get(pool);
+    if (!ret && set->max_size && pool_set_trim(set, bucket))
+        ret = av_buffer_pool_get(pool);
+
+    if (!ret) {
+        ff_mutex_lock(&set->mutex);
+        bucket->in_use--;
+        ff_mutex_unlock(&set->mutex);
+        return NULL;
+    }
+
+    ret->buffer->free = pool_set_release_buffer;
+
+    return ret;
+fail:
+    ff_mutex_unlock(&set->mutex);
+    return NULL;
+}
+
+void av_buffer_pool_set_get_usage(AVBufferRef *ref, int64_t *allocated,
+                                  int64_t *in_use, int64_t *peak)
+{
+    BufferPoolSet *set = (BufferPoolSet *)ref->data;
+    int64_t used = 0;
+    int i;
+
+    ff_mutex_lock(&set->mutex);
+    for (i = 0; i < set->nb_buckets; i++)
+        used += (int64_t)set->buckets[i]->in_use * set->buckets[i]->size;
+
+    if (allocated)
+        *allocated = set->allocated;
+    if (in_use)
+        *in_use = used;
+    if (peak)
+        *peak = set->peak;
+    ff_mutex_unlock(&set->mutex);
+}
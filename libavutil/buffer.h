@@ -277,6 +277,66 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup lavu_bufferpoolset AVBufferPoolSet
+ * @ingroup lavu_data
+ *
+ * @{
+ * A buffer pool set is a collection of buffer pools that can be shared
+ * between several independent users, e.g. multiple decoders and filtergraphs
+ * running in the same process.
+ *
+ * Buffers of any size can be requested from the set. Requests are rounded up
+ * to a size class and served from an AVBufferPool dedicated to that class, so
+ * that users with similar but not identical buffer sizes share memory.
+ * Optionally, the total amount of memory allocated by the set can be limited.
+ * When the limit would be exceeded, the memory held by size classes that have
+ * no buffers in use is released first; if that is not enough, the allocation
+ * fails.
+ *
+ * The set is reference counted through an AVBufferRef. It stays alive until
+ * all the references to it and all the buffers allocated from it are
+ * released. All the functions are thread-safe.
+ */
+
+/**
+ * Allocate a new buffer pool set.
+ *
+ * @param max_size maximum total size in bytes of the buffers allocated by the
+ *                 set, including the ones currently unused and kept for
+ *                 reuse. 0 means no limit.
+ * @return a reference to the new set on success, NULL on error.
+ */
+AVBufferRef *av_buffer_pool_set_alloc(int64_t max_size);
+
+/**
+ * Get a buffer of at least the given size from a buffer pool set, reusing a
+ * previously released buffer of the same size class when available.
+ *
+ * @param set a reference to a set allocated with av_buffer_pool_set_alloc()
+ * @param size the minimum size of the buffer
+ * @return a reference to the new buffer on success, NULL on error or when the
+ *         size limit of the set has been reached.
+ */
+AVBufferRef *av_buffer_pool_set_get(AVBufferRef *set, int size);
+
+/**
+ * Report the memory usage of a buffer pool set. Any of the output pointers
+ * may be NULL.
+ *
+ * @param set a reference to a set allocated with av_buffer_pool_set_alloc()
+ * @param allocated will be set to the total size of the buffers currently
+ *                  allocated by the set, whether in use or not
+ * @param in_use will be set to the total size of the buffers currently in use
+ * @param peak will be set to the highest value allocated has ever had
+ */
+void av_buffer_pool_set_get_usage(AVBufferRef *set, int64_t *allocated,
+                                  int64_t *in_use, int64_t *peak);
+
 /**
  * @}
  */
@@ -87,7 +87,14 @@ void av_frame_free(AVFrame **frame)
     av_freep(frame);
 }
 
-static int get_video_buffer(AVFrame *frame, int align)
+static AVBufferRef *alloc_buffer(AVBufferRef *pool_set, int size)
+{
+    if (pool_set)
+        return av_buffer_pool_set_get(pool_set, size);
+    return av_buffer_alloc(size);
+}
+
+static int get_video_buffer(AVFrame *frame, int align, AVBufferRef *pool_set)
 {
     int ret, i;
 
@@ -111,7 +118,7 @@ static int get_video_buffer(AVFrame *frame, int align)
                                       NULL, frame->linesize)) < 0)
         return ret;
 
-    frame->buf[0] = av_buffer_alloc(ret);
+    frame->buf[0] = alloc_buffer(pool_set, ret);
     if (!frame->buf[0])
         goto fail;
 
@@ -127,7 +134,7 @@ fail:
     return AVERROR(ENOMEM);
 }
 
-static int get_audio_buffer(AVFrame *frame, int align)
+static int get_audio_buffer(AVFrame *frame, int align, AVBufferRef *pool_set)
 {
     int channels = av_get_channel_layout_nb_channels(frame->channel_layout);
     int planar   = av_sample_fmt_is_planar(frame->format);
@@ -157,7 +164,7 @@ static int get_audio_buffer(AVFrame *frame, int align)
         frame->extended_data = frame->data;
 
     for (i = 0; i < FFMIN(planes, AV_NUM_DATA_POINTERS); i++) {
-        frame->buf[i] = av_buffer_alloc(frame->linesize[0]);
+        frame->buf[i] = alloc_buffer(pool_set, frame->linesize[0]);
         if (!frame->buf[i]) {
             av_frame_unref(frame);
             return AVERROR(ENOMEM);
@@ -165,7 +172,7 @@ static int get_audio_buffer(AVFrame *frame, int align)
         frame->extended_data[i] = frame->data[i] = frame->buf[i]->data;
     }
     for (i = 0; i < planes - AV_NUM_DATA_POINTERS; i++) {
-        frame->extended_buf[i] = av_buffer_alloc(frame->linesize[0]);
+        frame->extended_buf[i] = alloc_buffer(pool_set, frame->linesize[0]);
         if (!frame->extended_buf[i]) {
             av_frame_unref(frame);
             return AVERROR(ENOMEM);
@@ -176,19 +183,24 @@ static int get_audio_buffer(AVFrame *frame, int align)
 
 }
 
-int av_frame_get_buffer(AVFrame *frame, int align)
+int av_frame_get_pooled_buffer(AVFrame *frame, int align, AVBufferRef *pool_set)
 {
     if (frame->format < 0)
         return AVERROR(EINVAL);
 
     if (frame->width > 0 && frame->height > 0)
-        return get_video_buffer(frame, align);
+        return get_video_buffer(frame, align, pool_set);
     else if (frame->nb_samples > 0 && frame->channel_layout)
-        return get_audio_buffer(frame, align);
+        return get_audio_buffer(frame, align, pool_set);
 
     return AVERROR(EINVAL);
 }
 
+int av_frame_get_buffer(AVFrame *frame, int align)
+{
+    return av_frame_get_pooled_buffer(frame, align, NULL);
+}
+
 int av_frame_ref(AVFrame *dst, const AVFrame *src)
 {
     int i, ret = 0;
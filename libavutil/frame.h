@@ -493,6 +493,16 @@ void av_frame_move_ref(AVFrame *dst, AVFrame *src);
  */
 int av_frame_get_buffer(AVFrame *frame, int align);
 
+/**
+ * Same as av_frame_get_buffer(), but allocate the buffers from a buffer pool
+ * set instead of the heap.
+ *
+ * @param pool_set a reference to a set allocated with
+ *                 av_buffer_pool_set_alloc(). May be NULL, then this function
+ *                 is equivalent to av_frame_get_buffer().
+ */
+int av_frame_get_pooled_buffer(AVFrame *frame, int align, AVBufferRef *pool_set);
+
 /**
  * Check if the frame data is writable.
  *
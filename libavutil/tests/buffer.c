@@ -0,0 +1,97 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+
+static void print_usage(AVBufferRef *set)
+{
+    int64_t allocated, in_use, peak;
+
+    av_buffer_pool_set_get_usage(set, &allocated, &in_use, &peak);
+    printf("allocated %"PRId64" in use %"PRId64" peak %"PRId64"\n",
+           allocated, in_use, peak);
+}
+
+int main(void)
+{
+    static const int sizes[] = { 0, 1, 4096, 4097, 12345, 100000, 1000000 };
+    AVBufferRef *set, *buf[4];
+    uint8_t *data;
+    int i;
+
+    /* size classes */
+    set = av_buffer_pool_set_alloc(0);
+    if (!set)
+        return 1;
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        buf[0] = av_buffer_pool_set_get(set, sizes[i]);
+        if (!buf[0])
+            return 1;
+        printf("size %d: buffer size %d\n", sizes[i], buf[0]->size);
+        av_buffer_unref(&buf[0]);
+    }
+    print_usage(set);
+
+    /* reuse of the released buffers of a size class */
+    buf[0] = av_buffer_pool_set_get(set, 5000);
+    buf[1] = av_buffer_pool_set_get(set, 6000);
+    if (!buf[0] || !buf[1])
+        return 1;
+    printf("same class in use: %s\n",
+           buf[0]->data == buf[1]->data ? "shared" : "distinct");
+    print_usage(set);
+    data = buf[1]->data;
+    av_buffer_unref(&buf[1]);
+    buf[1] = av_buffer_pool_set_get(set, 7000);
+    if (!buf[1])
+        return 1;
+    printf("same class released: %s\n",
+           buf[1]->data == data ? "reused" : "not reused");
+    print_usage(set);
+    av_buffer_unref(&buf[0]);
+    av_buffer_unref(&buf[1]);
+    av_buffer_unref(&set);
+
+    /* size limit, with the unused size classes released when reached */
+    set = av_buffer_pool_set_alloc(3 * 8192);
+    if (!set)
+        return 1;
+    buf[0] = av_buffer_pool_set_get(set, 8192);
+    buf[1] = av_buffer_pool_set_get(set, 8192);
+    buf[2] = av_buffer_pool_set_get(set, 4096);
+    if (!buf[0] || !buf[1] || !buf[2])
+        return 1;
+    print_usage(set);
+    buf[3] = av_buffer_pool_set_get(set, 8192);
+    printf("over the limit: %s\n", buf[3] ? "allocated" : "refused");
+    av_buffer_unref(&buf[3]);
+    av_buffer_unref(&buf[2]);
+    print_usage(set);
+    buf[2] = av_buffer_pool_set_get(set, 8192);
+    printf("after release: %s\n", buf[2] ? "allocated" : "refused");
+    print_usage(set);
+    for (i = 0; i < 3; i++)
+        av_buffer_unref(&buf[i]);
+    av_buffer_unref(&set);
+
+    return 0;
+}
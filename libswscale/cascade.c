@@ -0,0 +1,281 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scaling of one source to several outputs
+ */
+
+#include <stdlib.h>
+
+#include "config.h"
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "swscale.h"
+#include "swscale_internal.h"
+
+typedef struct SwsCascadeOutput {
+    struct SwsContext *sws;
+    int index;                  ///< index of the output in the caller's arrays
+    int parent;                 ///< entry in outputs scaled from, -1 for the source
+    int w, h;
+    enum AVPixelFormat format;
+} SwsCascadeOutput;
+
+struct SwsCascade {
+    int src_h;
+
+    /* the source converted once to a planar format for all outputs
+     * reading it, if it needs an input conversion */
+    struct SwsContext *convert;
+    uint8_t *tmp[4];
+    int tmp_stride[4];
+
+    SwsCascadeOutput *outputs;  ///< sorted by decreasing size
+    int nb_outputs;
+};
+
+/* planar YUV formats a source is converted to, by increasing depth */
+static const enum AVPixelFormat planar_formats[] = {
+    AV_PIX_FMT_YUV420P,   AV_PIX_FMT_YUV422P,   AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_YUV420P10, AV_PIX_FMT_YUV422P10, AV_PIX_FMT_YUV444P10,
+    AV_PIX_FMT_YUV420P16, AV_PIX_FMT_YUV422P16, AV_PIX_FMT_YUV444P16,
+};
+
+static int is_native_planar_yuv(enum AVPixelFormat fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+
+    return isPlanarYUV(fmt) && desc->comp[1].plane != desc->comp[2].plane &&
+           !isBE(fmt) == !HAVE_BIGENDIAN;
+}
+
+/**
+ * Return the planar YUV format the source should be converted to before
+ * being scaled to several outputs, AV_PIX_FMT_NONE if it is read as is.
+ */
+static enum AVPixelFormat shared_format(enum AVPixelFormat src,
+                                        const SwsCascadeOutput *outputs,
+                                        int nb_outputs)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src);
+    int depth  = desc->comp[0].depth;
+    int log2_w = desc->log2_chroma_w;
+    int log2_h = desc->log2_chroma_h;
+    int i, nb_readers = 0;
+
+    for (i = 0; i < nb_outputs; i++) {
+        if (outputs[i].parent >= 0)
+            continue;
+        /* converting to YUV and back would not be lossless */
+        if (isRGB(src) && isRGB(outputs[i].format))
+            return AV_PIX_FMT_NONE;
+        nb_readers++;
+    }
+
+    if (nb_readers < 2 || is_native_planar_yuv(src) ||
+        usePal(src) || isALPHA(src) || isGray(src) ||
+        desc->flags & AV_PIX_FMT_FLAG_HWACCEL)
+        return AV_PIX_FMT_NONE;
+
+    if (isRGB(src)) {
+        /* keep some precision over the outputs for the matrix */
+        log2_w = log2_h = 0;
+        depth += 2;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(planar_formats); i++) {
+        desc = av_pix_fmt_desc_get(planar_formats[i]);
+        if (desc->log2_chroma_w == log2_w && desc->log2_chroma_h == log2_h &&
+            desc->comp[0].depth >= depth)
+            return planar_formats[i];
+    }
+    return AV_PIX_FMT_NONE;
+}
+
+/**
+ * Check whether an output can be scaled from a larger one instead of the
+ * source without losing more than the rounding of the intermediate.
+ */
+static int can_scale_from(const SwsCascadeOutput *out,
+                          const SwsCascadeOutput *parent,
+                          int src_w, int src_h)
+{
+    const AVPixFmtDescriptor *desc  = av_pix_fmt_desc_get(out->format);
+    const AVPixFmtDescriptor *pdesc = av_pix_fmt_desc_get(parent->format);
+
+    /* an upscaled parent adds no information, a smaller one loses it */
+    if (parent->w > src_w || parent->h > src_h ||
+        parent->w < out->w || parent->h < out->h)
+        return 0;
+
+    if (!isPlanarYUV(parent->format) || (isALPHA(out->format) && !isALPHA(parent->format)))
+        return 0;
+
+    if (pdesc->comp[0].depth < desc->comp[0].depth)
+        return 0;
+
+    if (isGray(out->format))
+        return 1;
+    if (isRGB(out->format))
+        return !pdesc->log2_chroma_w && !pdesc->log2_chroma_h;
+
+    return pdesc->log2_chroma_w <= desc->log2_chroma_w &&
+           pdesc->log2_chroma_h <= desc->log2_chroma_h;
+}
+
+static int cmp_size(const void *a, const void *b)
+{
+    const SwsCascadeOutput *oa = a, *ob = b;
+    int64_t sa = (int64_t)oa->w * oa->h;
+    int64_t sb = (int64_t)ob->w * ob->h;
+
+    if (sa != sb)
+        return sa < sb ? 1 : -1;
+    return oa->index - ob->index;
+}
+
+struct SwsCascade *sws_cascade_alloc(int srcW, int srcH, enum AVPixelFormat srcFormat,
+                                     int nb_outputs, const int *dstW, const int *dstH,
+                                     const enum AVPixelFormat *dstFormat,
+                                     int flags, const double *param)
+{
+    struct SwsCascade *c;
+    enum AVPixelFormat fmt;
+    int i, j;
+
+    if (nb_outputs <= 0)
+        return NULL;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return NULL;
+    c->src_h = srcH;
+
+    c->outputs = av_mallocz_array(nb_outputs, sizeof(*c->outputs));
+    if (!c->outputs)
+        goto fail;
+    c->nb_outputs = nb_outputs;
+
+    for (i = 0; i < nb_outputs; i++) {
+        c->outputs[i].index  = i;
+        c->outputs[i].w      = dstW[i];
+        c->outputs[i].h      = dstH[i];
+        c->outputs[i].format = dstFormat[i];
+    }
+    qsort(c->outputs, nb_outputs, sizeof(*c->outputs), cmp_size);
+
+    /* scale each output from the smallest larger one it can use */
+    for (i = 0; i < nb_outputs; i++) {
+        SwsCascadeOutput *out = &c->outputs[i];
+
+        out->parent = -1;
+        for (j = i - 1; j >= 0; j--) {
+            if (can_scale_from(out, &c->outputs[j], srcW, srcH)) {
+                out->parent = j;
+                break;
+            }
+        }
+    }
+
+    fmt = shared_format(srcFormat, c->outputs, nb_outputs);
+    if (fmt != AV_PIX_FMT_NONE) {
+        c->convert = sws_getContext(srcW, srcH, srcFormat, srcW, srcH, fmt,
+                                    flags, NULL, NULL, param);
+        if (!c->convert ||
+            av_image_alloc(c->tmp, c->tmp_stride, srcW, srcH, fmt, 16) < 0)
+            goto fail;
+        srcFormat = fmt;
+    }
+
+    for (i = 0; i < nb_outputs; i++) {
+        SwsCascadeOutput *out = &c->outputs[i];
+        const SwsCascadeOutput *in = out->parent >= 0 ? &c->outputs[out->parent] : NULL;
+
+        out->sws = sws_getContext(in ? in->w      : srcW,
+                                  in ? in->h      : srcH,
+                                  in ? in->format : srcFormat,
+                                  out->w, out->h, out->format,
+                                  flags, NULL, NULL, param);
+        if (!out->sws)
+            goto fail;
+    }
+
+    return c;
+
+fail:
+    sws_cascade_free(&c);
+    return NULL;
+}
+
+int sws_cascade_scale(struct SwsCascade *c, const uint8_t *const src[],
+                      const int srcStride[], uint8_t *const *const dst[],
+                      const int *const dstStride[])
+{
+    int i;
+
+    if (c->convert) {
+        if (sws_scale(c->convert, src, srcStride, 0, c->src_h,
+                      c->tmp, c->tmp_stride) <= 0)
+            return AVERROR(EINVAL);
+        src       = (const uint8_t * const *)c->tmp;
+        srcStride = c->tmp_stride;
+    }
+
+    for (i = 0; i < c->nb_outputs; i++) {
+        const SwsCascadeOutput *out = &c->outputs[i];
+        const uint8_t *const *in    = src;
+        const int *in_stride        = srcStride;
+        int in_h                    = c->src_h;
+
+        if (out->parent >= 0) {
+            const SwsCascadeOutput *parent = &c->outputs[out->parent];
+
+            in        = (const uint8_t * const *)dst[parent->index];
+            in_stride = dstStride[parent->index];
+            in_h      = parent->h;
+        }
+
+        if (sws_scale(out->sws, in, in_stride, 0, in_h,
+                      dst[out->index], dstStride[out->index]) <= 0)
+            return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+void sws_cascade_free(struct SwsCascade **pc)
+{
+    struct SwsCascade *c = *pc;
+    int i;
+
+    if (!c)
+        return;
+
+    for (i = 0; i < c->nb_outputs; i++)
+        sws_freeContext(c->outputs[i].sws);
+    av_freep(&c->outputs);
+    sws_freeContext(c->convert);
+    av_freep(&c->tmp[0]);
+    av_freep(pc);
+}
@@ -35,17 +35,6 @@
 #include "swscale.h"
 #include "swscale_internal.h"
 
-#define RGB2YUV_SHIFT 15
-#define BY  ((int)(0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BV (-(int)(0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BU  ((int)(0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GY  ((int)(0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GV (-(int)(0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GU (-(int)(0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RY  ((int)(0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RV  ((int)(0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RU (-(int)(0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-
 #define input_pixel(pos) (isBE(origin) ? AV_RB16(pos) : AV_RL16(pos))
 
 #define r ((origin == AV_PIX_FMT_BGR48BE || origin == AV_PIX_FMT_BGR48LE) ? b_r : r_b)
@@ -53,15 +42,17 @@
 
 static av_always_inline void rgb48ToY_c_template(uint16_t *dst,
                                                  const uint16_t *src, int width,
-                                                 enum AVPixelFormat origin)
+                                                 enum AVPixelFormat origin,
+                                                 int32_t *rgb2yuv)
 {
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
     int i;
     for (i = 0; i < width; i++) {
         unsigned int r_b = input_pixel(&src[i * 3 + 0]);
         unsigned int g   = input_pixel(&src[i * 3 + 1]);
         unsigned int b_r = input_pixel(&src[i * 3 + 2]);
 
-        dst[i] = (RY * r + GY * g + BY * b + (0x2001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dst[i] = (ry * r + gy * g + by * b + (0x2001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
 }
 
@@ -70,8 +61,11 @@ static av_always_inline void rgb48ToUV_c_template(uint16_t *dstU,
                                                   const uint16_t *src1,
                                                   const uint16_t *src2,
                                                   int width,
-                                                  enum AVPixelFormat origin)
+                                                  enum AVPixelFormat origin,
+                                                  int32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     assert(src1 == src2);
     for (i = 0; i < width; i++) {
@@ -79,8 +73,8 @@ static av_always_inline void rgb48ToUV_c_template(uint16_t *dstU,
         int g   = input_pixel(&src1[i * 3 + 1]);
         int b_r = input_pixel(&src1[i * 3 + 2]);
 
-        dstU[i] = (RU * r + GU * g + BU * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
 }
 
@@ -89,8 +83,11 @@ static av_always_inline void rgb48ToUV_half_c_template(uint16_t *dstU,
                                                        const uint16_t *src1,
                                                        const uint16_t *src2,
                                                        int width,
-                                                       enum AVPixelFormat origin)
+                                                       enum AVPixelFormat origin,
+                                                       int32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     assert(src1 == src2);
     for (i = 0; i < width; i++) {
@@ -101,8 +98,8 @@ static av_always_inline void rgb48ToUV_half_c_template(uint16_t *dstU,
         int b_r = (input_pixel(&src1[6 * i + 2]) +
                    input_pixel(&src1[6 * i + 5]) + 1) >> 1;
 
-        dstU[i] = (RU * r + GU * g + BU * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (0x10001 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
 }
 
@@ -114,11 +111,11 @@ static av_always_inline void rgb48ToUV_half_c_template(uint16_t *dstU,
 static void pattern ## 48 ## BE_LE ## ToY_c(uint8_t *_dst,              \
                                             const uint8_t *_src,        \
                                             int width,                  \
-                                            uint32_t *unused)           \
+                                            uint32_t *rgb2yuv)          \
 {                                                                       \
     const uint16_t *src = (const uint16_t *)_src;                       \
     uint16_t *dst       = (uint16_t *)_dst;                             \
-    rgb48ToY_c_template(dst, src, width, origin);                       \
+    rgb48ToY_c_template(dst, src, width, origin, (int32_t *)rgb2yuv);   \
 }                                                                       \
                                                                         \
 static void pattern ## 48 ## BE_LE ## ToUV_c(uint8_t *_dstU,            \
@@ -126,13 +123,14 @@ static void pattern ## 48 ## BE_LE ## ToUV_c(uint8_t *_dstU,            \
                                              const uint8_t *_src1,      \
                                              const uint8_t *_src2,      \
                                              int width,                 \
-                                             uint32_t *unused)          \
+                                             uint32_t *rgb2yuv)         \
 {                                                                       \
     const uint16_t *src1 = (const uint16_t *)_src1,                     \
                    *src2 = (const uint16_t *)_src2;                     \
     uint16_t *dstU = (uint16_t *)_dstU,                                 \
              *dstV = (uint16_t *)_dstV;                                 \
-    rgb48ToUV_c_template(dstU, dstV, src1, src2, width, origin);        \
+    rgb48ToUV_c_template(dstU, dstV, src1, src2, width, origin,         \
+                         (int32_t *)rgb2yuv);                           \
 }                                                                       \
                                                                         \
 static void pattern ## 48 ## BE_LE ## ToUV_half_c(uint8_t *_dstU,       \
@@ -140,13 +138,14 @@ static void pattern ## 48 ## BE_LE ## ToUV_half_c(uint8_t *_dstU,       \
                                                   const uint8_t *_src1, \
                                                   const uint8_t *_src2, \
                                                   int width,            \
-                                                  uint32_t *unused)     \
+                                                  uint32_t *rgb2yuv)    \
 {                                                                       \
     const uint16_t *src1 = (const uint16_t *)_src1,                     \
                    *src2 = (const uint16_t *)_src2;                     \
     uint16_t *dstU = (uint16_t *)_dstU,                                 \
              *dstV = (uint16_t *)_dstV;                                 \
-    rgb48ToUV_half_c_template(dstU, dstV, src1, src2, width, origin);   \
+    rgb48ToUV_half_c_template(dstU, dstV, src1, src2, width, origin,    \
+                              (int32_t *)rgb2yuv);                      \
 }
 
 rgb48funcs(rgb, LE, AV_PIX_FMT_RGB48LE)
@@ -170,9 +169,11 @@ static av_always_inline void rgb16_32ToY_c_template(uint8_t *dst,
                                                     int shb, int shp,
                                                     int maskr, int maskg,
                                                     int maskb, int rsh,
-                                                    int gsh, int bsh, int S)
+                                                    int gsh, int bsh, int S,
+                                                    int32_t *rgb2yuv)
 {
-    const int ry       = RY << rsh, gy = GY << gsh, by = BY << bsh;
+    const int ry       = rgb2yuv[RY_IDX] << rsh, gy = rgb2yuv[GY_IDX] << gsh,
+              by       = rgb2yuv[BY_IDX] << bsh;
     const unsigned rnd = 33u << (S - 1);
     int i;
 
@@ -195,10 +196,12 @@ static av_always_inline void rgb16_32ToUV_c_template(uint8_t *dstU,
                                                      int shb, int shp,
                                                      int maskr, int maskg,
                                                      int maskb, int rsh,
-                                                     int gsh, int bsh, int S)
+                                                     int gsh, int bsh, int S,
+                                                    int32_t *rgb2yuv)
 {
-    const int ru       = RU << rsh, gu = GU << gsh, bu = BU << bsh,
-              rv       = RV << rsh, gv = GV << gsh, bv = BV << bsh;
+    const int ru       = rgb2yuv[RU_IDX] << rsh, gu = rgb2yuv[GU_IDX] << gsh,
+              bu       = rgb2yuv[BU_IDX] << bsh, rv = rgb2yuv[RV_IDX] << rsh,
+              gv       = rgb2yuv[GV_IDX] << gsh, bv = rgb2yuv[BV_IDX] << bsh;
     const unsigned rnd = 257u << (S - 1);
     int i;
 
@@ -222,10 +225,12 @@ static av_always_inline void rgb16_32ToUV_half_c_template(uint8_t *dstU,
                                                           int shb, int shp,
                                                           int maskr, int maskg,
                                                           int maskb, int rsh,
-                                                          int gsh, int bsh, int S)
+                                                          int gsh, int bsh, int S,
+                                                    int32_t *rgb2yuv)
 {
-    const int ru       = RU << rsh, gu = GU << gsh, bu = BU << bsh,
-              rv       = RV << rsh, gv = GV << gsh, bv = BV << bsh,
+    const int ru       = rgb2yuv[RU_IDX] << rsh, gu = rgb2yuv[GU_IDX] << gsh,
+              bu       = rgb2yuv[BU_IDX] << bsh, rv = rgb2yuv[RV_IDX] << rsh,
+              gv       = rgb2yuv[GV_IDX] << gsh, bv = rgb2yuv[BV_IDX] << bsh,
               maskgx   = ~(maskr | maskb);
     const unsigned rnd = 257u << S;
     int i;
@@ -259,30 +264,32 @@ static av_always_inline void rgb16_32ToUV_half_c_template(uint8_t *dstU,
 #define rgb16_32_wrapper(fmt, name, shr, shg, shb, shp, maskr,          \
                          maskg, maskb, rsh, gsh, bsh, S)                \
 static void name ## ToY_c(uint8_t *dst, const uint8_t *src,             \
-                          int width, uint32_t *unused)                  \
+                          int width, uint32_t *tab)                     \
 {                                                                       \
     rgb16_32ToY_c_template(dst, src, width, fmt, shr, shg, shb, shp,    \
-                           maskr, maskg, maskb, rsh, gsh, bsh, S);      \
+                           maskr, maskg, maskb, rsh, gsh, bsh, S,       \
+                           (int32_t *)tab);                             \
 }                                                                       \
                                                                         \
 static void name ## ToUV_c(uint8_t *dstU, uint8_t *dstV,                \
                            const uint8_t *src, const uint8_t *dummy,    \
-                           int width, uint32_t *unused)                 \
+                           int width, uint32_t *tab)                    \
 {                                                                       \
     rgb16_32ToUV_c_template(dstU, dstV, src, width, fmt,                \
                             shr, shg, shb, shp,                         \
-                            maskr, maskg, maskb, rsh, gsh, bsh, S);     \
+                            maskr, maskg, maskb, rsh, gsh, bsh, S,      \
+                            (int32_t *)tab);                            \
 }                                                                       \
                                                                         \
 static void name ## ToUV_half_c(uint8_t *dstU, uint8_t *dstV,           \
                                 const uint8_t *src,                     \
                                 const uint8_t *dummy,                   \
-                                int width, uint32_t *unused)            \
+                                int width, uint32_t *tab)               \
 {                                                                       \
     rgb16_32ToUV_half_c_template(dstU, dstV, src, width, fmt,           \
                                  shr, shg, shb, shp,                    \
                                  maskr, maskg, maskb,                   \
-                                 rsh, gsh, bsh, S);                     \
+                                 rsh, gsh, bsh, S, (int32_t *)tab);     \
 }
 
 rgb16_32_wrapper(AV_PIX_FMT_BGR32,    bgr32,  16, 0,  0, 0, 0xFF0000, 0xFF00,   0x00FF,  8, 0,  8, RGB2YUV_SHIFT + 8)
@@ -537,64 +544,72 @@ static void p010BEToUV_c(uint8_t *dstU, uint8_t *dstV,
 #define input_pixel(pos) (isBE(origin) ? AV_RB16(pos) : AV_RL16(pos))
 
 static void bgr24ToY_c(uint8_t *dst, const uint8_t *src,
-                       int width, uint32_t *unused)
+                       int width, uint32_t *rgb2yuv)
 {
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int b = src[i * 3 + 0];
         int g = src[i * 3 + 1];
         int r = src[i * 3 + 2];
 
-        dst[i] = ((RY * r + GY * g + BY * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        dst[i] = ((ry * r + gy * g + by * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
     }
 }
 
 static void bgr24ToUV_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
-                        const uint8_t *src2, int width, uint32_t *unused)
+                        const uint8_t *src2, int width, uint32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int b = src1[3 * i + 0];
         int g = src1[3 * i + 1];
         int r = src1[3 * i + 2];
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
     assert(src1 == src2);
 }
 
 static void bgr24ToUV_half_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
-                             const uint8_t *src2, int width, uint32_t *unused)
+                             const uint8_t *src2, int width, uint32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int b = src1[6 * i + 0] + src1[6 * i + 3];
         int g = src1[6 * i + 1] + src1[6 * i + 4];
         int r = src1[6 * i + 2] + src1[6 * i + 5];
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
     }
     assert(src1 == src2);
 }
 
 static void rgb24ToY_c(uint8_t *dst, const uint8_t *src, int width,
-                       uint32_t *unused)
+                       uint32_t *rgb2yuv)
 {
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int r = src[i * 3 + 0];
         int g = src[i * 3 + 1];
         int b = src[i * 3 + 2];
 
-        dst[i] = ((RY * r + GY * g + BY * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        dst[i] = ((ry * r + gy * g + by * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
     }
 }
 
 static void rgb24ToUV_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
-                        const uint8_t *src2, int width, uint32_t *unused)
+                        const uint8_t *src2, int width, uint32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     assert(src1 == src2);
     for (i = 0; i < width; i++) {
@@ -602,14 +617,16 @@ static void rgb24ToUV_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
         int g = src1[3 * i + 1];
         int b = src1[3 * i + 2];
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
 }
 
 static void rgb24ToUV_half_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
-                             const uint8_t *src2, int width, uint32_t *unused)
+                             const uint8_t *src2, int width, uint32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     assert(src1 == src2);
     for (i = 0; i < width; i++) {
@@ -617,20 +634,22 @@ static void rgb24ToUV_half_c(uint8_t *dstU, uint8_t *dstV, const uint8_t *src1,
         int g = src1[6 * i + 1] + src1[6 * i + 4];
         int b = src1[6 * i + 2] + src1[6 * i + 5];
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << RGB2YUV_SHIFT)) >> (RGB2YUV_SHIFT + 1);
     }
 }
 
-static void planar_rgb_to_y(uint8_t *dst, const uint8_t *src[4], int width)
+static void planar_rgb_to_y(uint8_t *dst, const uint8_t *src[4], int width,
+                            int32_t *rgb2yuv)
 {
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int g = src[0][i];
         int b = src[1][i];
         int r = src[2][i];
 
-        dst[i] = ((RY * r + GY * g + BY * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        dst[i] = ((ry * r + gy * g + by * b + (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
     }
 }
 
@@ -641,24 +660,30 @@ static void planar_rgb_to_a(uint8_t *dst, const uint8_t *src[4], int width)
         dst[i] = src[3][i];
 }
 
-static void planar_rgb_to_uv(uint8_t *dstU, uint8_t *dstV, const uint8_t *src[4], int width)
+static void planar_rgb_to_uv(uint8_t *dstU, uint8_t *dstV,
+                             const uint8_t *src[4], int width,
+                             int32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     for (i = 0; i < width; i++) {
         int g = src[0][i];
         int b = src[1][i];
         int r = src[2][i];
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
     }
 }
 
 #define rdpx(src) \
     is_be ? AV_RB16(src) : AV_RL16(src)
 static av_always_inline void planar_rgb16_to_y(uint8_t *_dst, const uint8_t *_src[4],
-                                               int width, int bpc, int is_be)
+                                               int width, int bpc, int is_be,
+                                               int32_t *rgb2yuv)
 {
+    int32_t ry = rgb2yuv[RY_IDX], gy = rgb2yuv[GY_IDX], by = rgb2yuv[BY_IDX];
     int i;
     const uint16_t **src = (const uint16_t **)_src;
     uint16_t *dst        = (uint16_t *)_dst;
@@ -667,7 +692,7 @@ static av_always_inline void planar_rgb16_to_y(uint8_t *_dst, const uint8_t *_sr
         int b = rdpx(src[1] + i);
         int r = rdpx(src[2] + i);
 
-        dst[i] = ((RY * r + GY * g + BY * b + (33 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT);
+        dst[i] = ((ry * r + gy * g + by * b + (33 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT);
     }
 }
 
@@ -684,19 +709,22 @@ static av_always_inline void planar_rgb16_to_a(uint8_t *_dst, const uint8_t *_sr
     }
 }
 
-static void planar_rgb9le_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb9le_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                               int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 9, 0);
+    planar_rgb16_to_y(dst, src, w, 9, 0, rgb2yuv);
 }
 
-static void planar_rgb9be_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb9be_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                               int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 9, 1);
+    planar_rgb16_to_y(dst, src, w, 9, 1, rgb2yuv);
 }
 
-static void planar_rgb10le_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb10le_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 10, 0);
+    planar_rgb16_to_y(dst, src, w, 10, 0, rgb2yuv);
 }
 
 static void planar_rgb10le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -704,9 +732,10 @@ static void planar_rgb10le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
     planar_rgb16_to_a(dst, src, w, 10, 0);
 }
 
-static void planar_rgb10be_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb10be_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 10, 1);
+    planar_rgb16_to_y(dst, src, w, 10, 1, rgb2yuv);
 }
 
 static void planar_rgb10be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -714,9 +743,10 @@ static void planar_rgb10be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
     planar_rgb16_to_a(dst, src, w, 10, 1);
 }
 
-static void planar_rgb12le_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb12le_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 12, 0);
+    planar_rgb16_to_y(dst, src, w, 12, 0, rgb2yuv);
 }
 
 static void planar_rgb12le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -724,9 +754,10 @@ static void planar_rgb12le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
     planar_rgb16_to_a(dst, src, w, 12, 0);
 }
 
-static void planar_rgb12be_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb12be_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 12, 1);
+    planar_rgb16_to_y(dst, src, w, 12, 1, rgb2yuv);
 }
 
 static void planar_rgb12be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -734,9 +765,10 @@ static void planar_rgb12be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
     planar_rgb16_to_a(dst, src, w, 12, 1);
 }
 
-static void planar_rgb16le_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb16le_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 16, 0);
+    planar_rgb16_to_y(dst, src, w, 16, 0, rgb2yuv);
 }
 
 static void planar_rgb16le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -744,9 +776,10 @@ static void planar_rgb16le_to_a(uint8_t *dst, const uint8_t *src[4], int w)
     planar_rgb16_to_a(dst, src, w, 16, 0);
 }
 
-static void planar_rgb16be_to_y(uint8_t *dst, const uint8_t *src[4], int w)
+static void planar_rgb16be_to_y(uint8_t *dst, const uint8_t *src[4], int w,
+                                int32_t *rgb2yuv)
 {
-    planar_rgb16_to_y(dst, src, w, 16, 1);
+    planar_rgb16_to_y(dst, src, w, 16, 1, rgb2yuv);
 }
 
 static void planar_rgb16be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
@@ -756,8 +789,10 @@ static void planar_rgb16be_to_a(uint8_t *dst, const uint8_t *src[4], int w)
 
 static av_always_inline void planar_rgb16_to_uv(uint8_t *_dstU, uint8_t *_dstV,
                                                 const uint8_t *_src[4], int width,
-                                                int bpc, int is_be)
+                                                int bpc, int is_be, int32_t *rgb2yuv)
 {
+    int32_t ru = rgb2yuv[RU_IDX], gu = rgb2yuv[GU_IDX], bu = rgb2yuv[BU_IDX];
+    int32_t rv = rgb2yuv[RV_IDX], gv = rgb2yuv[GV_IDX], bv = rgb2yuv[BV_IDX];
     int i;
     const uint16_t **src = (const uint16_t **)_src;
     uint16_t *dstU       = (uint16_t *)_dstU;
@@ -767,58 +802,58 @@ static av_always_inline void planar_rgb16_to_uv(uint8_t *_dstU, uint8_t *_dstV,
         int b = rdpx(src[1] + i);
         int r = rdpx(src[2] + i);
 
-        dstU[i] = (RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT;
-        dstV[i] = (RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT;
+        dstU[i] = (ru * r + gu * g + bu * b + (257 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT;
+        dstV[i] = (rv * r + gv * g + bv * b + (257 << (RGB2YUV_SHIFT + bpc - 9))) >> RGB2YUV_SHIFT;
     }
 }
 #undef rdpx
 
 static void planar_rgb9le_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                const uint8_t *src[4], int w)
+                                const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 9, 0);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 9, 0, rgb2yuv);
 }
 
 static void planar_rgb9be_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                const uint8_t *src[4], int w)
+                                const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 9, 1);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 9, 1, rgb2yuv);
 }
 
 static void planar_rgb10le_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 10, 0);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 10, 0, rgb2yuv);
 }
 
 static void planar_rgb10be_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 10, 1);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 10, 1, rgb2yuv);
 }
 
 static void planar_rgb12le_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 12, 0);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 12, 0, rgb2yuv);
 }
 
 static void planar_rgb12be_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 12, 1);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 12, 1, rgb2yuv);
 }
 
 static void planar_rgb16le_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 16, 0);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 16, 0, rgb2yuv);
 }
 
 static void planar_rgb16be_to_uv(uint8_t *dstU, uint8_t *dstV,
-                                 const uint8_t *src[4], int w)
+                                 const uint8_t *src[4], int w, int32_t *rgb2yuv)
 {
-    planar_rgb16_to_uv(dstU, dstV, src, w, 16, 1);
+    planar_rgb16_to_uv(dstU, dstV, src, w, 16, 1, rgb2yuv);
 }
 
 av_cold void ff_sws_init_input_funcs(SwsContext *c)
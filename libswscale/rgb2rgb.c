@@ -85,6 +85,21 @@ void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
 void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
                           int width, int height, int srcStride,
                           int dst1Stride, int dst2Stride);
+void (*interleaveWords)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                        int width, int height, int src1Stride,
+                        int src2Stride, int dstStride, int shift);
+void (*deinterleaveWords)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                          int width, int height, int srcStride,
+                          int dst1Stride, int dst2Stride, int shift);
+void (*shiftWords)(const uint8_t *src, uint8_t *dst, int width, int height,
+                   int srcStride, int dstStride, int shift);
+void (*wordsToBytesDither)(const uint8_t *src, uint8_t *dst,
+                           int width, int height, int srcStride,
+                           int dstStride, const uint8_t (*dither)[8],
+                           int y, int shift);
+void (*bytesToWords)(const uint8_t *src, uint8_t *dst, int width,
+                     int height, int srcStride, int dstStride,
+                     int shift, int replicate);
 void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                     uint8_t *dst1, uint8_t *dst2,
                     int width, int height,
@@ -108,6 +123,8 @@ void (*yuyvtoyuv422)(uint8_t *ydst, uint8_t *udst, uint8_t *vdst,
                      const uint8_t *src, int width, int height,
                      int lumStride, int chromStride, int srcStride);
 
+/* lower precision than the scaler input functions */
+#undef RGB2YUV_SHIFT
 #define RGB2YUV_SHIFT 8
 #define BY ((int)( 0.098 * (1 << RGB2YUV_SHIFT) + 0.5))
 #define BV ((int)(-0.071 * (1 << RGB2YUV_SHIFT) + 0.5))
@@ -133,6 +133,41 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * The word functions work on native-endian 16-bit samples, width is in
+ * samples. deinterleaveWords() shifts the samples right by shift,
+ * interleaveWords() left, shiftWords() right if shift is positive and left
+ * by -shift if negative.
+ */
+extern void (*interleaveWords)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                               int width, int height, int src1Stride,
+                               int src2Stride, int dstStride, int shift);
+
+extern void (*deinterleaveWords)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride, int shift);
+
+extern void (*shiftWords)(const uint8_t *src, uint8_t *dst, int width, int height,
+                          int srcStride, int dstStride, int shift);
+
+/**
+ * Convert 16-bit samples to 8 bits as av_clip_uint8((src + dither) >> shift),
+ * dither being the row of the 8x8 matrix for the picture line modulo 8,
+ * with the first line being line y of the picture.
+ */
+extern void (*wordsToBytesDither)(const uint8_t *src, uint8_t *dst,
+                                  int width, int height, int srcStride,
+                                  int dstStride, const uint8_t (*dither)[8],
+                                  int y, int shift);
+
+/**
+ * Convert 8-bit samples to 16 bits as src << shift, or'ed with
+ * src >> (8 - shift) if replicate is set.
+ */
+extern void (*bytesToWords)(const uint8_t *src, uint8_t *dst, int width,
+                            int height, int srcStride, int dstStride,
+                            int shift, int replicate);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -90,6 +90,7 @@ const char *swscale_license(void);
 #define SWS_CS_ITU624         5
 #define SWS_CS_SMPTE170M      5
 #define SWS_CS_SMPTE240M      7
+#define SWS_CS_BT2020         9
 #define SWS_CS_DEFAULT        5
 
 /**
@@ -209,7 +210,10 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               uint8_t *const dst[], const int dstStride[]);
 
 /**
- * @param inv_table the yuv2rgb coefficients, normally ff_yuv2rgb_coeffs[x]
+ * @param inv_table the yuv2rgb coefficients describing the source,
+ *                  normally obtained with sws_getCoefficients()
+ * @param table     the yuv2rgb coefficients describing the destination; for
+ *                  RGB sources converted to YUV the matrix is derived from it
  * @return -1 if not supported
  */
 int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
@@ -298,6 +302,56 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context,
                                         int flags, SwsFilter *srcFilter,
                                         SwsFilter *dstFilter, const double *param);
 
+/**
+ * Context for scaling one source to several outputs, allocated with
+ * sws_cascade_alloc().
+ */
+struct SwsCascade;
+
+/**
+ * Allocate a context for scaling one source to several outputs at once,
+ * e.g. the renditions of an adaptive streaming ladder.
+ *
+ * Unlike with one context per output, a source which needs an input
+ * conversion (packed or semi-planar YUV, RGB) is converted once to a
+ * planar format for all the outputs reading it, and each output is scaled
+ * from the smallest larger output when it has at least its depth and
+ * chroma resolution, instead of from the source.
+ *
+ * @param nb_outputs number of outputs
+ * @param dstW       array of nb_outputs output widths
+ * @param dstH       array of nb_outputs output heights
+ * @param dstFormat  array of nb_outputs output formats
+ * @param flags      flags as in sws_getContext()
+ * @param param      extra parameters as in sws_getContext(), may be NULL
+ * @return a pointer to the allocated context, or NULL in case of error
+ */
+struct SwsCascade *sws_cascade_alloc(int srcW, int srcH, enum AVPixelFormat srcFormat,
+                                     int nb_outputs, const int *dstW, const int *dstH,
+                                     const enum AVPixelFormat *dstFormat,
+                                     int flags, const double *param);
+
+/**
+ * Scale a whole source image to all outputs of a cascade context.
+ *
+ * The outputs may be read while computing the smaller ones, so they must
+ * not overlap.
+ *
+ * @param src       the planes of the source image
+ * @param srcStride the strides of the source planes
+ * @param dst       array of nb_outputs arrays with the planes of each output
+ * @param dstStride array of nb_outputs arrays with the strides of each output
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_cascade_scale(struct SwsCascade *c, const uint8_t *const src[],
+                      const int srcStride[], uint8_t *const *const dst[],
+                      const int *const dstStride[]);
+
+/**
+ * Free a cascade context and set the pointer to NULL.
+ */
+void sws_cascade_free(struct SwsCascade **c);
+
 /**
  * Convert an 8-bit paletted frame into a frame with a color depth of 32 bits.
  *
@@ -37,6 +37,19 @@
 
 #define MAX_FILTER_SIZE 256
 
+#define RGB2YUV_SHIFT 15
+
+/* indexes into SwsContext.input_rgb2yuv_table */
+#define RY_IDX 0
+#define GY_IDX 1
+#define BY_IDX 2
+#define RU_IDX 3
+#define GU_IDX 4
+#define BU_IDX 5
+#define RV_IDX 6
+#define GV_IDX 7
+#define BV_IDX 8
+
 #if HAVE_BIGENDIAN
 #define ALT32_CORR (-1)
 #else
@@ -286,6 +299,14 @@ typedef struct SwsContext {
     uint32_t pal_yuv[256];
     uint32_t pal_rgb[256];
 
+    /**
+     * Limited range RGB to YUV matrix used when reading RGB input,
+     * in RGB2YUV_SHIFT fixed point, indexed by RY_IDX...BV_IDX.
+     * Derived from the table passed to sws_setColorspaceDetails().
+     */
+    int32_t input_rgb2yuv_table[9];
+    int input_rgb2yuv_default;    ///< input_rgb2yuv_table holds the default BT.601 matrix
+
     /**
      * @name Scaled horizontal lines ring buffer.
      * The horizontal scaler keeps just enough scaled lines in a ring buffer
@@ -442,6 +463,8 @@ typedef struct SwsContext {
     yuv2packedX_fn yuv2packedX;
     yuv2anyX_fn yuv2anyX;
 
+    /* For the following three functions pal is pal_yuv for paletted input
+     * and input_rgb2yuv_table for RGB input. */
     /// Unscaled conversion of luma plane to YV12 for horizontal scaler.
     void (*lumToYV12)(uint8_t *dst, const uint8_t *src,
                       int width, uint32_t *pal);
@@ -458,9 +481,10 @@ typedef struct SwsContext {
      * internally to Y/UV/A.
      */
     /** @{ */
-    void (*readLumPlanar)(uint8_t *dst, const uint8_t *src[4], int width);
+    void (*readLumPlanar)(uint8_t *dst, const uint8_t *src[4], int width,
+                          int32_t *rgb2yuv);
     void (*readChrPlanar)(uint8_t *dstU, uint8_t *dstV, const uint8_t *src[4],
-                          int width);
+                          int width, int32_t *rgb2yuv);
     void (*readAlpPlanar)(uint8_t *dst, const uint8_t *src[4], int width);
     /** @} */
 
@@ -707,7 +731,7 @@ extern const uint8_t ff_dither_8x8_73[8][8];
 extern const uint8_t ff_dither_8x8_128[8][8];
 extern const uint8_t ff_dither_8x8_220[8][8];
 
-extern const int32_t ff_yuv2rgb_coeffs[8][4];
+extern const int32_t ff_yuv2rgb_coeffs[10][4];
 
 extern const AVClass ff_sws_context_class;
 
@@ -54,6 +54,17 @@ DECLARE_ALIGNED(8, static const uint8_t, dither_8x8_3)[8][8] = {
     {   1,  2,  1,  2,  1,  2,  1,  2,},
     {   3,  0,  3,  0,  3,  0,  3,  0,},
 };
+/* dither_8x8_3 for 10-bit samples in the high bits of 16 */
+DECLARE_ALIGNED(8, static const uint8_t, dither_8x8_192)[8][8] = {
+    {  64, 128,  64, 128,  64, 128,  64, 128,},
+    { 192,   0, 192,   0, 192,   0, 192,   0,},
+    {  64, 128,  64, 128,  64, 128,  64, 128,},
+    { 192,   0, 192,   0, 192,   0, 192,   0,},
+    {  64, 128,  64, 128,  64, 128,  64, 128,},
+    { 192,   0, 192,   0, 192,   0, 192,   0,},
+    {  64, 128,  64, 128,  64, 128,  64, 128,},
+    { 192,   0, 192,   0, 192,   0, 192,   0,},
+};
 DECLARE_ALIGNED(8, static const uint8_t, dither_8x8_64)[8][8] = {
     {  18, 34, 30, 46, 17, 33, 29, 45,},
     {  50,  2, 62, 14, 49,  1, 61, 13,},
@@ -75,17 +86,6 @@ DECLARE_ALIGNED(8, static const uint8_t, dither_8x8_256)[8][8] = {
     { 224,  32, 208,  16, 236,  44, 220,  28,},
 };
 
-#define RGB2YUV_SHIFT 15
-#define BY ( (int) (0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BV (-(int) (0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BU ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GY ( (int) (0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GV (-(int) (0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GU (-(int) (0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RY ( (int) (0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RV ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RU (-(int) (0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-
 static void fillPlane(uint8_t *plane, int stride, int width, int height, int y,
                       uint8_t val)
 {
@@ -176,6 +176,97 @@ static int nv12ToPlanarWrapper(SwsContext *c, const uint8_t *src[],
     return srcSliceH;
 }
 
+static int planarToP010Wrapper(SwsContext *c, const uint8_t *src[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam[],
+                               int dstStride[])
+{
+    uint8_t *dst0 = dstParam[0] + dstStride[0] * srcSliceY;
+    uint8_t *dst1 = dstParam[1] + dstStride[1] * srcSliceY / 2;
+
+    shiftWords(src[0], dst0, c->srcW, srcSliceH,
+               srcStride[0], dstStride[0], -6);
+    interleaveWords(src[1], src[2], dst1, AV_CEIL_RSHIFT(c->srcW, 1),
+                    srcSliceH / 2, srcStride[1], srcStride[2], dstStride[1], 6);
+
+    return srcSliceH;
+}
+
+static int p010ToPlanarWrapper(SwsContext *c, const uint8_t *src[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam[],
+                               int dstStride[])
+{
+    uint8_t *dst0 = dstParam[0] + dstStride[0] * srcSliceY;
+    uint8_t *dst1 = dstParam[1] + dstStride[1] * srcSliceY / 2;
+    uint8_t *dst2 = dstParam[2] + dstStride[2] * srcSliceY / 2;
+    int chrW = AV_CEIL_RSHIFT(c->srcW, 1);
+    int x, y;
+
+    if (c->dstFormat != AV_PIX_FMT_YUV420P) {
+        shiftWords(src[0], dst0, c->srcW, srcSliceH,
+                   srcStride[0], dstStride[0], 6);
+        deinterleaveWords(src[1], dst1, dst2, chrW, srcSliceH / 2,
+                          srcStride[1], dstStride[1], dstStride[2], 6);
+        return srcSliceH;
+    }
+
+    wordsToBytesDither(src[0], dst0, c->srcW, srcSliceH,
+                       srcStride[0], dstStride[0], dither_8x8_192,
+                       srcSliceY, 8);
+
+    /* dither the chroma to an nv12 line in pieces, then split it */
+    for (y = 0; y < srcSliceH / 2; y++) {
+        const uint8_t *srcLine = src[1] + srcStride[1] * y;
+        uint8_t buf[1024];
+
+        for (x = 0; x < chrW; x += sizeof(buf) / 2) {
+            int w = FFMIN(chrW - x, sizeof(buf) / 2);
+
+            wordsToBytesDither(srcLine + 4 * x, buf, 2 * w, 1, 0, 0,
+                               dither_8x8_192, srcSliceY / 2 + y, 8);
+            deinterleaveBytes(buf, dst1 + dstStride[1] * y + x,
+                              dst2 + dstStride[2] * y + x, w, 1, 0, 0, 0);
+        }
+    }
+
+    return srcSliceH;
+}
+
+static int p010ToNv12Wrapper(SwsContext *c, const uint8_t *src[],
+                             int srcStride[], int srcSliceY,
+                             int srcSliceH, uint8_t *dstParam[],
+                             int dstStride[])
+{
+    uint8_t *dst0 = dstParam[0] + dstStride[0] * srcSliceY;
+    uint8_t *dst1 = dstParam[1] + dstStride[1] * srcSliceY / 2;
+
+    wordsToBytesDither(src[0], dst0, c->srcW, srcSliceH,
+                       srcStride[0], dstStride[0], dither_8x8_192,
+                       srcSliceY, 8);
+    wordsToBytesDither(src[1], dst1, 2 * AV_CEIL_RSHIFT(c->srcW, 1),
+                       srcSliceH / 2, srcStride[1], dstStride[1],
+                       dither_8x8_192, srcSliceY / 2, 8);
+
+    return srcSliceH;
+}
+
+static int nv12ToP010Wrapper(SwsContext *c, const uint8_t *src[],
+                             int srcStride[], int srcSliceY,
+                             int srcSliceH, uint8_t *dstParam[],
+                             int dstStride[])
+{
+    uint8_t *dst0 = dstParam[0] + dstStride[0] * srcSliceY;
+    uint8_t *dst1 = dstParam[1] + dstStride[1] * srcSliceY / 2;
+
+    bytesToWords(src[0], dst0, c->srcW, srcSliceH,
+                 srcStride[0], dstStride[0], 8, 0);
+    bytesToWords(src[1], dst1, 2 * AV_CEIL_RSHIFT(c->srcW, 1),
+                 srcSliceH / 2, srcStride[1], dstStride[1], 8, 0);
+
+    return srcSliceH;
+}
+
 static int planarToYuy2Wrapper(SwsContext *c, const uint8_t *src[],
                                int srcStride[], int srcSliceY, int srcSliceH,
                                uint8_t *dstParam[], int dstStride[])
@@ -709,17 +800,54 @@ static int rgbToRgbWrapper(SwsContext *c, const uint8_t *src[], int srcStride[],
     return srcSliceH;
 }
 
+/* Same sampling as rgb24toyv12(), with the matrix set for the context. */
+static void bgr24toyv12_matrix(SwsContext *c, const uint8_t *src,
+                               uint8_t *ydst, uint8_t *udst, uint8_t *vdst,
+                               int width, int height, int lumStride,
+                               int chromStride, int srcStride)
+{
+    const int32_t *t = c->input_rgb2yuv_table;
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int b = src[3 * x + 0];
+            int g = src[3 * x + 1];
+            int r = src[3 * x + 2];
+
+            ydst[x] = (t[RY_IDX] * r + t[GY_IDX] * g + t[BY_IDX] * b +
+                       (33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+            if (!(y & 1) && !(x & 1)) {
+                udst[x >> 1] = (t[RU_IDX] * r + t[GU_IDX] * g + t[BU_IDX] * b +
+                                (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+                vdst[x >> 1] = (t[RV_IDX] * r + t[GV_IDX] * g + t[BV_IDX] * b +
+                                (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT;
+            }
+        }
+        if (y & 1) {
+            udst += chromStride;
+            vdst += chromStride;
+        }
+        ydst += lumStride;
+        src  += srcStride;
+    }
+}
+
 static int bgr24ToYv12Wrapper(SwsContext *c, const uint8_t *src[],
                               int srcStride[], int srcSliceY, int srcSliceH,
                               uint8_t *dst[], int dstStride[])
 {
-    rgb24toyv12(
-        src[0],
-        dst[0] +  srcSliceY       * dstStride[0],
-        dst[1] + (srcSliceY >> 1) * dstStride[1],
-        dst[2] + (srcSliceY >> 1) * dstStride[2],
-        c->srcW, srcSliceH,
-        dstStride[0], dstStride[1], srcStride[0]);
+    uint8_t *ydst = dst[0] +  srcSliceY       * dstStride[0];
+    uint8_t *udst = dst[1] + (srcSliceY >> 1) * dstStride[1];
+    uint8_t *vdst = dst[2] + (srcSliceY >> 1) * dstStride[2];
+
+    /* the matrix may have been changed after initialization */
+    if (c->input_rgb2yuv_default)
+        rgb24toyv12(src[0], ydst, udst, vdst, c->srcW, srcSliceH,
+                    dstStride[0], dstStride[1], srcStride[0]);
+    else
+        bgr24toyv12_matrix(c, src[0], ydst, udst, vdst, c->srcW, srcSliceH,
+                           dstStride[0], dstStride[1], srcStride[0]);
     if (dst[3])
         fillPlane(dst[3], dstStride[3], c->srcW, srcSliceH, srcSliceY, 255);
     return srcSliceH;
@@ -773,7 +901,7 @@ static int packedCopyWrapper(SwsContext *c, const uint8_t *src[],
 #define clip10(x) av_clip_uintp2(x, 10)
 #define DITHER_COPY(dst, dstStride, wfunc, src, srcStride, rfunc, dithers, shift, clip) \
     for (i = 0; i < height; i++) { \
-        const uint8_t *dither = dithers[i & 7]; \
+        const uint8_t *dither = dithers[(y + i) & 7]; \
         for (j = 0; j < length - 7; j += 8) { \
             wfunc(&dst[j + 0], clip((rfunc(&src[j + 0]) + dither[0]) >> shift)); \
             wfunc(&dst[j + 1], clip((rfunc(&src[j + 1]) + dither[1]) >> shift)); \
@@ -908,7 +1036,12 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                                     srcPtr2, srcStride[plane] / 2, rfunc, \
                                     dither_8x8_3, 2, av_clip_uint8); \
                     }
-                    if (isBE(c->srcFormat)) {
+                    if (!isBE(c->srcFormat) == !HAVE_BIGENDIAN && src_depth <= 10) {
+                        wordsToBytesDither(srcPtr, dstPtr, length, height,
+                                           srcStride[plane], dstStride[plane],
+                                           src_depth == 9 ? dither_8x8_1 : dither_8x8_3,
+                                           y, src_depth - 8);
+                    } else if (isBE(c->srcFormat)) {
                         COPY9_OR_10TO8(AV_RB16);
                     } else {
                         COPY9_OR_10TO8(AV_RL16);
@@ -964,7 +1097,11 @@ static int planarCopyWrapper(SwsContext *c, const uint8_t *src[],
                             srcPtr  += srcStride[plane]; \
                         } \
                     }
-                    if (isBE(c->dstFormat)) {
+                    if (!isBE(c->dstFormat) == !HAVE_BIGENDIAN) {
+                        bytesToWords(srcPtr, dstPtr, length, height,
+                                     srcStride[plane], dstStride[plane],
+                                     dst_depth - 8, !shiftonly);
+                    } else if (isBE(c->dstFormat)) {
                         COPY8TO9_OR_10(AV_WB16);
                     } else {
                         COPY8TO9_OR_10(AV_WL16);
@@ -1047,6 +1184,17 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (srcFormat == AV_PIX_FMT_NV12 || srcFormat == AV_PIX_FMT_NV21)) {
         c->swscale = nv12ToPlanarWrapper;
     }
+    /* p010 <-> yuv420p10, yuv420p and nv12 */
+    if (srcFormat == AV_PIX_FMT_YUV420P10 && dstFormat == AV_PIX_FMT_P010)
+        c->swscale = planarToP010Wrapper;
+    if (srcFormat == AV_PIX_FMT_P010 &&
+        (dstFormat == AV_PIX_FMT_YUV420P10 || dstFormat == AV_PIX_FMT_YUV420P))
+        c->swscale = p010ToPlanarWrapper;
+    if (srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_NV12)
+        c->swscale = p010ToNv12Wrapper;
+    if (srcFormat == AV_PIX_FMT_NV12 && dstFormat == AV_PIX_FMT_P010)
+        c->swscale = nv12ToP010Wrapper;
+
     /* yuv2bgr */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUV422P ||
          srcFormat == AV_PIX_FMT_YUVA420P) && isAnyRGB(dstFormat) &&
@@ -1063,7 +1211,7 @@ void ff_get_unscaled_swscale(SwsContext *c)
     /* bgr24toYV12 */
     if (srcFormat == AV_PIX_FMT_BGR24 &&
         (dstFormat == AV_PIX_FMT_YUV420P || dstFormat == AV_PIX_FMT_YUVA420P) &&
-        !(flags & SWS_ACCURATE_RND))
+        !(flags & SWS_ACCURATE_RND) && c->input_rgb2yuv_default)
         c->swscale = bgr24ToYv12Wrapper;
 
     /* RGB/BGR -> RGB/BGR (no dither needed forms) */
@@ -1235,6 +1383,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     }
 
     if (usePal(c->srcFormat)) {
+        const int32_t *t = c->input_rgb2yuv_table;
+
         for (i = 0; i < 256; i++) {
             int r, g, b, y, u, v;
             if (c->srcFormat == AV_PIX_FMT_PAL8) {
@@ -1263,9 +1413,9 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
                 g = ((i >> 1) & 3) * 85;
                 r = ( i       & 1) * 255;
             }
-            y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+            y = av_clip_uint8((t[RY_IDX] * r + t[GY_IDX] * g + t[BY_IDX] * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+            u = av_clip_uint8((t[RU_IDX] * r + t[GU_IDX] * g + t[BU_IDX] * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+            v = av_clip_uint8((t[RV_IDX] * r + t[GV_IDX] * g + t[BV_IDX] * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
             c->pal_yuv[i] = y + (u << 8) + (v << 16) + (0xFFU << 24);
 
             switch (c->dstFormat) {
@@ -202,8 +202,8 @@ static const FormatEntry format_entries[AV_PIX_FMT_NB] = {
     [AV_PIX_FMT_GBRAP16BE]   = { 1, 0 },
     [AV_PIX_FMT_XYZ12BE]     = { 0, 0, 1 },
     [AV_PIX_FMT_XYZ12LE]     = { 0, 0, 1 },
-    [AV_PIX_FMT_P010LE]      = { 1, 0 },
-    [AV_PIX_FMT_P010BE]      = { 1, 0 },
+    [AV_PIX_FMT_P010LE]      = { 1, 1 },
+    [AV_PIX_FMT_P010BE]      = { 1, 1 },
 };
 
 int sws_isSupportedInput(enum AVPixelFormat pix_fmt)
@@ -804,6 +804,51 @@ static void getSubSampleFactors(int *h, int *v, enum AVPixelFormat format)
     *v = desc->log2_chroma_h;
 }
 
+/**
+ * Derive the RGB to YUV matrix used by the input functions from a
+ * {crv, cbu, cgu, cgv} YUV to RGB table as returned by sws_getCoefficients().
+ */
+static void fill_rgb2yuv_table(SwsContext *c, const int table[4])
+{
+    int32_t *t = c->input_rgb2yuv_table;
+
+    if (!memcmp(table, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT], 4 * sizeof(*table))) {
+        /* keep the historical rounding, which the SIMD versions hardcode */
+        t[RY_IDX] =  (int)(0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[GY_IDX] =  (int)(0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[BY_IDX] =  (int)(0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[RU_IDX] = -(int)(0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[GU_IDX] = -(int)(0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[BU_IDX] =  (int)(0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[RV_IDX] =  (int)(0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[GV_IDX] = -(int)(0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        t[BV_IDX] = -(int)(0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5);
+        c->input_rgb2yuv_default = 1;
+    } else {
+        /* cgu / cbu = kb / kg and cgv / crv = kr / kg */
+        double w   = (double)table[2] / table[1];
+        double v   = (double)table[3] / table[0];
+        double kg  = 1 / (1 + w + v);
+        double kb  = w * kg;
+        double kr  = v * kg;
+        double ys  = 219.0 / 255 * (1 << RGB2YUV_SHIFT);
+        double cs  = 224.0 / 255 * (1 << RGB2YUV_SHIFT);
+
+        /* round such that each row sums up exactly, so that gray stays
+         * gray and white maps to 235 */
+        t[RY_IDX] = lrint(kr * ys);
+        t[BY_IDX] = lrint(kb * ys);
+        t[GY_IDX] = lrint(ys) - t[RY_IDX] - t[BY_IDX];
+        t[RU_IDX] = lrint(-kr / (2 * (1 - kb)) * cs);
+        t[BU_IDX] = lrint(0.5 * cs);
+        t[GU_IDX] = -t[RU_IDX] - t[BU_IDX];
+        t[BV_IDX] = lrint(-kb / (2 * (1 - kr)) * cs);
+        t[RV_IDX] = lrint(0.5 * cs);
+        t[GV_IDX] = -t[RV_IDX] - t[BV_IDX];
+        c->input_rgb2yuv_default = 0;
+    }
+}
+
 int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
                              int srcRange, const int table[4], int dstRange,
                              int brightness, int contrast, int saturation)
@@ -818,8 +863,16 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     c->saturation = saturation;
     c->srcRange   = srcRange;
     c->dstRange   = dstRange;
+
+    fill_rgb2yuv_table(c, table);
+    /* the input functions are chosen depending on the matrix */
+    if (c->lumToYV12 && isAnyRGB(c->srcFormat))
+        ff_getSwsFunc(c);
+
+    /* only the RGB to YUV matrix applies to a YUV or gray output, and it
+     * has been set above */
     if (isYUV(c->dstFormat) || isGray(c->dstFormat))
-        return -1;
+        return isAnyRGB(c->srcFormat) ? 0 : -1;
 
     c->dstFormatBpp = av_get_bits_per_pixel(desc_dst);
     c->srcFormatBpp = av_get_bits_per_pixel(desc_src);
@@ -838,7 +891,7 @@ int sws_getColorspaceDetails(struct SwsContext *c, int **inv_table,
                              int *srcRange, int **table, int *dstRange,
                              int *brightness, int *contrast, int *saturation)
 {
-    if (isYUV(c->dstFormat) || isGray(c->dstFormat))
+    if ((isYUV(c->dstFormat) || isGray(c->dstFormat)) && !isAnyRGB(c->srcFormat))
         return -1;
 
     *inv_table  = c->srcColorspaceTable;
@@ -879,6 +932,7 @@ SwsContext *sws_alloc_context(void)
     if (c) {
         c->av_class = &ff_sws_context_class;
         av_opt_set_defaults(c);
+        fill_rgb2yuv_table(c, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT]);
     }
 
     return c;
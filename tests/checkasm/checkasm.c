@@ -77,6 +77,9 @@ static const struct {
     { "dcadsp", checkasm_check_dcadsp },
     { "synth_filter", checkasm_check_synth_filter },
 #endif
+#if CONFIG_FLACDSP
+    { "flacdsp", checkasm_check_flacdsp },
+#endif
 #if CONFIG_FMTCONVERT
     { "fmtconvert", checkasm_check_fmtconvert },
 #endif
@@ -97,6 +100,17 @@ static const struct {
 #if CONFIG_HUFFYUVDSP
     { "huffyuvdsp", checkasm_check_huffyuvdsp },
 #endif
+#if CONFIG_HUFFYUVENCDSP
+    { "huffyuvencdsp", checkasm_check_huffyuvencdsp },
+#endif
+#if CONFIG_PNG_DECODER
+    { "pngdsp", checkasm_check_pngdsp },
+#endif
+#if CONFIG_SWSCALE
+    { "sw_rgb", checkasm_check_sw_rgb },
+    { "sw_scale", checkasm_check_sw_scale },
+    { "sw_yuv2rgb", checkasm_check_sw_yuv2rgb },
+#endif
 #if CONFIG_V210_ENCODER
     { "v210enc", checkasm_check_v210enc },
 #endif
@@ -0,0 +1,62 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+
+#include "libavcodec/flacdsp.h"
+
+#include "checkasm.h"
+
+#define BUF_SIZE 256
+
+void checkasm_check_flacdsp(void)
+{
+    LOCAL_ALIGNED_16(int32_t, ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int32_t, new, [BUF_SIZE]);
+    int coeffs[32];
+    FLACDSPContext c;
+    int order, i;
+
+    declare_func(void, int32_t *decoded, const int coeffs[32],
+                 int pred_order, int qlevel, int len);
+
+    ff_flacdsp_init(&c, AV_SAMPLE_FMT_S16, 16);
+
+    for (order = 1; order <= 32; order++) {
+        if (check_func(c.lpc, "flac_lpc_16_%d", order)) {
+            int qlevel = rnd() % 16;
+            /* keep the filter contracting, so the output stays in range */
+            int range  = (1 << qlevel) / order + 1;
+
+            for (i = 0; i < order; i++)
+                coeffs[i] = (int)(rnd() % range) - range / 2;
+            for (i = 0; i < BUF_SIZE; i++)
+                ref[i] = (int)(rnd() % (1 << 12)) - (1 << 11);
+            memcpy(new, ref, BUF_SIZE * sizeof(*ref));
+
+            call_ref(ref, coeffs, order, qlevel, BUF_SIZE);
+            call_new(new, coeffs, order, qlevel, BUF_SIZE);
+            if (memcmp(ref, new, BUF_SIZE * sizeof(*ref)))
+                fail();
+            bench_new(new, coeffs, order, qlevel, BUF_SIZE);
+        }
+    }
+    report("lpc");
+}
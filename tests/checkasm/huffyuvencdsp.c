@@ -0,0 +1,102 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#include "libavcodec/huffyuvencdsp.h"
+
+#include "checkasm.h"
+
+#define BUF_SIZE 1080
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+        int j;                           \
+        for (j = 0; j < size; j++)       \
+            buf[j] = rnd() & 0xFF;       \
+    } while (0)
+
+static void check_diff_bytes(HuffYUVEncDSPContext *c)
+{
+    LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src2, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [BUF_SIZE]);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src1,
+                      uint8_t *src2, int w);
+
+    if (check_func(c->diff_bytes, "diff_bytes")) {
+        int w = rnd() % (BUF_SIZE - 16) + 1;
+
+        randomize_buffers(src1, BUF_SIZE);
+        randomize_buffers(src2, BUF_SIZE);
+        memset(dst0, 0, BUF_SIZE);
+        memset(dst1, 0, BUF_SIZE);
+
+        /* src2 is only 1-byte aligned when used for left prediction */
+        call_ref(dst0, src1, src2 + 1, w);
+        call_new(dst1, src1, src2 + 1, w);
+        if (memcmp(dst0, dst1, w))
+            fail();
+        bench_new(dst1, src1, src2 + 1, BUF_SIZE - 16);
+    }
+}
+
+static void check_sub_hfyu_median_pred(HuffYUVEncDSPContext *c)
+{
+    LOCAL_ALIGNED_32(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src2, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [BUF_SIZE]);
+
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, const uint8_t *src1,
+                      const uint8_t *src2, int w, int *left, int *left_top);
+
+    if (check_func(c->sub_hfyu_median_pred, "sub_hfyu_median_pred")) {
+        int w = rnd() % (BUF_SIZE - 32) + 1;
+        int left0 = rnd() & 0xFF, left_top0 = rnd() & 0xFF;
+        int left1 = left0,        left_top1 = left_top0;
+
+        randomize_buffers(src1, BUF_SIZE);
+        randomize_buffers(src2, BUF_SIZE);
+        memset(dst0, 0, BUF_SIZE);
+        memset(dst1, 0, BUF_SIZE);
+
+        call_ref(dst0, src1 + 16, src2 + 16, w, &left0, &left_top0);
+        call_new(dst1, src1 + 16, src2 + 16, w, &left1, &left_top1);
+        if (memcmp(dst0, dst1, w) || left0 != left1 || left_top0 != left_top1)
+            fail();
+        bench_new(dst1, src1 + 16, src2 + 16, BUF_SIZE - 32, &left1, &left_top1);
+    }
+}
+
+void checkasm_check_huffyuvencdsp(void)
+{
+    HuffYUVEncDSPContext c;
+
+    ff_huffyuvencdsp_init(&c);
+
+    check_diff_bytes(&c);
+    report("diff_bytes");
+
+    check_sub_hfyu_median_pred(&c);
+    report("sub_hfyu_median_pred");
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#include "libavcodec/pngdsp.h"
+
+#include "checkasm.h"
+
+#define BUF_SIZE 4096
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+        int j;                           \
+        for (j = 0; j < size; j++)       \
+            buf[j] = rnd() & 0xFF;       \
+    } while (0)
+
+static void check_add_bytes_l2(PNGDSPContext *c)
+{
+    LOCAL_ALIGNED_16(uint8_t, src1, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, src2, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src1,
+                      uint8_t *src2, int w);
+
+    if (check_func(c->add_bytes_l2, "add_bytes_l2")) {
+        /* odd widths exercise the narrower tail loops */
+        int w = av_clip(rnd() % BUF_SIZE, 1, BUF_SIZE);
+
+        randomize_buffers(src1, BUF_SIZE);
+        randomize_buffers(src2, BUF_SIZE);
+        memset(dst0, 0, BUF_SIZE);
+        memset(dst1, 0, BUF_SIZE);
+
+        call_ref(dst0, src1, src2, w);
+        call_new(dst1, src1, src2, w);
+        if (memcmp(dst0, dst1, BUF_SIZE))
+            fail();
+        bench_new(dst1, src1, src2, BUF_SIZE);
+    }
+}
+
+static void check_add_paeth_prediction(PNGDSPContext *c, int bpp)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, top, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [BUF_SIZE]);
+    declare_func_emms(AV_CPU_FLAG_MMX, void, uint8_t *dst, uint8_t *src,
+                      uint8_t *top, int w, int bpp);
+
+    if (check_func(c->add_paeth_prediction, "add_paeth_prediction_%d", bpp)) {
+        /* the first pixel only has the top neighbour, as in the decoder;
+         * leave room for the write past the end of the row */
+        int w = (BUF_SIZE - 2 * bpp) / bpp * bpp;
+
+        randomize_buffers(src, BUF_SIZE);
+        randomize_buffers(top, BUF_SIZE);
+        randomize_buffers(dst0, BUF_SIZE);
+        memcpy(dst1, dst0, BUF_SIZE);
+
+        call_ref(dst0 + bpp, src + bpp, top + bpp, w, bpp);
+        call_new(dst1 + bpp, src + bpp, top + bpp, w, bpp);
+        if (memcmp(dst0, dst1, bpp + w))
+            fail();
+        bench_new(dst1 + bpp, src + bpp, top + bpp, w, bpp);
+    }
+}
+
+void checkasm_check_pngdsp(void)
+{
+    PNGDSPContext c;
+
+    ff_pngdsp_init(&c);
+
+    check_add_bytes_l2(&c);
+    report("add_bytes_l2");
+
+    check_add_paeth_prediction(&c, 3);
+    check_add_paeth_prediction(&c, 4);
+    report("add_paeth_prediction");
+}
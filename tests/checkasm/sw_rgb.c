@@ -0,0 +1,417 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/pixfmt.h"
+
+#include "libswscale/rgb2rgb.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define WIDTH  512
+#define HEIGHT 4
+#define STRIDE (WIDTH * 4 + 64)
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+        int j;                           \
+        for (j = 0; j < size; j++)       \
+            buf[j] = rnd() & 0xFF;       \
+    } while (0)
+
+static const struct {
+    const char *name;
+    void (**func)(const uint8_t *src, uint8_t *dst, int src_size);
+    int src_bpp, dst_bpp;
+} packed_funcs[] = {
+    { "rgb24tobgr32",       &rgb24tobgr32,       3, 4 },
+    { "rgb24tobgr16",       &rgb24tobgr16,       3, 2 },
+    { "rgb24tobgr15",       &rgb24tobgr15,       3, 2 },
+    { "rgb32tobgr24",       &rgb32tobgr24,       4, 3 },
+    { "rgb32to16",          &rgb32to16,          4, 2 },
+    { "rgb32to15",          &rgb32to15,          4, 2 },
+    { "rgb15to16",          &rgb15to16,          2, 2 },
+    { "rgb15tobgr24",       &rgb15tobgr24,       2, 3 },
+    { "rgb15to32",          &rgb15to32,          2, 4 },
+    { "rgb16to15",          &rgb16to15,          2, 2 },
+    { "rgb16tobgr24",       &rgb16tobgr24,       2, 3 },
+    { "rgb16to32",          &rgb16to32,          2, 4 },
+    { "rgb24tobgr24",       &rgb24tobgr24,       3, 3 },
+    { "rgb24to16",          &rgb24to16,          3, 2 },
+    { "rgb24to15",          &rgb24to15,          3, 2 },
+    { "rgb32tobgr16",       &rgb32tobgr16,       4, 2 },
+    { "rgb32tobgr15",       &rgb32tobgr15,       4, 2 },
+    { "shuffle_bytes_2103", &shuffle_bytes_2103, 4, 4 },
+};
+
+static void check_packed(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [WIDTH * 4]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [WIDTH * 4]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [WIDTH * 4]);
+    int i, width;
+
+    declare_func(void, const uint8_t *src, uint8_t *dst, int src_size);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(packed_funcs); i++) {
+        if (check_func(*packed_funcs[i].func, "%s", packed_funcs[i].name)) {
+            for (width = WIDTH - 7; width <= WIDTH; width += 7) {
+                randomize_buffers(src, WIDTH * 4);
+                memset(dst0, 0, WIDTH * 4);
+                memset(dst1, 0, WIDTH * 4);
+                call_ref(src, dst0, width * packed_funcs[i].src_bpp);
+                call_new(src, dst1, width * packed_funcs[i].src_bpp);
+                if (memcmp(dst0, dst1, width * packed_funcs[i].dst_bpp))
+                    fail();
+            }
+            bench_new(src, dst1, WIDTH * packed_funcs[i].src_bpp);
+        }
+    }
+}
+
+static void check_planar_to_packed(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src_y, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src_u, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src_v, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [STRIDE * HEIGHT]);
+    static const struct {
+        const char *name;
+        void (**func)(const uint8_t *ysrc, const uint8_t *usrc,
+                      const uint8_t *vsrc, uint8_t *dst,
+                      int width, int height,
+                      int lumStride, int chromStride, int dstStride);
+    } funcs[] = {
+        { "yv12toyuy2",    &yv12toyuy2    },
+        { "yv12touyvy",    &yv12touyvy    },
+        { "yuv422ptoyuy2", &yuv422ptoyuy2 },
+        { "yuv422ptouyvy", &yuv422ptouyvy },
+    };
+    int i;
+
+    declare_func(void, const uint8_t *ysrc, const uint8_t *usrc,
+                 const uint8_t *vsrc, uint8_t *dst, int width, int height,
+                 int lumStride, int chromStride, int dstStride);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(funcs); i++) {
+        if (check_func(*funcs[i].func, "%s", funcs[i].name)) {
+            randomize_buffers(src_y, STRIDE * HEIGHT);
+            randomize_buffers(src_u, STRIDE * HEIGHT);
+            randomize_buffers(src_v, STRIDE * HEIGHT);
+            memset(dst0, 0, STRIDE * HEIGHT);
+            memset(dst1, 0, STRIDE * HEIGHT);
+            call_ref(src_y, src_u, src_v, dst0, WIDTH, HEIGHT, STRIDE, STRIDE / 2, STRIDE);
+            call_new(src_y, src_u, src_v, dst1, WIDTH, HEIGHT, STRIDE, STRIDE / 2, STRIDE);
+            if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                fail();
+            bench_new(src_y, src_u, src_v, dst1, WIDTH, HEIGHT, STRIDE, STRIDE / 2, STRIDE);
+        }
+    }
+}
+
+static void check_interleave(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src1, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst2, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst3, [STRIDE * HEIGHT]);
+    int width;
+
+    randomize_buffers(src0, STRIDE * HEIGHT);
+    randomize_buffers(src1, STRIDE * HEIGHT);
+
+    {
+        declare_func(void, const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                     int width, int height, int src1Stride, int src2Stride,
+                     int dstStride);
+
+        if (check_func(interleaveBytes, "interleave_bytes")) {
+            for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                memset(dst0, 0, STRIDE * HEIGHT);
+                memset(dst1, 0, STRIDE * HEIGHT);
+                call_ref(src0, src1, dst0, width, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE);
+                call_new(src0, src1, dst1, width, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE);
+                if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                    fail();
+            }
+            bench_new(src0, src1, dst1, WIDTH, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE);
+        }
+    }
+
+    {
+        declare_func(void, const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                     int width, int height, int srcStride,
+                     int dst1Stride, int dst2Stride);
+
+        if (check_func(deinterleaveBytes, "deinterleave_bytes")) {
+            for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                memset(dst0, 0, STRIDE * HEIGHT);
+                memset(dst1, 0, STRIDE * HEIGHT);
+                memset(dst2, 0, STRIDE * HEIGHT);
+                memset(dst3, 0, STRIDE * HEIGHT);
+                call_ref(src0, dst0, dst1, width, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2);
+                call_new(src0, dst2, dst3, width, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2);
+                if (memcmp(dst0, dst2, STRIDE * HEIGHT) ||
+                    memcmp(dst1, dst3, STRIDE * HEIGHT))
+                    fail();
+            }
+            bench_new(src0, dst2, dst3, WIDTH, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2);
+        }
+    }
+}
+
+/* 16-bit samples, the width is in samples */
+static void check_words(void)
+{
+    LOCAL_ALIGNED_16(uint8_t, src0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src1, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst2, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst3, [STRIDE * HEIGHT]);
+    uint8_t dither[8][8];
+    int width, shift;
+
+    randomize_buffers(src0, STRIDE * HEIGHT);
+    randomize_buffers(src1, STRIDE * HEIGHT);
+    randomize_buffers(dither[0], 64);
+
+    {
+        declare_func(void, const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
+                     int width, int height, int src1Stride, int src2Stride,
+                     int dstStride, int shift);
+
+        if (check_func(interleaveWords, "interleave_words")) {
+            for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                memset(dst0, 0, STRIDE * HEIGHT);
+                memset(dst1, 0, STRIDE * HEIGHT);
+                call_ref(src0, src1, dst0, width, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE, 6);
+                call_new(src0, src1, dst1, width, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE, 6);
+                if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                    fail();
+            }
+            bench_new(src0, src1, dst1, WIDTH, HEIGHT, STRIDE / 2, STRIDE / 2, STRIDE, 6);
+        }
+    }
+
+    {
+        declare_func(void, const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                     int width, int height, int srcStride,
+                     int dst1Stride, int dst2Stride, int shift);
+
+        if (check_func(deinterleaveWords, "deinterleave_words")) {
+            for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                memset(dst0, 0, STRIDE * HEIGHT);
+                memset(dst1, 0, STRIDE * HEIGHT);
+                memset(dst2, 0, STRIDE * HEIGHT);
+                memset(dst3, 0, STRIDE * HEIGHT);
+                call_ref(src0, dst0, dst1, width, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2, 6);
+                call_new(src0, dst2, dst3, width, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2, 6);
+                if (memcmp(dst0, dst2, STRIDE * HEIGHT) ||
+                    memcmp(dst1, dst3, STRIDE * HEIGHT))
+                    fail();
+            }
+            bench_new(src0, dst2, dst3, WIDTH, HEIGHT, STRIDE, STRIDE / 2, STRIDE / 2, 6);
+        }
+    }
+
+    {
+        declare_func(void, const uint8_t *src, uint8_t *dst, int width, int height,
+                     int srcStride, int dstStride, int shift);
+
+        if (check_func(shiftWords, "shift_words")) {
+            for (shift = -6; shift <= 6; shift += 12) {
+                for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                    memset(dst0, 0, STRIDE * HEIGHT);
+                    memset(dst1, 0, STRIDE * HEIGHT);
+                    call_ref(src0, dst0, width, HEIGHT, STRIDE, STRIDE, shift);
+                    call_new(src0, dst1, width, HEIGHT, STRIDE, STRIDE, shift);
+                    if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                        fail();
+                }
+            }
+            bench_new(src0, dst1, WIDTH, HEIGHT, STRIDE, STRIDE, 6);
+        }
+    }
+
+    {
+        declare_func(void, const uint8_t *src, uint8_t *dst, int width, int height,
+                     int srcStride, int dstStride, const uint8_t (*dither)[8],
+                     int y, int shift);
+
+        if (check_func(wordsToBytesDither, "words_to_bytes_dither")) {
+            for (shift = 2; shift <= 8; shift += 6) {
+                for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                    memset(dst0, 0, STRIDE * HEIGHT);
+                    memset(dst1, 0, STRIDE * HEIGHT);
+                    call_ref(src0, dst0, width, HEIGHT, STRIDE, STRIDE,
+                             (const uint8_t (*)[8])dither, 3, shift);
+                    call_new(src0, dst1, width, HEIGHT, STRIDE, STRIDE,
+                             (const uint8_t (*)[8])dither, 3, shift);
+                    if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                        fail();
+                }
+            }
+            bench_new(src0, dst1, WIDTH, HEIGHT, STRIDE, STRIDE,
+                      (const uint8_t (*)[8])dither, 3, 8);
+        }
+    }
+
+    {
+        declare_func(void, const uint8_t *src, uint8_t *dst, int width, int height,
+                     int srcStride, int dstStride, int shift, int replicate);
+
+        if (check_func(bytesToWords, "bytes_to_words")) {
+            for (shift = 2; shift <= 8; shift += 6) {
+                for (width = WIDTH - 15; width <= WIDTH; width += 15) {
+                    memset(dst0, 0, STRIDE * HEIGHT);
+                    memset(dst1, 0, STRIDE * HEIGHT);
+                    call_ref(src0, dst0, width, HEIGHT, STRIDE / 2, STRIDE, shift, shift < 8);
+                    call_new(src0, dst1, width, HEIGHT, STRIDE / 2, STRIDE, shift, shift < 8);
+                    if (memcmp(dst0, dst1, STRIDE * HEIGHT))
+                        fail();
+                }
+            }
+            bench_new(src0, dst1, WIDTH, HEIGHT, STRIDE / 2, STRIDE, 2, 0);
+        }
+    }
+}
+
+static void check_rgb2rgb(void)
+{
+    ff_rgb2rgb_init();
+
+    check_packed();
+    check_planar_to_packed();
+    check_interleave();
+    check_words();
+}
+
+static const enum AVPixelFormat input_formats[] = {
+    AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+    AV_PIX_FMT_RGBA,  AV_PIX_FMT_BGRA,
+    AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+    AV_PIX_FMT_YUYV422, AV_PIX_FMT_UYVY422,
+    AV_PIX_FMT_NV12,  AV_PIX_FMT_NV21,
+};
+
+/* lumToYV12 and chrToYV12 of a context converting from fmt, with the given
+ * matrix for RGB input and full or half chroma resolution */
+static void check_input_funcs(enum AVPixelFormat fmt, int colorspace,
+                              int full_chroma)
+{
+    LOCAL_ALIGNED_16(uint8_t, src, [WIDTH * 8]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [WIDTH * 2 + 32]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [WIDTH * 2 + 32]);
+    LOCAL_ALIGNED_16(uint8_t, dst2, [WIDTH * 2 + 32]);
+    LOCAL_ALIGNED_16(uint8_t, dst3, [WIDTH * 2 + 32]);
+    const char *name = av_get_pix_fmt_name(fmt);
+    const char *suffix = colorspace == SWS_CS_BT2020 ? "_bt2020" : "";
+    int rgb = isAnyRGB(fmt);
+    int sample_size = rgb ? 2 : 1;
+    uint32_t *pal;
+    SwsContext *c;
+
+    c = sws_getContext(WIDTH, 16, fmt, WIDTH / 2, 16, AV_PIX_FMT_YUV420P,
+                       SWS_BILINEAR | (full_chroma ? SWS_FULL_CHR_H_INP : 0),
+                       NULL, NULL, NULL);
+    if (!c)
+        return;
+    if (colorspace != SWS_CS_DEFAULT) {
+        const int *table = sws_getCoefficients(colorspace);
+        sws_setColorspaceDetails(c, table, 0, table, 0, 0, 1 << 16, 1 << 16);
+    }
+    pal = (uint32_t *)c->input_rgb2yuv_table;
+
+    randomize_buffers(src, WIDTH * 8);
+
+    if (full_chroma) {
+        declare_func(void, uint8_t *dst, const uint8_t *src, int width,
+                     uint32_t *pal);
+
+        if (c->lumToYV12 &&
+            check_func(c->lumToYV12, "%s_to_y%s", name, suffix)) {
+            memset(dst0, 0, WIDTH * 2);
+            memset(dst1, 0, WIDTH * 2);
+            call_ref(dst0, src, WIDTH, pal);
+            call_new(dst1, src, WIDTH, pal);
+            if (memcmp(dst0, dst1, WIDTH * sample_size))
+                fail();
+            bench_new(dst1, src, WIDTH, pal);
+        }
+    }
+
+    {
+        declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                     const uint8_t *src1, const uint8_t *src2,
+                     int width, uint32_t *pal);
+
+        if (c->chrToYV12 &&
+            check_func(c->chrToYV12, "%s_to_uv%s%s", name,
+                       rgb && !full_chroma ? "_half" : "", suffix)) {
+            int width = c->chrSrcW;
+
+            memset(dst0, 0, WIDTH * 2);
+            memset(dst1, 0, WIDTH * 2);
+            memset(dst2, 0, WIDTH * 2);
+            memset(dst3, 0, WIDTH * 2);
+            call_ref(dst0, dst1, src, src, width, pal);
+            call_new(dst2, dst3, src, src, width, pal);
+            if (memcmp(dst0, dst2, width * sample_size) ||
+                memcmp(dst1, dst3, width * sample_size))
+                fail();
+            bench_new(dst2, dst3, src, src, width, pal);
+        }
+    }
+
+    sws_freeContext(c);
+}
+
+static void check_input(void)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(input_formats); i++) {
+        enum AVPixelFormat fmt = input_formats[i];
+
+        check_input_funcs(fmt, SWS_CS_DEFAULT, 1);
+        if (isAnyRGB(fmt)) {
+            check_input_funcs(fmt, SWS_CS_DEFAULT, 0);
+            check_input_funcs(fmt, SWS_CS_BT2020, 1);
+            check_input_funcs(fmt, SWS_CS_BT2020, 0);
+        }
+    }
+}
+
+void checkasm_check_sw_rgb(void)
+{
+    check_rgb2rgb();
+    report("rgb2rgb");
+
+    check_input();
+    report("input");
+}
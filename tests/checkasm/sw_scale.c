@@ -0,0 +1,233 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixfmt.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define SRC_PIXELS 1024
+#define DST_PIXELS 512
+#define PAD        8  /* entries the SIMD scalers may read past the end */
+#define MAX_TAPS   40
+#define MAX_LINES  16
+
+static const struct {
+    enum AVPixelFormat fmt;
+    int bits;
+} formats[] = {
+    { AV_PIX_FMT_YUV420P,    8 },
+    { AV_PIX_FMT_YUV420P9,   9 },
+    { AV_PIX_FMT_YUV420P10, 10 },
+    { AV_PIX_FMT_YUV420P12, 12 },
+    { AV_PIX_FMT_YUV420P16, 16 },
+};
+
+/* A context with the given formats, whose scaler functions are chosen for
+ * the given filter sizes and the current cpu flags. */
+static SwsContext *alloc_context(enum AVPixelFormat src, enum AVPixelFormat dst,
+                                 int hfilter_size, int vfilter_size)
+{
+    SwsContext *c = sws_getContext(SRC_PIXELS, 16, src, DST_PIXELS, 16, dst,
+                                   SWS_BILINEAR, NULL, NULL, NULL);
+    if (!c)
+        return NULL;
+    c->hLumFilterSize = c->hChrFilterSize = hfilter_size;
+    c->vLumFilterSize = c->vChrFilterSize = vfilter_size;
+    ff_getSwsFunc(c);
+    return c;
+}
+
+/* size coefficients summing to one, the SIMD versions rely on this for
+ * 16-bit input */
+static void randomize_filter(int16_t *filter, int size, int one)
+{
+    int i, sum = 0, left = one;
+
+    for (i = 0; i < size; i++) {
+        filter[i] = rnd() % (2 * one / size + 1);
+        sum      += filter[i];
+    }
+    for (i = 0; i < size; i++) {
+        filter[i] = filter[i] * one / FFMAX(sum, 1);
+        left     -= filter[i];
+    }
+    filter[rnd() % size] += left;
+}
+
+static void check_hscale(void)
+{
+    LOCAL_ALIGNED_16(uint16_t, src, [SRC_PIXELS + MAX_TAPS]);
+    LOCAL_ALIGNED_16(int32_t, dst0, [DST_PIXELS + PAD]);
+    LOCAL_ALIGNED_16(int32_t, dst1, [DST_PIXELS + PAD]);
+    static const int filter_sizes[] = { 4, 8, 12, 16, 20, 40 };
+    int16_t *filter  = av_malloc((DST_PIXELS + PAD) * MAX_TAPS * sizeof(*filter));
+    int32_t *filter_pos = av_malloc((DST_PIXELS + PAD) * sizeof(*filter_pos));
+    int i, j, k, fsi;
+
+    declare_func(void, SwsContext *c, int16_t *dst, int dstW,
+                 const uint8_t *src, const int16_t *filter,
+                 const int32_t *filterPos, int filterSize);
+
+    if (!filter || !filter_pos)
+        goto end;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        int src_bits = formats[i].bits;
+
+        for (j = 0; j < 2; j++) {
+            enum AVPixelFormat dst_fmt = j ? AV_PIX_FMT_YUV420P16 : AV_PIX_FMT_YUV420P;
+            int dst_bits = j ? 19 : 15;
+
+            for (fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+                int size = filter_sizes[fsi];
+                SwsContext *c = alloc_context(formats[i].fmt, dst_fmt, size, 2);
+
+                if (!c)
+                    continue;
+
+                if (check_func(c->hyScale, "hscale_%d_to_%d_%d",
+                               src_bits, dst_bits, size)) {
+                    for (k = 0; k < SRC_PIXELS + MAX_TAPS; k++) {
+                        if (src_bits == 8)
+                            ((uint8_t *)src)[k] = rnd();
+                        else
+                            src[k] = rnd() & ((1 << src_bits) - 1);
+                    }
+                    for (k = 0; k < DST_PIXELS; k++) {
+                        filter_pos[k] = rnd() % (SRC_PIXELS - size + 1);
+                        randomize_filter(filter + k * size, size, 1 << 14);
+                    }
+                    for (; k < DST_PIXELS + PAD; k++) {
+                        filter_pos[k] = filter_pos[DST_PIXELS - 1];
+                        memcpy(filter + k * size, filter + (DST_PIXELS - 1) * size,
+                               size * sizeof(*filter));
+                    }
+
+                    memset(dst0, 0, (DST_PIXELS + PAD) * sizeof(*dst0));
+                    memset(dst1, 0, (DST_PIXELS + PAD) * sizeof(*dst1));
+                    call_ref(c, (int16_t *)dst0, DST_PIXELS, (const uint8_t *)src,
+                             filter, filter_pos, size);
+                    call_new(c, (int16_t *)dst1, DST_PIXELS, (const uint8_t *)src,
+                             filter, filter_pos, size);
+                    if (memcmp(dst0, dst1, DST_PIXELS * (dst_bits == 15 ? 2 : 4)))
+                        fail();
+                    bench_new(c, (int16_t *)dst1, DST_PIXELS, (const uint8_t *)src,
+                              filter, filter_pos, size);
+                }
+                sws_freeContext(c);
+            }
+        }
+    }
+
+end:
+    av_free(filter);
+    av_free(filter_pos);
+}
+
+static void check_vscale(void)
+{
+    LOCAL_ALIGNED_16(int32_t, src, [MAX_LINES], [DST_PIXELS + PAD]);
+    LOCAL_ALIGNED_16(uint16_t, dst0, [DST_PIXELS + 16]);
+    LOCAL_ALIGNED_16(uint16_t, dst1, [DST_PIXELS + 16]);
+    LOCAL_ALIGNED_16(int16_t, filter, [MAX_LINES]);
+    const int16_t *lines[MAX_LINES];
+    uint8_t dither[8];
+    int i, j, k, size, offset;
+
+    for (i = 0; i < MAX_LINES; i++)
+        lines[i] = (const int16_t *)src[i];
+
+    for (i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        int bits = formats[i].bits;
+        int dst_size = DST_PIXELS * (bits == 8 ? 1 : 2);
+        SwsContext *c;
+
+        if (bits == 12)
+            continue;
+        if (!(c = alloc_context(AV_PIX_FMT_YUV420P, formats[i].fmt, 4, 4)))
+            continue;
+
+        /* 15-bit input for 8-10 bit output, 19-bit for 16 */
+        for (j = 0; j < MAX_LINES; j++)
+            for (k = 0; k < DST_PIXELS + PAD; k++) {
+                if (bits == 16)
+                    src[j][k] = rnd() & 0x7FFFF;
+                else
+                    ((int16_t *)src[j])[k] = rnd() & 0x7FFF;
+            }
+        for (j = 0; j < 8; j++)
+            dither[j] = rnd();
+
+        {
+            declare_func(void, const int16_t *filter, int filterSize,
+                         const int16_t **src, uint8_t *dest, int dstW,
+                         const uint8_t *dither, int offset);
+
+            if (check_func(c->yuv2planeX, "yuv2planeX_%d", bits)) {
+                for (size = 2; size <= MAX_LINES; size += 2) {
+                    for (offset = 0; offset <= 3; offset += 3) {
+                        randomize_filter(filter, size, 1 << 12);
+                        memset(dst0, 0, sizeof(*dst0) * (DST_PIXELS + 16));
+                        memset(dst1, 0, sizeof(*dst1) * (DST_PIXELS + 16));
+                        call_ref(filter, size, lines, (uint8_t *)dst0, DST_PIXELS,
+                                 dither, offset);
+                        call_new(filter, size, lines, (uint8_t *)dst1, DST_PIXELS,
+                                 dither, offset);
+                        if (memcmp(dst0, dst1, dst_size))
+                            fail();
+                    }
+                }
+                bench_new(filter, 8, lines, (uint8_t *)dst1, DST_PIXELS, dither, 0);
+            }
+        }
+
+        {
+            declare_func(void, const int16_t *src, uint8_t *dest, int dstW,
+                         const uint8_t *dither, int offset);
+
+            if (check_func(c->yuv2plane1, "yuv2plane1_%d", bits)) {
+                for (offset = 0; offset <= 3; offset += 3) {
+                    memset(dst0, 0, sizeof(*dst0) * (DST_PIXELS + 16));
+                    memset(dst1, 0, sizeof(*dst1) * (DST_PIXELS + 16));
+                    call_ref(lines[0], (uint8_t *)dst0, DST_PIXELS, dither, offset);
+                    call_new(lines[0], (uint8_t *)dst1, DST_PIXELS, dither, offset);
+                    if (memcmp(dst0, dst1, dst_size))
+                        fail();
+                }
+                bench_new(lines[0], (uint8_t *)dst1, DST_PIXELS, dither, 0);
+            }
+        }
+        sws_freeContext(c);
+    }
+}
+
+void checkasm_check_sw_scale(void)
+{
+    check_hscale();
+    report("hscale");
+
+    check_vscale();
+    report("vscale");
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/pixfmt.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define WIDTH  256
+#define HEIGHT 4
+#define STRIDE (WIDTH * 4 + 64)
+
+/* The SIMD versions compute in 16 bits with pmulhw and the C version uses
+ * lookup tables, so they are not bitexact. */
+#define ACCURACY 3
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+        int j;                           \
+        for (j = 0; j < size; j++)       \
+            buf[j] = rnd() & 0xFF;       \
+    } while (0)
+
+static int cmp_off_by_n(const uint8_t *ref, const uint8_t *test, int n,
+                        int accuracy)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (abs(ref[i] - test[i]) > accuracy)
+            return 1;
+    return 0;
+}
+
+static void check_yuv2rgb(enum AVPixelFormat src_fmt)
+{
+    LOCAL_ALIGNED_16(uint8_t, src_y, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src_u, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, src_v, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst0, [STRIDE * HEIGHT]);
+    LOCAL_ALIGNED_16(uint8_t, dst1, [STRIDE * HEIGHT]);
+    static const enum AVPixelFormat dst_fmts[] = {
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+        AV_PIX_FMT_RGBA,  AV_PIX_FMT_BGRA,
+        AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+    };
+    static const int strides[4] = { WIDTH, WIDTH / 2, WIDTH / 2, 0 };
+    const uint8_t *src[4]   = { src_y, src_u, src_v, NULL };
+    int src_stride[4];
+    int dst_stride[4]       = { STRIDE, 0, 0, 0 };
+    uint8_t *dst[4]         = { NULL };
+    int i, level;
+
+    declare_func(int, SwsContext *c, const uint8_t *src[], int srcStride[],
+                 int srcSliceY, int srcSliceH, uint8_t *dst[], int dstStride[]);
+
+    randomize_buffers(src_y, WIDTH * HEIGHT);
+    randomize_buffers(src_u, WIDTH * HEIGHT);
+    randomize_buffers(src_v, WIDTH * HEIGHT);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(dst_fmts); i++) {
+        int bpp = av_get_bits_per_pixel(av_pix_fmt_desc_get(dst_fmts[i])) >> 3;
+        SwsContext *c;
+
+        /* silence the warning about the C version being used */
+        level = av_log_get_level();
+        av_log_set_level(AV_LOG_ERROR);
+        c = sws_getContext(WIDTH, HEIGHT, src_fmt, WIDTH, HEIGHT, dst_fmts[i],
+                           SWS_BILINEAR, NULL, NULL, NULL);
+        av_log_set_level(level);
+        if (!c)
+            continue;
+
+        if (check_func(c->swscale, "%s_to_%s", av_get_pix_fmt_name(src_fmt),
+                       av_get_pix_fmt_name(dst_fmts[i]))) {
+            int y;
+
+            memset(dst0, 0, STRIDE * HEIGHT);
+            memset(dst1, 0, STRIDE * HEIGHT);
+            /* the 4:2:2 versions double the chroma strides in place */
+            memcpy(src_stride, strides, sizeof(strides));
+            dst[0] = dst0;
+            call_ref(c, src, src_stride, 0, HEIGHT, dst, dst_stride);
+            memcpy(src_stride, strides, sizeof(strides));
+            dst[0] = dst1;
+            call_new(c, src, src_stride, 0, HEIGHT, dst, dst_stride);
+            for (y = 0; y < HEIGHT; y++)
+                if (cmp_off_by_n(dst0 + y * STRIDE, dst1 + y * STRIDE,
+                                 WIDTH * bpp, ACCURACY))
+                    fail();
+            if (src_fmt == AV_PIX_FMT_YUV420P) {
+                memcpy(src_stride, strides, sizeof(strides));
+                bench_new(c, src, src_stride, 0, HEIGHT, dst, dst_stride);
+            }
+        }
+        sws_freeContext(c);
+    }
+}
+
+void checkasm_check_sw_yuv2rgb(void)
+{
+    check_yuv2rgb(AV_PIX_FMT_YUV420P);
+    report("yuv420p");
+
+    check_yuv2rgb(AV_PIX_FMT_YUV422P);
+    report("yuv422p");
+}
@@ -192,6 +192,33 @@ pixfmts(){
     test=$outertest
 }
 
+rb32(){
+    od -An -tu1 -j $2 -N 4 $1 | { read a b c d; echo $(( (a << 24) | (b << 16) | (c << 8) | d )); }
+}
+
+qt_faststart_inplace(){
+    srcfile=$(target_path $1)
+    shift
+    reffile="${outdir}/${test}.mov"
+    inplacefile="${outdir}/${test}.inplace.mov"
+    cleanfiles="$reffile $inplacefile"
+    avconv -f rawvideo -s 352x288 $DEC_OPTS -i $srcfile $ENC_OPTS "$@" $FLAGS \
+        -moov_size 16384 -f mov -y $(target_path $reffile) || return
+    # Recreate what a muxer that didn't reserve the space would have written:
+    # the moov appended at the end and a free atom in its place, followed by
+    # the remaining reserved space.
+    ftyp_size=$(rb32 $reffile 0)
+    moov_size=$(rb32 $reffile $ftyp_size)
+    cp -f $reffile $inplacefile
+    dd if=$reffile bs=1 skip=$ftyp_size count=$moov_size 2>/dev/null >>$inplacefile
+    printf free | dd of=$inplacefile bs=1 seek=$(($ftyp_size + 4)) conv=notrunc 2>/dev/null
+    run tools/qt-faststart $(target_path $inplacefile) $(target_path $inplacefile) || return
+    cmp -n $(($ftyp_size + $moov_size)) $reffile $inplacefile || return
+    do_md5sum $inplacefile
+    echo $(wc -c $inplacefile)
+    framecrc -i $(target_path $inplacefile) -c copy
+}
+
 null(){
     :
 }
@@ -50,3 +50,10 @@ $(FATE_LAVF): CMD = lavftest
 
 FATE_AVCONV += $(FATE_LAVF)
 fate-lavf:     $(FATE_LAVF)
+
+FATE_QT_FASTSTART-$(call ALLYES, RAWVIDEO_DEMUXER RAWVIDEO_DECODER MPEG4_ENCODER MOV_MUXER MOV_DEMUXER) += fate-qt-faststart-inplace
+fate-qt-faststart-inplace: tests/data/vsynth1.yuv tools/qt-faststart$(EXESUF)
+fate-qt-faststart-inplace: CMD = qt_faststart_inplace tests/data/vsynth1.yuv -frames 10 -c:v mpeg4
+
+FATE_AVCONV += $(FATE_QT_FASTSTART-yes)
+fate-qt-faststart: $(FATE_QT_FASTSTART-yes)
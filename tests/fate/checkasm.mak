@@ -2,6 +2,7 @@ FATE_CHECKASM = fate-checkasm-audiodsp                                  \
                 fate-checkasm-blockdsp                                  \
                 fate-checkasm-bswapdsp                                  \
                 fate-checkasm-dcadsp                                    \
+                fate-checkasm-flacdsp                                   \
                 fate-checkasm-fmtconvert                                \
                 fate-checkasm-h264dsp                                   \
                 fate-checkasm-h264pred                                  \
@@ -10,6 +11,11 @@ FATE_CHECKASM = fate-checkasm-audiodsp                                  \
                 fate-checkasm-hevc_idct                                 \
                 fate-checkasm-hevc_mc                                   \
                 fate-checkasm-huffyuvdsp                                \
+                fate-checkasm-huffyuvencdsp                             \
+                fate-checkasm-pngdsp                                    \
+                fate-checkasm-sw_rgb                                    \
+                fate-checkasm-sw_scale                                  \
+                fate-checkasm-sw_yuv2rgb                                \
                 fate-checkasm-synth_filter                              \
                 fate-checkasm-v210enc                                   \
                 fate-checkasm-vp8dsp                                    \
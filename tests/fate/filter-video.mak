@@ -41,6 +41,10 @@ fate-filter-hqdn3d: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf hqdn3d
 FATE_FILTER_VSYNTH-$(CONFIG_INTERLACE_FILTER) += fate-filter-interlace
 fate-filter-interlace: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf interlace
 
+FATE_FILTER_VSYNTH-$(CONFIG_MULTISCALE_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: tests/data/filtergraphs/multiscale
+fate-filter-multiscale: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/multiscale
+
 FATE_FILTER_VSYNTH-$(CONFIG_NEGATE_FILTER) += fate-filter-negate
 fate-filter-negate: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf negate
 
@@ -48,6 +52,18 @@ FATE_FILTER_VSYNTH-$(CONFIG_OVERLAY_FILTER) += fate-filter-overlay
 fate-filter-overlay: tests/data/filtergraphs/overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay
 
+FATE_FILTER_VSYNTH-$(call ALLYES, OVERLAY_FILTER FORMAT_FILTER LUTYUV_FILTER SCALE_FILTER) += fate-filter-overlay-nv12
+fate-filter-overlay-nv12: tests/data/filtergraphs/overlay-nv12
+fate-filter-overlay-nv12: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay-nv12
+
+FATE_FILTER_VSYNTH-$(call ALLYES, OVERLAY_FILTER FORMAT_FILTER LUTYUV_FILTER SCALE_FILTER) += fate-filter-overlay-yuv422p10
+fate-filter-overlay-yuv422p10: tests/data/filtergraphs/overlay-yuv422p10
+fate-filter-overlay-yuv422p10: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay-yuv422p10
+
+FATE_FILTER_VSYNTH-$(call ALLYES, OVERLAY_FILTER FORMAT_FILTER LUTYUV_FILTER SCALE_FILTER) += fate-filter-overlay-premultiplied
+fate-filter-overlay-premultiplied: tests/data/filtergraphs/overlay-premultiplied
+fate-filter-overlay-premultiplied: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay-premultiplied
+
 FATE_FILTER_VSYNTH-$(CONFIG_SELECT_FILTER) += fate-filter-select-alternate
 fate-filter-select-alternate: tests/data/filtergraphs/select-alternate
 fate-filter-select-alternate: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_script $(TARGET_PATH)/tests/data/filtergraphs/select-alternate
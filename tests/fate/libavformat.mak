@@ -14,6 +14,14 @@ FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url
 
+FATE_LIBAVFORMAT-$(HAVE_MMAP) += fate-file-mmap
+fate-file-mmap: libavformat/tests/file_mmap$(EXESUF)
+fate-file-mmap: CMD = run libavformat/tests/file_mmap $(TARGET_PATH)/tests/data/fate/file-mmap.bin
+
+FATE_LIBAVFORMAT-$(CONFIG_MOV_MUXER) += fate-fragindex
+fate-fragindex: libavformat/tests/fragindex$(EXESUF)
+fate-fragindex: CMD = run libavformat/tests/fragindex
+
 FATE_LIBAVFORMAT-$(CONFIG_MOV_MUXER) += fate-movenc
 fate-movenc: libavformat/tests/movenc$(EXESUF)
 fate-movenc: CMD = run libavformat/tests/movenc
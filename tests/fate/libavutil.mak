@@ -20,6 +20,10 @@ FATE_LIBAVUTIL += fate-blowfish
 fate-blowfish: libavutil/tests/blowfish$(EXESUF)
 fate-blowfish: CMD = run libavutil/tests/blowfish
 
+FATE_LIBAVUTIL += fate-buffer
+fate-buffer: libavutil/tests/buffer$(EXESUF)
+fate-buffer: CMD = run libavutil/tests/buffer
+
 FATE_LIBAVUTIL += fate-cpu
 fate-cpu: libavutil/tests/cpu$(EXESUF)
 fate-cpu: CMD = run libavutil/tests/cpu $(CPUFLAGS:%=-c%) $(THREADS:%=-t%)
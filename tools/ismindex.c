@@ -48,7 +48,6 @@
 #include <string.h>
 
 #include "libavformat/avformat.h"
-#include "libavformat/isom.h"
 #include "libavformat/os_support.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
@@ -63,6 +62,7 @@ static int usage(const char *argv0, int ret)
 struct MoofOffset {
     int64_t time;
     int64_t offset;
+    int64_t size;
     int64_t duration;
 };
 
@@ -92,70 +92,29 @@ struct Tracks {
     int nb_video_tracks, nb_audio_tracks;
 };
 
-static int expect_tag(int32_t got_tag, int32_t expected_tag) {
-    if (got_tag != expected_tag) {
-        char got_tag_str[4], expected_tag_str[4];
-        AV_WB32(got_tag_str, got_tag);
-        AV_WB32(expected_tag_str, expected_tag);
-        fprintf(stderr, "wanted tag %.4s, got %.4s\n", expected_tag_str,
-                got_tag_str);
-        return -1;
-    }
-    return 0;
-}
-
-static int copy_tag(AVIOContext *in, AVIOContext *out, int32_t tag_name)
+static int write_fragment(const char *filename, AVIOContext *in, int64_t size)
 {
-    int32_t size, tag;
-
-    size = avio_rb32(in);
-    tag  = avio_rb32(in);
-    avio_wb32(out, size);
-    avio_wb32(out, tag);
-    if (expect_tag(tag, tag_name) != 0)
-        return -1;
-    size -= 8;
+    AVIOContext *out = NULL;
+    int ret;
+
+    if ((ret = avio_open2(&out, filename, AVIO_FLAG_WRITE, NULL, NULL)) < 0) {
+        char errbuf[100];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        fprintf(stderr, "Unable to open %s: %s\n", filename, errbuf);
+        return ret;
+    }
     while (size > 0) {
         char buf[1024];
         int len = FFMIN(sizeof(buf), size);
         int got;
         if ((got = avio_read(in, buf, len)) != len) {
             fprintf(stderr, "short read, wanted %d, got %d\n", len, got);
+            ret = AVERROR_INVALIDDATA;
             break;
         }
         avio_write(out, buf, len);
         size -= len;
     }
-    return 0;
-}
-
-static int skip_tag(AVIOContext *in, int32_t tag_name)
-{
-    int64_t pos = avio_tell(in);
-    int32_t size, tag;
-
-    size = avio_rb32(in);
-    tag  = avio_rb32(in);
-    if (expect_tag(tag, tag_name) != 0)
-        return -1;
-    avio_seek(in, pos + size, SEEK_SET);
-    return 0;
-}
-
-static int write_fragment(const char *filename, AVIOContext *in)
-{
-    AVIOContext *out = NULL;
-    int ret;
-
-    if ((ret = avio_open2(&out, filename, AVIO_FLAG_WRITE, NULL, NULL)) < 0) {
-        char errbuf[100];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        fprintf(stderr, "Unable to open %s: %s\n", filename, errbuf);
-        return ret;
-    }
-    ret = copy_tag(in, out, MKBETAG('m', 'o', 'o', 'f'));
-    if (!ret)
-        ret = copy_tag(in, out, MKBETAG('m', 'd', 'a', 't'));
 
     avio_flush(out);
     avio_close(out);
@@ -163,21 +122,12 @@ static int write_fragment(const char *filename, AVIOContext *in)
     return ret;
 }
 
-static int skip_fragment(AVIOContext *in)
-{
-    int ret;
-    ret = skip_tag(in, MKBETAG('m', 'o', 'o', 'f'));
-    if (!ret)
-        ret = skip_tag(in, MKBETAG('m', 'd', 'a', 't'));
-    return ret;
-}
-
 static int write_fragments(struct Tracks *tracks, int start_index,
                            AVIOContext *in, const char *basename,
                            int split, int ismf, const char* output_prefix)
 {
     char dirname[2048], filename[2048], idxname[2048];
-    int i, j, ret = 0, fragment_ret;
+    int i, j, ret = 0;
     FILE* out = NULL;
 
     if (ismf) {
@@ -201,21 +151,21 @@ static int write_fragments(struct Tracks *tracks, int start_index,
             }
         }
         for (j = 0; j < track->chunks; j++) {
+            struct MoofOffset *chunk = &track->offsets[j];
             snprintf(filename, sizeof(filename), "%s/Fragments(%s=%"PRId64")",
-                     dirname, type, track->offsets[j].time);
-            avio_seek(in, track->offsets[j].offset, SEEK_SET);
+                     dirname, type, chunk->time);
             if (ismf)
-                fprintf(out, "%s %"PRId64, filename, avio_tell(in));
-            if (split)
-                fragment_ret = write_fragment(filename, in);
-            else
-                fragment_ret = skip_fragment(in);
-            if (ismf)
-                fprintf(out, " %"PRId64"\n", avio_tell(in));
-            if (fragment_ret != 0) {
-                fprintf(stderr, "failed fragment %d in track %d (%s)\n", j,
-                        track->track_id, track->name);
-                ret = fragment_ret;
+                fprintf(out, "%s %"PRId64" %"PRId64"\n", filename,
+                        chunk->offset, chunk->offset + chunk->size);
+            if (split) {
+                int fragment_ret = AVERROR_INVALIDDATA;
+                if (avio_seek(in, chunk->offset, SEEK_SET) == chunk->offset)
+                    fragment_ret = write_fragment(filename, in, chunk->size);
+                if (fragment_ret != 0) {
+                    fprintf(stderr, "failed fragment %d in track %d (%s)\n", j,
+                            track->track_id, track->name);
+                    ret = fragment_ret;
+                }
             }
         }
     }
@@ -225,144 +175,21 @@ fail:
     return ret;
 }
 
-static int64_t read_trun_duration(AVIOContext *in, int default_duration,
-                                  int64_t end)
+static int read_track_index(struct Track *track,
+                            const AVFragmentIndexTrack *index)
 {
-    int64_t dts = 0;
-    int64_t pos;
-    int flags, i;
-    int entries;
-    int64_t first_pts = 0;
-    int64_t max_pts = 0;
-    avio_r8(in); /* version */
-    flags = avio_rb24(in);
-    if (default_duration <= 0 && !(flags & MOV_TRUN_SAMPLE_DURATION)) {
-        fprintf(stderr, "No sample duration in trun flags\n");
-        return -1;
-    }
-    entries = avio_rb32(in);
-
-    if (flags & MOV_TRUN_DATA_OFFSET)        avio_rb32(in);
-    if (flags & MOV_TRUN_FIRST_SAMPLE_FLAGS) avio_rb32(in);
-
-    pos = avio_tell(in);
-    for (i = 0; i < entries && pos < end; i++) {
-        int sample_duration = default_duration;
-        int64_t pts = dts;
-        if (flags & MOV_TRUN_SAMPLE_DURATION) sample_duration = avio_rb32(in);
-        if (flags & MOV_TRUN_SAMPLE_SIZE)     avio_rb32(in);
-        if (flags & MOV_TRUN_SAMPLE_FLAGS)    avio_rb32(in);
-        if (flags & MOV_TRUN_SAMPLE_CTS)      pts += avio_rb32(in);
-        if (sample_duration < 0) {
-            fprintf(stderr, "Negative sample duration %d\n", sample_duration);
-            return -1;
-        }
-        if (i == 0)
-            first_pts = pts;
-        max_pts = FFMAX(max_pts, pts + sample_duration);
-        dts += sample_duration;
-        pos = avio_tell(in);
-    }
-
-    return max_pts - first_pts;
-}
-
-static int64_t read_moof_duration(AVIOContext *in, int64_t offset)
-{
-    int64_t ret = -1;
-    int32_t moof_size, size, tag;
-    int64_t pos = 0;
-    int default_duration = 0;
-
-    avio_seek(in, offset, SEEK_SET);
-    moof_size = avio_rb32(in);
-    tag  = avio_rb32(in);
-    if (expect_tag(tag, MKBETAG('m', 'o', 'o', 'f')) != 0)
-        goto fail;
-    while (pos < offset + moof_size) {
-        pos = avio_tell(in);
-        size = avio_rb32(in);
-        tag  = avio_rb32(in);
-        if (tag == MKBETAG('t', 'r', 'a', 'f')) {
-            int64_t traf_pos = pos;
-            int64_t traf_size = size;
-            while (pos < traf_pos + traf_size) {
-                pos = avio_tell(in);
-                size = avio_rb32(in);
-                tag  = avio_rb32(in);
-                if (tag == MKBETAG('t', 'f', 'h', 'd')) {
-                    int flags = 0;
-                    avio_r8(in); /* version */
-                    flags = avio_rb24(in);
-                    avio_rb32(in); /* track_id */
-                    if (flags & MOV_TFHD_BASE_DATA_OFFSET)
-                        avio_rb64(in);
-                    if (flags & MOV_TFHD_STSD_ID)
-                        avio_rb32(in);
-                    if (flags & MOV_TFHD_DEFAULT_DURATION)
-                        default_duration = avio_rb32(in);
-                }
-                if (tag == MKBETAG('t', 'r', 'u', 'n')) {
-                    return read_trun_duration(in, default_duration,
-                                              pos + size);
-                }
-                avio_seek(in, pos + size, SEEK_SET);
-            }
-            fprintf(stderr, "Couldn't find trun\n");
-            goto fail;
-        }
-        avio_seek(in, pos + size, SEEK_SET);
-    }
-    fprintf(stderr, "Couldn't find traf\n");
-
-fail:
-    return ret;
-}
-
-static int read_tfra(struct Tracks *tracks, int start_index, AVIOContext *f)
-{
-    int ret = AVERROR_EOF, track_id;
-    int version, fieldlength, i, j;
-    int64_t pos   = avio_tell(f);
-    uint32_t size = avio_rb32(f);
-    struct Track *track = NULL;
+    int i;
 
-    if (avio_rb32(f) != MKBETAG('t', 'f', 'r', 'a'))
-        goto fail;
-    version = avio_r8(f);
-    avio_rb24(f);
-    track_id = avio_rb32(f); /* track id */
-    for (i = start_index; i < tracks->nb_tracks && !track; i++)
-        if (tracks->tracks[i]->track_id == track_id)
-            track = tracks->tracks[i];
-    if (!track) {
-        /* Ok, continue parsing the next atom */
-        ret = 0;
-        goto fail;
-    }
-    fieldlength = avio_rb32(f);
-    track->chunks  = avio_rb32(f);
+    track->chunks  = index->nb_entries;
     track->offsets = av_mallocz(sizeof(*track->offsets) * track->chunks);
-    if (!track->offsets) {
-        ret = AVERROR(ENOMEM);
-        goto fail;
-    }
+    if (!track->offsets)
+        return AVERROR(ENOMEM);
     // The duration here is always the difference between consecutive
     // start times.
     for (i = 0; i < track->chunks; i++) {
-        if (version == 1) {
-            track->offsets[i].time   = avio_rb64(f);
-            track->offsets[i].offset = avio_rb64(f);
-        } else {
-            track->offsets[i].time   = avio_rb32(f);
-            track->offsets[i].offset = avio_rb32(f);
-        }
-        for (j = 0; j < ((fieldlength >> 4) & 3) + 1; j++)
-            avio_r8(f);
-        for (j = 0; j < ((fieldlength >> 2) & 3) + 1; j++)
-            avio_r8(f);
-        for (j = 0; j < ((fieldlength >> 0) & 3) + 1; j++)
-            avio_r8(f);
+        track->offsets[i].time   = index->entries[i].time;
+        track->offsets[i].offset = index->entries[i].offset;
+        track->offsets[i].size   = index->entries[i].size;
         if (i > 0)
             track->offsets[i - 1].duration = track->offsets[i].time -
                                              track->offsets[i - 1].time;
@@ -372,9 +199,9 @@ static int read_tfra(struct Tracks *tracks, int start_index, AVIOContext *f)
                                                      track->duration -
                                                      track->offsets[track->chunks - 1].time;
     }
-    // Now try and read the actual durations from the trun sample data.
+    // Now use the actual durations from the trun sample data.
     for (i = 0; i < track->chunks; i++) {
-        int64_t duration = read_moof_duration(f, track->offsets[i].offset);
+        int64_t duration = index->entries[i].duration;
         if (duration > 0 && llabs(duration - track->offsets[i].duration) > 3) {
             // 3 allows for integer duration to drift a few units,
             // e.g., for 1/3 durations
@@ -402,51 +229,38 @@ static int read_tfra(struct Tracks *tracks, int start_index, AVIOContext *f)
                     track->duration);
         }
     }
-    ret = 0;
-
-fail:
-    avio_seek(f, pos + size, SEEK_SET);
-    return ret;
+    return 0;
 }
 
-static int read_mfra(struct Tracks *tracks, int start_index,
-                     const char *file, int split, int ismf,
-                     const char *basename, const char* output_prefix)
+static int read_index(struct Tracks *tracks, int start_index,
+                      AVIOContext *f, const char *file, int split, int ismf,
+                      const char *basename, const char* output_prefix)
 {
-    int err = 0;
-    const char* err_str = "";
-    AVIOContext *f = NULL;
-    int32_t mfra_size;
+    AVFragmentIndex *index = NULL;
+    int err, i, j;
 
-    if ((err = avio_open2(&f, file, AVIO_FLAG_READ, NULL, NULL)) < 0)
-        goto fail;
-    avio_seek(f, avio_size(f) - 4, SEEK_SET);
-    mfra_size = avio_rb32(f);
-    avio_seek(f, -mfra_size, SEEK_CUR);
-    if (avio_rb32(f) != mfra_size) {
-        err = AVERROR_INVALIDDATA;
-        err_str = "mfra size mismatch";
-        goto fail;
+    if ((err = av_fragment_index_build(f, &index, 0)) < 0) {
+        fprintf(stderr, "Unable to index the fragments of %s\n", file);
+        return err;
     }
-    if (avio_rb32(f) != MKBETAG('m', 'f', 'r', 'a')) {
-        err = AVERROR_INVALIDDATA;
-        err_str = "mfra tag mismatch";
-        goto fail;
-    }
-    while (!read_tfra(tracks, start_index, f)) {
-        /* Empty */
+
+    for (i = start_index; i < tracks->nb_tracks; i++) {
+        struct Track *track = tracks->tracks[i];
+        for (j = 0; j < index->nb_tracks; j++) {
+            if (index->tracks[j].track_id == track->track_id) {
+                if ((err = read_track_index(track, &index->tracks[j])) < 0)
+                    goto fail;
+                break;
+            }
+        }
     }
 
     if (split || ismf)
         err = write_fragments(tracks, start_index, f, basename, split, ismf,
                               output_prefix);
-    err_str = "error in write_fragments";
 
 fail:
-    if (f)
-        avio_close(f);
-    if (err)
-        fprintf(stderr, "Unable to read the MFRA atom in %s (%s)\n", file, err_str);
+    av_fragment_index_free(&index);
     return err;
 }
 
@@ -600,10 +414,8 @@ static int handle_file(struct Tracks *tracks, const char *file, int split,
         tracks->nb_tracks++;
     }
 
-    avformat_close_input(&ctx);
-
-    err = read_mfra(tracks, orig_tracks, file, split, ismf, basename,
-                    output_prefix);
+    err = read_index(tracks, orig_tracks, ctx->pb, file, split, ismf,
+                     basename, output_prefix);
 
 fail:
     if (ctx)
@@ -29,6 +29,13 @@
 #include <inttypes.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <io.h>
+#define ftruncate(fd, size) _chsize_s(fd, size)
+#else
+#include <unistd.h>
+#endif
+
 #ifdef __MINGW32__
 #undef fseeko
 #define fseeko(x, y, z) fseeko64(x, y, z)
@@ -104,17 +111,21 @@ int main(int argc, char *argv[])
     int64_t start_offset = 0;
     unsigned char copy_buffer[COPY_BUFFER_SIZE];
     int bytes_to_copy;
+    uint64_t free_offset = 0, free_size = 0;
+    uint64_t reserved_offset = 0, reserved_size = 0;
+    int mdat_found = 0, in_place;
 
     if (argc != 3) {
         printf("Usage: qt-faststart <infile.mov> <outfile.mov>\n"
-               "Note: alternatively you can use -movflags +faststart in avconv\n");
+               "Note: alternatively you can use -movflags +faststart in avconv\n"
+               "If both files are the same, the moov atom is written in place "
+               "into free space\n"
+               "in front of the mdat atom, as reserved by the avconv -moov_size "
+               "option\n");
         return 0;
     }
 
-    if (!strcmp(argv[1], argv[2])) {
-        fprintf(stderr, "input and output files need to be different\n");
-        return 1;
-    }
+    in_place = !strcmp(argv[1], argv[2]);
 
     infile = fopen(argv[1], "rb");
     if (!infile) {
@@ -184,6 +195,21 @@ int main(int argc, char *argv[])
             printf("encountered non-QT top-level atom (is this a QuickTime file?)\n");
             break;
         }
+
+        /* remember the run of free space right in front of the first mdat */
+        if (atom_type == FREE_ATOM || atom_type == JUNK_ATOM ||
+            atom_type == SKIP_ATOM || atom_type == WIDE_ATOM) {
+            if (!free_size)
+                free_offset = atom_offset;
+            free_size += atom_size;
+        } else {
+            if (atom_type == MDAT_ATOM && !mdat_found) {
+                reserved_offset = free_offset;
+                reserved_size   = free_size;
+                mdat_found      = 1;
+            }
+            free_size = 0;
+        }
         atom_offset += atom_size;
 
         /* The atom header is 8 (or 16 bytes), if the atom size (which
@@ -233,6 +259,56 @@ int main(int argc, char *argv[])
     fclose(infile);
     infile = NULL;
 
+    if (in_place) {
+        /* nothing moves, so the chunk offsets stay valid; the leftover
+         * reserved space is turned into a free atom and the old moov atom
+         * at the end of the file is cut off */
+        uint64_t left = reserved_size - moov_atom_size;
+
+        if (reserved_size < moov_atom_size ||
+            (left && (left < ATOM_PREAMBLE_SIZE || left > UINT32_MAX))) {
+            printf("not enough free space in front of the mdat atom to move "
+                   "the moov atom in place, use a different output file\n");
+            goto error_out;
+        }
+
+        outfile = fopen(argv[2], "r+b");
+        if (!outfile) {
+            perror(argv[2]);
+            goto error_out;
+        }
+
+        printf(" writing moov atom in place...\n");
+        if (fseeko(outfile, reserved_offset, SEEK_SET) ||
+            fwrite(moov_atom, moov_atom_size, 1, outfile) != 1) {
+            perror(argv[2]);
+            goto error_out;
+        }
+        if (left) {
+            unsigned char free_atom[ATOM_PREAMBLE_SIZE] = {
+                left >> 24, left >> 16, left >> 8, left, 'f', 'r', 'e', 'e'
+            };
+            if (fwrite(free_atom, sizeof(free_atom), 1, outfile) != 1) {
+                perror(argv[2]);
+                goto error_out;
+            }
+        }
+        if (fflush(outfile) || ftruncate(fileno(outfile), last_offset)) {
+            /* keep the old moov atom as a free atom if it can't be cut off */
+            if (fseeko(outfile, last_offset + 4, SEEK_SET) ||
+                fwrite("free", 4, 1, outfile) != 1) {
+                perror(argv[2]);
+                goto error_out;
+            }
+        }
+
+        fclose(outfile);
+        free(moov_atom);
+        free(ftyp_atom);
+
+        return 0;
+    }
+
     /* crawl through the moov chunk in search of stco or co64 atoms */
     for (i = 4; i < moov_atom_size - 4; i++) {
         atom_type = BE_32(&moov_atom[i]);
@@ -76,42 +76,26 @@ static void set_codec_str(AVCodecParameters *codecpar, char *str, int size)
 }
 
 static int find_sidx(struct Tracks *tracks, int start_index,
-                     const char *file)
+                     AVIOContext *f, const char *file)
 {
-    int err = 0;
-    AVIOContext *f = NULL;
-    int i;
+    AVFragmentIndex *index = NULL;
+    int err, i;
 
-    if ((err = avio_open2(&f, file, AVIO_FLAG_READ, NULL, NULL)) < 0)
-        goto fail;
+    if ((err = av_fragment_index_build(f, &index, AV_FRAGMENT_INDEX_SIDX)) < 0) {
+        fprintf(stderr, "Unable to index the fragments of %s\n", file);
+        return err;
+    }
 
-    while (!f->eof_reached) {
-        int64_t pos = avio_tell(f);
-        int32_t size, tag;
-
-        size = avio_rb32(f);
-        tag  = avio_rb32(f);
-        if (size < 8)
-            break;
-        if (tag == MKBETAG('s', 'i', 'd', 'x')) {
-            for (i = start_index; i < tracks->nb_tracks; i++) {
-                struct Track *track = tracks->tracks[i];
-                if (!track->sidx_start) {
-                    track->sidx_start  = pos;
-                    track->sidx_length = size;
-                } else if (pos == track->sidx_start + track->sidx_length) {
-                    track->sidx_length = pos + size - track->sidx_start;
-                }
-            }
+    if (index->sidx_offset >= 0) {
+        for (i = start_index; i < tracks->nb_tracks; i++) {
+            struct Track *track = tracks->tracks[i];
+            track->sidx_start  = index->sidx_offset;
+            track->sidx_length = index->sidx_size;
         }
-        if (avio_seek(f, pos + size, SEEK_SET) != pos + size)
-            break;
     }
 
-fail:
-    if (f)
-        avio_close(f);
-    return err;
+    av_fragment_index_free(&index);
+    return 0;
 }
 
 static int handle_file(struct Tracks *tracks, const char *file)
@@ -203,9 +187,7 @@ static int handle_file(struct Tracks *tracks, const char *file)
         tracks->nb_tracks++;
     }
 
-    avformat_close_input(&ctx);
-
-    err = find_sidx(tracks, orig_tracks, file);
+    err = find_sidx(tracks, orig_tracks, ctx->pb, file);
 
 fail:
     if (ctx)